@@ -27,8 +27,164 @@
 #define PAILLIER_H_
 
 #include <stdio.h>
+#include <stdint.h>
 #include <gmp.h>
 
+/** Magic number at the beginning of binary files
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_BIN_MAGIC "PGMP"
+
+/** Version of the binary file formats
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_BIN_VERSION 1
+
+/** Size of the header of binary files, in bytes
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_BIN_HEADER_SIZE 32
+
+/** Type of binary file holding a public key
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_BIN_PUBLIC 1
+
+/** Type of binary file holding a private key
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_BIN_PRIVATE 2
+/** Type of binary file holding a container of ciphertexts
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_BIN_CIPHERTEXTS 3
+
+/** Size of the header of requests and responses of the server, in bytes
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_HEADER_SIZE 16
+
+/** Server operation: encryption of plaintexts
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_ENCRYPT 1
+
+/** Server operation: decryption of ciphertexts
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_DECRYPT 2
+
+/** Server operation: homomorphic addition of pairs of ciphertexts
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_ADD 3
+
+/** Server operation: homomorphic multiplication of ciphertexts with constants
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_MULTC 4
+
+/** Server status: success
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_OK 0
+
+/** Server status: malformed request or operand out of range
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_BAD_REQUEST 1
+
+/** Server status: operation not available, such as decryption without private key
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_UNSUPPORTED 2
+
+/** Server status: the operation failed, for example because memory cannot be allocated or the random source failed
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_SERVER_FAILED 3
+
+/** Statistics probe: single encryptions
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_ENCRYPT 0
+
+/** Statistics probe: single decryptions
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_DECRYPT 1
+
+/** Statistics probe: CRT branches modulo p or p^2
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_CRT_P 2
+
+/** Statistics probe: CRT branches modulo q or q^2
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_CRT_Q 3
+
+/** Statistics probe: draws of random bytes for encryption
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_RANDOM 4
+
+/** Statistics probe: CRT recombinations
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_RECOMBINE 5
+
+/** Statistics probe: serialization of ciphertexts and plaintexts by containers, streams and the server
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_SERIALIZE 6
+
+/** Number of statistics probes
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_COUNT 7
+
+/** Number of buckets of the latency histograms, bucket i counting durations from 2^i to 2^{i+1}-1 ticks
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_STAT_BUCKETS 40
+
+/** Smallest scaling exponent of fixed-point encodings
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_ENCODING_MIN_EXPONENT -1022
+
+/** Largest scaling exponent of fixed-point encodings
+ *
+ * @ingroup Paillier
+ */
+#define PAILLIER_ENCODING_MAX_EXPONENT 1023
+
 /** Private key
  *
  * @ingroup Paillier
@@ -36,6 +192,11 @@
  * In addition to the usual private key elements, the structure contains:
  * - CRT parameters for accelerating exponentiations during decryption
  * - The modular inverse n^{-1} mod 2^len for accelerating the calculation of L
+ * - The primes p and q and the values h_p and h_q for decrypting modulo p and q separately
+ * .
+ * Private keys stored by older versions do not have p, q, h_p and h_q. When such a key is loaded,
+ * p and q are recovered as square roots of p^2 and q^2 and the other parameters are re-computed.
+ * If p is set to zero, decryption falls back to the exponentiation with lambda modulo n^2.
  */
 typedef struct {
 	mp_bitcnt_t len; /**< bit length of n */
@@ -46,6 +207,11 @@ typedef struct {
 	mpz_t p2invq2;		/**< CRT parameter p^{-2} mod q^2 */
 	mpz_t ninv;			/**< modular inverse n^{-1} mod 2^len */
 	mpz_t n;			/**< n=p*q */
+	mpz_t p;			/**< prime number p, zero for keys without CRT decryption parameters */
+	mpz_t q;			/**< prime number q */
+	mpz_t pinvq;		/**< CRT parameter p^{-1} mod q */
+	mpz_t hp;			/**< h_p = L_p(g^{p-1} mod p^2)^{-1} mod p */
+	mpz_t hq;			/**< h_q = L_q(g^{q-1} mod q^2)^{-1} mod q */
 } paillier_private_key;
 
 /** Public key
@@ -54,12 +220,184 @@ typedef struct {
  *
  * The generator is 1+n. This is fine in view of security because Class[g,n] is random self-reducible over g,
  * therefore the security of the cryptosystem does not depend on the choice of g.
+ *
+ * Optionally, the public key has the value h_s = h^n mod n^2 with h = -x^2 mod n for a random x,
+ * as proposed by Damgard, Jurik and Nielsen. In that case, encryption computes r^n mod n^2 as h_s^alpha mod n^2
+ * with a random alpha of len/2 bits, which allows fixed-base pre-computations. See paillier_djn_setup.
  */
 typedef struct {
 	mp_bitcnt_t len; /**< bit length of n */
 	mpz_t n; 			/**< modulus n */
+	mpz_t hs;			/**< h_s = h^n mod n^2 for Damgard-Jurik-Nielsen encryption, zero if not used */
 } paillier_public_key;
 
+/** Public key context
+ *
+ * @ingroup Paillier
+ *
+ * Values derived once from a public key and reused by the context-based operations:
+ * - n^2 and the basis g=1+n, so that they are not re-computed for each operation
+ * - Scratch variables pre-allocated to the size of products modulo n^2
+ * - If the public key has h_s, a fixed-base table of h_s^{j*2^{w*i}} mod n^2 for encryption with short exponents
+ * - Montgomery constants modulo n^2 and scratch limbs for Montgomery-domain ciphertexts
+ * .
+ * Because of the scratch variables, a context must not be used by several threads at the same time.
+ */
+typedef struct {
+	mp_bitcnt_t len;	/**< bit length of n */
+	mp_bitcnt_t len2;	/**< bit length of n^2 */
+	mpz_t n;			/**< modulus n */
+	mpz_t n2;			/**< square of modulus n */
+	mpz_t g;			/**< basis g=1+n */
+	mpz_t r;			/**< scratch variable for random numbers */
+	mpz_t t;			/**< scratch variable for products */
+	mpz_t hs;			/**< h_s = h^n mod n^2, zero if not used */
+	mp_bitcnt_t alpha_len;	/**< bit length of the exponents alpha */
+	unsigned int window;	/**< bit length w of the windows of the fixed-base table */
+	size_t windows;		/**< number of windows of the fixed-base table */
+	mpz_t *table;		/**< fixed-base table with 2^w-1 entries per window, NULL if not used */
+	mp_size_t size;		/**< number of limbs of n^2 */
+	mp_limb_t minv;		/**< Montgomery constant -n^{-2} mod 2^GMP_NUMB_BITS */
+	mp_limb_t *r2;		/**< R^2 mod n^2 with R=2^{size*GMP_NUMB_BITS}, size limbs */
+	mp_limb_t *scratch;	/**< scratch limbs for Montgomery-domain operations */
+} paillier_public_ctx;
+
+/** Ciphertext in the Montgomery domain
+ *
+ * @ingroup Paillier
+ *
+ * Holds c*R mod n^2 with R=2^{size*GMP_NUMB_BITS} in a fixed array of limbs, where size is the number of limbs of n^2.
+ * Homomorphic operations on this type are Montgomery multiplications on the limbs and never divide by n^2,
+ * which makes chains of operations cheaper. Ciphertexts are converted only when entering and leaving the chain,
+ * with paillier_mont_import and paillier_mont_export.
+ */
+typedef struct {
+	mp_size_t size;		/**< number of limbs */
+	mp_limb_t *limbs;	/**< c*R mod n^2, least significant limb first */
+} paillier_mont_ciphertext;
+
+/** Damgard-Jurik public key context
+ *
+ * @ingroup Paillier
+ *
+ * Damgard and Jurik generalize the cryptosystem to plaintexts modulo n^s and ciphertexts modulo n^{s+1},
+ * so that the ciphertext expansion is (s+1)/s instead of 2. The keys are the same for all values of s,
+ * therefore s is a parameter of the context and not of the key. With s=1, the scheme is the Paillier cryptosystem.
+ */
+typedef struct {
+	unsigned int s;		/**< plaintexts are modulo n^s and ciphertexts modulo n^{s+1} */
+	mp_bitcnt_t len;	/**< bit length of n */
+	mpz_t *ns;			/**< powers n^j for j=0..s+1 */
+	mpz_t t;			/**< scratch variable for products */
+} paillier_dj_public_ctx;
+
+/** Damgard-Jurik private key context
+ *
+ * @ingroup Paillier
+ *
+ * Decryption computes c^lambda mod n^{s+1} with the CRT modulo p^{s+1} and q^{s+1},
+ * extracts lambda*m mod n^s, and multiplies with lambda^{-1} mod n^s.
+ */
+typedef struct {
+	paillier_dj_public_ctx pub;	/**< public part of the context */
+	mpz_t lambda;		/**< lambda=lcm(p-1,q-1) */
+	mpz_t lambda_inv;	/**< lambda^{-1} mod n^s */
+	mpz_t ps;			/**< p^{s+1} */
+	mpz_t qs;			/**< q^{s+1} */
+	mpz_t psinvqs;		/**< CRT parameter p^{-(s+1)} mod q^{s+1} */
+	mpz_t *factinv;		/**< inverses of k! modulo n^s for k=0..s */
+} paillier_dj_private_ctx;
+
+/** Plaintext packing
+ *
+ * @ingroup Paillier
+ *
+ * Several small non-negative integers are packed in one plaintext, in slots of value_bits+headroom bits,
+ * the first value in the least significant slot. Homomorphic additions of packed ciphertexts add all slots at once.
+ * Each slot can absorb the sum of up to 2^headroom values before it overflows into the next slot.
+ * Homomorphic multiplications by a constant k multiply all slots by k, and need log2(k) bits of headroom.
+ */
+typedef struct {
+	unsigned int value_bits;	/**< bit length of the packed values */
+	unsigned int headroom;		/**< extra bits per slot for carries of homomorphic operations */
+	unsigned int slot_bits;		/**< bit length of a slot, value_bits+headroom, at most 64 */
+	size_t slots;				/**< number of slots per plaintext */
+} paillier_packing;
+
+/** Reader of a binary container of ciphertexts
+ *
+ * @ingroup Paillier
+ *
+ * The file is mapped in memory and the ciphertexts are fixed-width arrays of limbs, least significant limb first,
+ * that can be used in place with the mpn functions of GMP and with the core API.
+ */
+typedef struct {
+	mp_bitcnt_t len;			/**< bit length of n */
+	mp_size_t size;				/**< number of limbs of each ciphertext */
+	size_t count;				/**< number of ciphertexts */
+	uint64_t fingerprint;		/**< fingerprint of the public key */
+	const mp_limb_t *records;	/**< ciphertexts, size limbs each */
+	void *data;					/**< mapped or allocated content of the file */
+	size_t data_size;			/**< size of the content of the file */
+	int mapped;					/**< 1 if the content is mapped */
+	mp_limb_t *copy;			/**< ciphertexts converted to the byte order of the host, if it is not little-endian */
+} paillier_container;
+
+/** Streaming writer of a binary container of ciphertexts
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	FILE *fp;					/**< output stream */
+	long start;					/**< position of the header in the stream, -1 if the stream cannot seek */
+	mp_size_t size;				/**< number of limbs of each ciphertext */
+	uint64_t count;				/**< number of ciphertexts written so far */
+	unsigned char *record;		/**< buffer for one ciphertext */
+} paillier_container_writer;
+
+/** Random source
+ *
+ * @ingroup Paillier
+ * @param[in,out] state input state of the random source
+ * @param[out] buffer output random bytes
+ * @param[in] len input number of bytes
+ * @return 0 if no error
+ */
+typedef int (*paillier_random_function)(void *state, void *buffer, size_t len);
+
+/** Randomness pool
+ *
+ * @ingroup Paillier
+ *
+ * Pool of pre-computed values r^n mod n^2 for encryption, see paillier_rand_pool_init.
+ */
+typedef struct paillier_rand_pool paillier_rand_pool;
+
+/** Counters of a randomness pool
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	size_t capacity;			/**< maximum number of values in the pool */
+	size_t level;				/**< current number of values in the pool */
+	unsigned long long hits;	/**< number of encryptions served from the pool */
+	unsigned long long misses;	/**< number of encryptions that found the pool empty */
+	unsigned long long generated;	/**< number of values generated for the pool */
+} paillier_rand_pool_counters;
+
+/** Statistics of a probe
+ *
+ * @ingroup Paillier
+ *
+ * Durations are in ticks: processor cycles on x86, nanoseconds elsewhere.
+ */
+typedef struct {
+	unsigned long long count;	/**< number of recorded operations */
+	unsigned long long ticks;	/**< total duration */
+	unsigned long long max;		/**< longest duration */
+	unsigned long long histogram[PAILLIER_STAT_BUCKETS]; /**< number of operations per power-of-two duration, the last bucket taking all longer ones */
+} paillier_stat;
+
 /** Memory allocation for public key
  *
  * @ingroup Paillier
@@ -74,119 +412,1012 @@ void paillier_public_init(paillier_public_key *pub);
  */
 void paillier_private_init(paillier_private_key *priv);
 
-/** Free memory for public key
+/** Free memory for public key
+ *
+ * @ingroup Paillier
+ * @param[in] pub input public key
+ */
+void paillier_public_clear(paillier_public_key *pub);
+
+/** Free memory for private key
+ *
+ * @ingroup Paillier
+ * @param[in] priv input private key
+ */
+void paillier_private_clear(paillier_private_key *priv);
+
+/** Memory allocation and pre-computations for public key context
+ *
+ * @ingroup Paillier
+ * @param[out] ctx output public key context
+ * @param[in] pub input public key
+ */
+void paillier_public_ctx_init(paillier_public_ctx *ctx, paillier_public_key *pub);
+
+/** Free memory for public key context
+ *
+ * @ingroup Paillier
+ * @param[in] ctx input public key context
+ */
+void paillier_public_ctx_clear(paillier_public_ctx *ctx);
+
+/** Pre-computation of parameters for decryption modulo p and q
+ *
+ * @ingroup Paillier
+ * @param[in,out] priv input private key with p and q, output p^{-1} mod q, h_p and h_q
+ * @return 0 if no error
+ */
+int paillier_private_crt_init(paillier_private_key *priv);
+
+/** Start the thread pool
+ *
+ * @ingroup Paillier
+ * @param[in] nthreads input number of worker threads, 0 for the number of online processors
+ * @return 0 if no error
+ *
+ * The thread pool runs the exponentiations of the CRT and the batch operations.
+ * It is started with the default number of threads the first time it is needed,
+ * therefore calling this function is only necessary for choosing the number of threads.
+ * If the pool is already running, it is left unchanged.
+ */
+int paillier_thread_pool_init(unsigned int nthreads);
+
+/** Stop the thread pool
+ *
+ * @ingroup Paillier
+ *
+ * Waits for queued tasks and terminates the worker threads.
+ * It must not be called while other threads are running Paillier operations.
+ */
+void paillier_thread_pool_shutdown(void);
+
+/** Set the random source for encryption
+ *
+ * @ingroup Paillier
+ * @param[in] source input random source, NULL for the default source
+ * @param[in] state input state passed to the random source
+ *
+ * The default source is a ChaCha20 generator per thread, seeded with getrandom() and refilled by large blocks,
+ * so that drawing random numbers does not need system calls in steady state.
+ * A replacement source must be safe to call from several threads at the same time.
+ * The source can be changed while other threads draw random numbers, but a draw that started before the change
+ * may still use the previous source, whose state must therefore remain valid until those operations complete.
+ * If the source fails, the operation drawing the random numbers returns -1.
+ */
+void paillier_set_random_source(paillier_random_function source, void *state);
+
+/** Take a snapshot of the statistics
+ *
+ * @ingroup Paillier
+ * @param[out] stats output array of PAILLIER_STAT_COUNT statistics, indexed by probe
+ * @return 0 if no error, -1 if the library is compiled without PAILLIER_STATS, in which case the statistics are zero
+ *
+ * The counters of all threads are summed. Operations running during the snapshot may be partially counted.
+ */
+int paillier_stats_snapshot(paillier_stat *stats);
+
+/** Reset the statistics
+ *
+ * @ingroup Paillier
+ *
+ * The counters of each thread are cleared lazily, by the thread itself on its next recorded operation.
+ */
+void paillier_stats_reset(void);
+
+/** Name of a statistics probe
+ *
+ * @ingroup Paillier
+ * @param[in] probe input probe, less than PAILLIER_STAT_COUNT
+ * @return name of the probe, NULL if the probe does not exist
+ */
+const char *paillier_stats_name(unsigned int probe);
+
+/** Output a snapshot of the statistics to stdio stream
+ *
+ * @ingroup Paillier
+ * @param[in,out] fp output stream
+ * @return 0 if no error, -1 if the library is compiled without PAILLIER_STATS
+ *
+ * Writes one line per probe with the count, the mean and maximal durations,
+ * and the 50th, 90th and 99th percentiles as upper bounds of histogram buckets.
+ */
+int paillier_stats_out_str(FILE *fp);
+
+/** Output public key to stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] fp output stream
+ * @param[in] pub input public key
+ */
+int paillier_public_out_str(FILE *fp, paillier_public_key *pub);
+
+/** Output private key to stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] fp output stream
+ * @param[in] priv input private key
+ */
+int paillier_private_out_str(FILE *fp, paillier_private_key *priv);
+
+/** Input public key from stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] pub output public key
+ * @param[in] fp input stream
+ */
+int paillier_public_in_str(paillier_public_key *pub, FILE *fp);
+
+/** Input private key from stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] priv output private key
+ * @param[in] fp input stream
+ * @return number of values read, negative on error
+ *
+ * The values p, q, p^-1 mod q, h_p and h_q that follow n are optional, for keys of older versions,
+ * but either all or none of them must be present: -1 is returned if only some of them are read.
+ */
+int paillier_private_in_str(paillier_private_key *priv, FILE *fp);
+
+/** Output public key to stdio stream in binary format
+ *
+ * @ingroup Paillier
+ * @param[out] fp output stream
+ * @param[in] pub input public key
+ * @return 0 if no error
+ *
+ * The file has a header of PAILLIER_BIN_HEADER_SIZE bytes, all integers being little-endian:
+ * - bytes 0-3: magic number PAILLIER_BIN_MAGIC
+ * - bytes 4-5: version PAILLIER_BIN_VERSION
+ * - bytes 6-7: type, PAILLIER_BIN_PUBLIC or PAILLIER_BIN_PRIVATE
+ * - bytes 8-11: bit length of the key
+ * - bytes 12-15: width w of each field, in 64-bit words
+ * - bytes 16-19: number of fields
+ * - bytes 20-23: reserved, zero
+ * - bytes 24-31: checksum, see paillier_bin_checksum
+ * .
+ * The fields follow, each stored as w little-endian 64-bit words, least significant word first.
+ * For a public key, the fields are n and, if set, h_s.
+ */
+int paillier_public_out_bin(FILE *fp, paillier_public_key *pub);
+
+/** Output private key to stdio stream in binary format
+ *
+ * @ingroup Paillier
+ * @param[out] fp output stream
+ * @param[in] priv input private key
+ * @return 0 if no error
+ *
+ * The fields are lambda, mu, p^2, q^2, p^{-2} mod q^2, n^{-1} mod 2^len, n, p, q, p^{-1} mod q, h_p and h_q.
+ * @see paillier_public_out_bin
+ */
+int paillier_private_out_bin(FILE *fp, paillier_private_key *priv);
+
+/** Input public key from stdio stream in binary format
+ *
+ * @ingroup Paillier
+ * @param[out] pub output public key
+ * @param[in] fp input stream
+ * @return 0 if no error, -1 if the stream is not a valid binary public key
+ *
+ * A regular file is mapped in memory, other streams are read with a single read,
+ * and the fields are converted with mpz_import. The checksum is verified before the key is modified.
+ */
+int paillier_public_import_bin(paillier_public_key *pub, FILE *fp);
+
+/** Input private key from stdio stream in binary format
+ *
+ * @ingroup Paillier
+ * @param[out] priv output private key
+ * @param[in] fp input stream
+ * @return 0 if no error, -1 if the stream is not a valid binary private key
+ * @see paillier_public_import_bin
+ */
+int paillier_private_import_bin(paillier_private_key *priv, FILE *fp);
+
+/** Input public key from stdio stream in hexadecimal or binary format
+ *
+ * @ingroup Paillier
+ * @param[out] pub output public key
+ * @param[in] fp input stream
+ * @return 0 if no error
+ *
+ * The format is detected from the first byte: hexadecimal files start with the bit length in decimal,
+ * and binary files with PAILLIER_BIN_MAGIC.
+ */
+int paillier_public_load(paillier_public_key *pub, FILE *fp);
+
+/** Input private key from stdio stream in hexadecimal or binary format
+ *
+ * @ingroup Paillier
+ * @param[out] priv output private key
+ * @param[in] fp input stream
+ * @return 0 if no error
+ * @see paillier_public_load
+ */
+int paillier_private_load(paillier_private_key *priv, FILE *fp);
+
+/** Checksum of a binary file
+ *
+ * @ingroup Paillier
+ * @param[in] data input content of the file, starting with the header
+ * @param[in] size input size of the file in bytes
+ * @return 64-bit FNV-1a hash of the file, the checksum field of the header counting as zero
+ */
+uint64_t paillier_bin_checksum(const void *data, size_t size);
+
+/** Key generation
+ *
+ * @ingroup Paillier
+ * @param[out] pub output public key
+ * @param[out] priv output private key
+ * @param[in] len input bit length of public modulus
+ * @return 0 if no error
+ */
+int paillier_keygen(
+		paillier_public_key *pub,
+		paillier_private_key *priv,
+		mp_bitcnt_t len);
+
+/** Batch key generation
+ *
+ * @ingroup Paillier
+ * @param[out] pub output array of count public keys, initialized by the caller
+ * @param[out] priv output array of count private keys, initialized by the caller
+ * @param[in] count input number of key pairs
+ * @param[in] len input bit length of public moduli
+ * @param[out] seconds output array of count generation times in seconds, or NULL
+ * @return 0 if no error
+ *
+ * The key pairs are generated in parallel on the thread pool.
+ * All primes come from one generator seeded once with getrandom(), so that key generation neither blocks nor re-opens random devices.
+ */
+int paillier_keygen_batch(
+		paillier_public_key *pub,
+		paillier_private_key *priv,
+		size_t count,
+		mp_bitcnt_t len,
+		double *seconds);
+
+/** Set up Damgard-Jurik-Nielsen encryption
+ *
+ * @ingroup Paillier
+ * @param[in,out] pub input public key, with h_s as output
+ * @return 0 if no error
+ *
+ * Computes h_s = h^n mod n^2 with h = -x^2 mod n for a random x.
+ * Once h_s is part of the public key, encryptions use the random value h_s^alpha mod n^2
+ * with a random alpha of len/2 bits instead of r^n mod n^2. The exponent is half as long,
+ * and public key contexts pre-compute a fixed-base table, so that encryption only needs multiplications.
+ */
+int paillier_djn_setup(paillier_public_key *pub);
+
+/** Key generation to stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] public_key output stream for public key
+ * @param[out] private_key output stream for private key
+ * @param[in] len input bit length of public modulus
+ * @return 0 if no error
+ */
+int paillier_keygen_str(
+		FILE *public_key,
+		FILE *private_key,
+		int len);
+
+/** Encrypt
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext c=g^m*r^n mod n^2
+ * @param[in] plaintext input plaintext m, reduced modulo n
+ * @param[in] pub input public key
+ * @return 0 if no error
+ *
+ * Wrapper around paillier_core_encrypt, whose exponentiation does not depend on the secret random number.
+ * This costs about 25% more than a variable-time exponentiation at 2048 bits;
+ * paillier_encrypt_ctx is faster when constant time is not needed.
+ */
+int paillier_encrypt(
+		mpz_t ciphertext,
+		mpz_t plaintext,
+		paillier_public_key *pub);
+
+/** Encrypt with public key context
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext c=g^m*r^n mod n^2
+ * @param[in] plaintext input plaintext m, reduced modulo n
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_encrypt_ctx(
+		mpz_t ciphertext,
+		mpz_t plaintext,
+		paillier_public_ctx *ctx);
+
+/** Encrypt with private key
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext c=g^m*r^n mod n^2
+ * @param[in] plaintext input plaintext m
+ * @param[in] priv input private key
+ * @return 0 if no error
+ *
+ * For data owners, who know the factorization of n. The random factor r^n mod n^2 is computed with the CRT
+ * from two exponentiations modulo p^2 and q^2 with exponents half as long as n, running in parallel.
+ * The ciphertexts cannot be distinguished from those of paillier_encrypt.
+ * The exponentiations use mpz_powm, whose running time depends on the secret exponents p and q.
+ */
+int paillier_encrypt_priv(
+		mpz_t ciphertext,
+		mpz_t plaintext,
+		paillier_private_key *priv);
+
+/** Encrypt a batch of plaintexts
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertexts output array of ciphertexts c_i=g^{m_i}*r_i^n mod n^2, already initialized
+ * @param[in] plaintexts input array of plaintexts m_i, reduced modulo n
+ * @param[in] count input number of plaintexts
+ * @param[in] pub input public key
+ * @return 0 if no error
+ *
+ * The encryptions are spread over the thread pool.
+ * A public key context is built by every call, including the fixed-base table of about 2 MB if the public key has h_s:
+ * callers encrypting several batches should keep a context and use paillier_encrypt_batch_ctx.
+ */
+int paillier_encrypt_batch(
+		mpz_t *ciphertexts,
+		mpz_t *plaintexts,
+		size_t count,
+		paillier_public_key *pub);
+
+/** Encrypt a batch of plaintexts with a public key context
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertexts output array of ciphertexts c_i=g^{m_i}*r_i^n mod n^2, already initialized
+ * @param[in] plaintexts input array of plaintexts m_i, reduced modulo n
+ * @param[in] count input number of plaintexts
+ * @param[in] ctx input public key context, only read
+ * @return 0 if no error
+ *
+ * Same as paillier_encrypt_batch, but the context is provided by the caller and can be kept across batches.
+ * Since the context is only read, several batches can use it at the same time.
+ */
+int paillier_encrypt_batch_ctx(
+		mpz_t *ciphertexts,
+		mpz_t *plaintexts,
+		size_t count,
+		paillier_public_ctx *ctx);
+
+/** Encrypt from stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output stream for ciphertext c=g^m*r^n mod n^2
+ * @param[in] plaintext input stream for plaintext m
+ * @param[in] public_key input stream for public key
+ * @return 0 if no error
+ */
+int paillier_encrypt_str(
+		FILE *ciphertext,
+		FILE *plaintext,
+		FILE *public_key);
+
+/** Re-randomize a ciphertext
+ *
+ * @ingroup Paillier
+ * @param[out] output output ciphertext c*r^n mod n^2, may be the input ciphertext
+ * @param[in] ciphertext input ciphertext c
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ *
+ * The output decrypts to the same plaintext as the input, but cannot be linked to it.
+ * If the public key has h_s, the random factor h_s^alpha mod n^2 is computed with the fixed-base table of the context.
+ * Otherwise, r^n mod n^2 costs a full exponentiation modulo n^2, as much as an encryption:
+ * paillier_rerandomize_pool takes the random factor from a randomness pool and costs one multiplication modulo n^2.
+ */
+int paillier_rerandomize(
+		mpz_t output,
+		mpz_t ciphertext,
+		paillier_public_ctx *ctx);
+
+/** Re-randomize a batch of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] outputs output array of ciphertexts c_i*r_i^n mod n^2, already initialized, may be the input array
+ * @param[in] ciphertexts input array of ciphertexts c_i
+ * @param[in] count input number of ciphertexts
+ * @param[in] ctx input public key context, only read
+ * @return 0 if no error
+ *
+ * The re-randomizations are spread over the thread pool.
+ * Without h_s, each ciphertext costs a full exponentiation modulo n^2, see paillier_rerandomize_pool_batch.
+ */
+int paillier_rerandomize_batch(
+		mpz_t *outputs,
+		mpz_t *ciphertexts,
+		size_t count,
+		paillier_public_ctx *ctx);
+
+
+/** Create a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[out] pool output randomness pool
+ * @param[in] pub input public key
+ * @param[in] capacity input maximum number of pre-computed values
+ * @param[in] nthreads input number of background threads filling the pool, possibly 0
+ * @return 0 if no error
+ *
+ * The value r^n mod n^2 of an encryption does not depend on the plaintext, and can be computed in advance.
+ * Background threads keep the pool full, and sleep while it is full.
+ * With no background thread, the pool is filled with paillier_rand_pool_fill or paillier_rand_pool_load.
+ */
+int paillier_rand_pool_init(
+		paillier_rand_pool **pool,
+		paillier_public_key *pub,
+		size_t capacity,
+		unsigned int nthreads);
+
+/** Stop the background threads and free a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[in] pool input randomness pool
+ */
+void paillier_rand_pool_clear(paillier_rand_pool *pool);
+
+/** Fill a randomness pool from the calling thread
+ *
+ * @ingroup Paillier
+ * @param[in,out] pool input randomness pool
+ * @param[in] count input number of values to compute
+ * @return number of values actually added, less than count if the pool is full
+ */
+size_t paillier_rand_pool_fill(
+		paillier_rand_pool *pool,
+		size_t count);
+
+/** Read the counters of a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[in] pool input randomness pool
+ * @param[out] counters output fill level and hit/miss counters
+ */
+void paillier_rand_pool_stats(
+		paillier_rand_pool *pool,
+		paillier_rand_pool_counters *counters);
+
+/** Spill the content of a randomness pool to stdio stream
+ *
+ * @ingroup Paillier
+ * @param[out] fp output stream
+ * @param[in,out] pool input randomness pool, emptied
+ * @return number of characters written, negative in case of error
+ *
+ * The first line is the fingerprint of the public key, see paillier_public_fingerprint,
+ * and the values follow in hexadecimal, one per line.
+ * The values allow decrypting the corresponding ciphertexts with the public key only:
+ * the file must be kept as secret as a private key, and each value must be loaded only once.
+ */
+int paillier_rand_pool_save(
+		FILE *fp,
+		paillier_rand_pool *pool);
+
+/** Load values spilled to stdio stream into a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[in,out] pool input randomness pool
+ * @param[in] fp input stream
+ * @return number of values loaded, 0 if the values were spilled for another public key
+ *
+ * Loading stops at the first value that is not between 1 and n^2-1.
+ */
+size_t paillier_rand_pool_load(
+		paillier_rand_pool *pool,
+		FILE *fp);
+
+/** Encrypt with a value from a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext c=g^m*r^n mod n^2
+ * @param[in] plaintext input plaintext m, reduced modulo n
+ * @param[in,out] pool input randomness pool
+ * @return 0 if no error
+ *
+ * If the pool is not empty, the encryption costs one multiplication modulo n^2.
+ * Several threads can encrypt with the same pool at the same time.
+ */
+int paillier_encrypt_pool(
+		mpz_t ciphertext,
+		mpz_t plaintext,
+		paillier_rand_pool *pool);
+
+/** Re-randomize a ciphertext with a value from a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[out] output output ciphertext c*r^n mod n^2, may be the input ciphertext
+ * @param[in] ciphertext input ciphertext c
+ * @param[in,out] pool input randomness pool
+ * @return 0 if no error
+ *
+ * If the pool is not empty, the re-randomization costs one multiplication modulo n^2.
+ */
+int paillier_rerandomize_pool(
+		mpz_t output,
+		mpz_t ciphertext,
+		paillier_rand_pool *pool);
+
+/** Re-randomize a batch of ciphertexts with values from a randomness pool
+ *
+ * @ingroup Paillier
+ * @param[out] outputs output array of ciphertexts c_i*r_i^n mod n^2, already initialized, may be the input array
+ * @param[in] ciphertexts input array of ciphertexts c_i
+ * @param[in] count input number of ciphertexts
+ * @param[in,out] pool input randomness pool
+ * @return 0 if no error
+ *
+ * The pool is locked only once for the whole batch.
+ * Each ciphertext costs one multiplication modulo n^2, plus the computation of r^n mod n^2 if the pool ran out of values.
+ */
+int paillier_rerandomize_pool_batch(
+		mpz_t *outputs,
+		mpz_t *ciphertexts,
+		size_t count,
+		paillier_rand_pool *pool);
+
+/** Decrypt
+ *
+ * @ingroup Paillier
+ * @param[out] plaintext output plaintext m
+ * @param[in] ciphertext input ciphertext
+ * @param[in] priv input private key
+ * @return 0 if no error, -1 if the ciphertext is not between 1 and n^2-1 or is a multiple of p^2 or q^2
+ *
+ * With a CRT private key, wrapper around paillier_core_decrypt, whose exponentiations do not depend on the secret primes.
+ * This costs about 15% more than variable-time exponentiations at 2048 bits.
+ */
+int paillier_decrypt(
+		mpz_t plaintext,
+		mpz_t ciphertext,
+		paillier_private_key *priv);
+
+/** Decrypt a batch of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] plaintexts output array of plaintexts m_i, already initialized, may be the ciphertext array
+ * @param[in] ciphertexts input array of ciphertexts c_i
+ * @param[in] count input number of ciphertexts
+ * @param[in] priv input private key
+ * @return 0 if no error, -1 if a ciphertext is not between 1 and n^2-1 or is a multiple of p or q
+ *
+ * The exponentiations modulo p^2 and q^2 of all ciphertexts are spread over the thread pool.
+ * The other ciphertexts are still decrypted when one of them is rejected, and the plaintext of a rejected ciphertext
+ * is unspecified.
+ */
+int paillier_decrypt_batch(
+		mpz_t *plaintexts,
+		mpz_t *ciphertexts,
+		size_t count,
+		paillier_private_key *priv);
+
+/** Memory allocation and pre-computations for Damgard-Jurik public key context
+ *
+ * @ingroup Paillier
+ * @param[out] ctx output public key context
+ * @param[in] pub input public key
+ * @param[in] s input exponent s, at least 1
+ * @return 0 if no error, -1 if s is zero
+ */
+int paillier_dj_public_ctx_init(paillier_dj_public_ctx *ctx, paillier_public_key *pub, unsigned int s);
+
+/** Free memory for Damgard-Jurik public key context
+ *
+ * @ingroup Paillier
+ * @param[in] ctx input public key context
+ */
+void paillier_dj_public_ctx_clear(paillier_dj_public_ctx *ctx);
+
+/** Memory allocation and pre-computations for Damgard-Jurik private key context
+ *
+ * @ingroup Paillier
+ * @param[out] ctx output private key context
+ * @param[in] priv input private key
+ * @param[in] s input exponent s, at least 1
+ * @return 0 if no error, -1 if s is zero
+ */
+int paillier_dj_private_ctx_init(paillier_dj_private_ctx *ctx, paillier_private_key *priv, unsigned int s);
+
+/** Free memory for Damgard-Jurik private key context
+ *
+ * @ingroup Paillier
+ * @param[in] ctx input private key context
+ */
+void paillier_dj_private_ctx_clear(paillier_dj_private_ctx *ctx);
+
+/** Damgard-Jurik encryption
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext c=(1+n)^m*r^{n^s} mod n^{s+1}
+ * @param[in] plaintext input plaintext, less than n^s
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_dj_encrypt(
+		mpz_t ciphertext,
+		mpz_t plaintext,
+		paillier_dj_public_ctx *ctx);
+
+/** Damgard-Jurik decryption
+ *
+ * @ingroup Paillier
+ * @param[out] plaintext output plaintext m modulo n^s
+ * @param[in] ciphertext input ciphertext
+ * @param[in,out] ctx input private key context
+ * @return 0 if no error
+ */
+int paillier_dj_decrypt(
+		mpz_t plaintext,
+		mpz_t ciphertext,
+		paillier_dj_private_ctx *ctx);
+
+/** Damgard-Jurik homomorphic addition
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext3 output ciphertext corresponding to the homomorphic addition of the two plaintexts
+ * @param[in] ciphertext1 input first ciphertext
+ * @param[in] ciphertext2 input second ciphertext
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_dj_homomorphic_add(
+		mpz_t ciphertext3,
+		mpz_t ciphertext1,
+		mpz_t ciphertext2,
+		paillier_dj_public_ctx *ctx);
+
+/** Damgard-Jurik homomorphic multiplication with a constant
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext2 output ciphertext corresponding to the homomorphic multiplication of the plaintext with the constant
+ * @param[in] ciphertext1 input ciphertext
+ * @param[in] constant input constant
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_dj_homomorphic_multc(
+		mpz_t ciphertext2,
+		mpz_t ciphertext1,
+		mpz_t constant,
+		paillier_dj_public_ctx *ctx);
+
+/** Configure plaintext packing
+ *
+ * @ingroup Paillier
+ * @param[out] packing output packing parameters
+ * @param[in] pub input public key
+ * @param[in] value_bits input bit length of the packed values
+ * @param[in] headroom input extra bits per slot for homomorphic operations
+ * @return 0 if no error, -1 if slots would be longer than 64 bits or if no slot fits in the plaintext
+ *
+ * The number of slots is (b-1)/(value_bits+headroom) where b is the bit length of n, so that a packed plaintext is always less than n.
+ */
+int paillier_packing_init(
+		paillier_packing *packing,
+		paillier_public_key *pub,
+		unsigned int value_bits,
+		unsigned int headroom);
+
+/** Pack values in a plaintext
+ *
+ * @ingroup Paillier
+ * @param[out] plaintext output plaintext
+ * @param[in] values input values, each less than 2^value_bits
+ * @param[in] count input number of values, at most the number of slots
+ * @param[in] packing input packing parameters
+ * @return 0 if no error, -1 if there are too many values or if a value is too large
+ */
+int paillier_pack(
+		mpz_t plaintext,
+		const uint64_t *values,
+		size_t count,
+		paillier_packing *packing);
+
+/** Unpack values from a plaintext
+ *
+ * @ingroup Paillier
+ * @param[out] values output values, one per slot, each less than 2^slot_bits
+ * @param[in] count input number of values, at most the number of slots
+ * @param[in] plaintext input plaintext
+ * @param[in] packing input packing parameters
+ * @return 0 if no error, -1 if there are too many values
+ */
+int paillier_unpack(
+		uint64_t *values,
+		size_t count,
+		mpz_t plaintext,
+		paillier_packing *packing);
+
+/** Pack values and encrypt them in one ciphertext
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext
+ * @param[in] values input values, each less than 2^value_bits
+ * @param[in] count input number of values, at most the number of slots
+ * @param[in] packing input packing parameters
+ * @param[in] pub input public key
+ * @return 0 if no error
+ */
+int paillier_encrypt_packed(
+		mpz_t ciphertext,
+		const uint64_t *values,
+		size_t count,
+		paillier_packing *packing,
+		paillier_public_key *pub);
+
+/** Decrypt a ciphertext and unpack its values
+ *
+ * @ingroup Paillier
+ * @param[out] values output values
+ * @param[in] count input number of values, at most the number of slots
+ * @param[in] ciphertext input ciphertext
+ * @param[in] packing input packing parameters
+ * @param[in] priv input private key
+ * @return 0 if no error
+ */
+int paillier_decrypt_packed(
+		uint64_t *values,
+		size_t count,
+		mpz_t ciphertext,
+		paillier_packing *packing,
+		paillier_private_key *priv);
+
+/** Encode signed integers as plaintexts
+ *
+ * @ingroup Paillier
+ * @param[out] plaintexts output array of plaintexts, already initialized
+ * @param[in] values input 64-bit signed integers
+ * @param[in] count input number of values
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if n is too short
+ *
+ * A value v is encoded as v mod n: non-negative values as v, negative values as n-|v|, above n/2.
+ * Homomorphic additions and multiplications by constants then work on signed values,
+ * as long as the results stay between -n/2 and n/2.
+ */
+int paillier_encode_int64(
+		mpz_t *plaintexts,
+		const int64_t *values,
+		size_t count,
+		paillier_public_key *pub);
+
+/** Decode plaintexts as signed integers
+ *
+ * @ingroup Paillier
+ * @param[out] values output 64-bit signed integers
+ * @param[in] plaintexts input array of plaintexts, less than n
+ * @param[in] count input number of plaintexts
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if a plaintext is not less than n or does not represent a 64-bit signed integer
+ *
+ * Plaintexts above n/2 are decoded as negative values.
+ */
+int paillier_decode_int64(
+		int64_t *values,
+		mpz_t *plaintexts,
+		size_t count,
+		paillier_public_key *pub);
+
+/** Encode fixed-point values as plaintexts
+ *
+ * @ingroup Paillier
+ * @param[out] plaintexts output array of plaintexts, already initialized
+ * @param[in] values input values
+ * @param[in] count input number of values
+ * @param[in] exponent input scaling exponent e, between PAILLIER_ENCODING_MIN_EXPONENT and PAILLIER_ENCODING_MAX_EXPONENT
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if the exponent is out of range, if a value is not finite or if a scaled value exceeds n/2
+ *
+ * A value x is scaled to x*2^e, rounded to the nearest integer, and encoded as a signed integer modulo n.
+ * The sum of two encodings has the same exponent, and the product of encodings with exponents e1 and e2,
+ * computed with paillier_homomorphic_multc, has the exponent e1+e2.
+ */
+int paillier_encode_double(
+		mpz_t *plaintexts,
+		const double *values,
+		size_t count,
+		int exponent,
+		paillier_public_key *pub);
+
+/** Decode plaintexts as fixed-point values
  *
  * @ingroup Paillier
+ * @param[out] values output values
+ * @param[in] plaintexts input array of plaintexts, less than n
+ * @param[in] count input number of plaintexts
+ * @param[in] exponent input scaling exponent e of the plaintexts
  * @param[in] pub input public key
+ * @return 0 if no error, -1 if the exponent is out of range or if a plaintext is not less than n
+ *
+ * A plaintext is decoded as a signed integer v and the value is v*2^{-e}, rounded towards zero to double precision.
  */
-void paillier_public_clear(paillier_public_key *pub);
+int paillier_decode_double(
+		double *values,
+		mpz_t *plaintexts,
+		size_t count,
+		int exponent,
+		paillier_public_key *pub);
 
-/** Free memory for private key
+/** Encode and encrypt a batch of signed integers
  *
  * @ingroup Paillier
- * @param[in] priv input private key
+ * @param[out] ciphertexts output array of ciphertexts, already initialized
+ * @param[in] values input 64-bit signed integers
+ * @param[in] count input number of values
+ * @param[in] ctx input public key context, only read
+ * @return 0 if no error
+ *
+ * The values are encoded as with paillier_encode_int64 directly into plaintexts reused from one slice of the batch
+ * to the next, and encrypted with paillier_encrypt_batch_ctx.
  */
-void paillier_private_clear(paillier_private_key *priv);
-
+int paillier_encrypt_int64_batch(
+		mpz_t *ciphertexts,
+		const int64_t *values,
+		size_t count,
+		paillier_public_ctx *ctx);
 
-/** Output public key to stdio stream
+/** Encode and encrypt a batch of fixed-point values
  *
  * @ingroup Paillier
- * @param[out] fp output stream
- * @param[in] pub input public key
+ * @param[out] ciphertexts output array of ciphertexts, already initialized
+ * @param[in] values input values
+ * @param[in] count input number of values
+ * @param[in] exponent input scaling exponent
+ * @param[in] ctx input public key context, only read
+ * @return 0 if no error
+ *
+ * @see paillier_encode_double
  */
-int paillier_public_out_str(FILE *fp, paillier_public_key *pub);
+int paillier_encrypt_double_batch(
+		mpz_t *ciphertexts,
+		const double *values,
+		size_t count,
+		int exponent,
+		paillier_public_ctx *ctx);
 
-/** Output private key to stdio stream
+/** Decrypt and decode a batch of signed integers
  *
  * @ingroup Paillier
- * @param[out] fp output stream
+ * @param[out] values output 64-bit signed integers
+ * @param[in] ciphertexts input array of ciphertexts
+ * @param[in] count input number of ciphertexts
  * @param[in] priv input private key
+ * @return 0 if no error
+ *
+ * The ciphertexts are decrypted with paillier_decrypt_batch, and decoded as with paillier_decode_int64.
  */
-int paillier_private_out_str(FILE *fp, paillier_private_key *priv);
+int paillier_decrypt_int64_batch(
+		int64_t *values,
+		mpz_t *ciphertexts,
+		size_t count,
+		paillier_private_key *priv);
 
-/** Input public key from stdio stream
+/** Decrypt and decode a batch of fixed-point values
  *
  * @ingroup Paillier
- * @param[out] pub output public key
- * @param[in] fp input stream
+ * @param[out] values output values
+ * @param[in] ciphertexts input array of ciphertexts
+ * @param[in] count input number of ciphertexts
+ * @param[in] exponent input scaling exponent of the plaintexts
+ * @param[in] priv input private key
+ * @return 0 if no error
+ *
+ * @see paillier_decode_double
  */
-int paillier_public_in_str(paillier_public_key *pub, FILE *fp);
+int paillier_decrypt_double_batch(
+		double *values,
+		mpz_t *ciphertexts,
+		size_t count,
+		int exponent,
+		paillier_private_key *priv);
 
-/** Input private key from stdio stream
+/** Number of limbs of ciphertexts for the fixed-width core API
  *
  * @ingroup Paillier
- * @param[out] priv output private key
- * @param[in] fp input stream
+ * @param[in] pub input public key
+ * @return number of limbs of n^2
+ *
+ * The core API works on arrays of limbs of fixed width, least significant limb first:
+ * ciphertexts have as many limbs as n^2, and plaintexts and constants as many limbs as n.
+ * All temporary values live in a scratch space provided by the caller, so that the core functions never allocate memory.
+ * The exponentiations of encryption and decryption use mpn_sec_powm, whose running time does not depend on the secret operands.
+ * At 2048 bits, this costs about 25% on encryption and 15% on decryption compared with mpz_powm.
+ * The homomorphic multiplication by a constant only handles public values and uses a faster variable-time exponentiation.
+ * The mpz functions paillier_encrypt, paillier_decrypt, paillier_homomorphic_add and paillier_homomorphic_multc
+ * are wrappers around the core API.
  */
-int paillier_private_in_str(paillier_private_key *priv, FILE *fp);
+mp_size_t paillier_core_limbs(paillier_public_key *pub);
 
-/** Key generation
+/** Size of the scratch space for the core public key operations
  *
  * @ingroup Paillier
- * @param[out] pub output public key
- * @param[out] priv output private key
- * @param[in] len input bit length of public modulus
- * @return 0 if no error
+ * @param[in] pub input public key
+ * @return number of limbs of the scratch space of paillier_core_encrypt, paillier_core_homomorphic_add and paillier_core_homomorphic_multc
  */
-int paillier_keygen(
-		paillier_public_key *pub,
-		paillier_private_key *priv,
-		mp_bitcnt_t len);
+mp_size_t paillier_core_scratch_limbs(paillier_public_key *pub);
 
-
-/** Key generation to stdio stream
+/** Size of the scratch space for core decryption
  *
  * @ingroup Paillier
- * @param[out] public_key output stream for public key
- * @param[out] private_key output stream for private key
- * @param[in] len input bit length of public modulus
- * @return 0 if no error
+ * @param[in] priv input private key
+ * @return number of limbs of the scratch space of paillier_core_decrypt, 0 if the private key has no CRT parameters
  */
-int paillier_keygen_str(
-		FILE *public_key,
-		FILE *private_key,
-		int len);
+mp_size_t paillier_core_decrypt_scratch_limbs(paillier_private_key *priv);
 
-/** Encrypt
+/** Encrypt with the fixed-width core API
  *
  * @ingroup Paillier
- * @param[out] ciphertext output ciphertext c=g^m*r^n mod n^2
- * @param[in] plaintext input plaintext m
+ * @param[out] ciphertext output ciphertext, as many limbs as n^2
+ * @param[in] plaintext input plaintext less than n, as many limbs as n
  * @param[in] pub input public key
- * @return 0 if no error
+ * @param[in,out] scratch input scratch space of paillier_core_scratch_limbs limbs
+ * @return 0 if no error, -1 if the random source failed or h_s is not between 1 and n^2-1
  */
-int paillier_encrypt(
-		mpz_t ciphertext,
-		mpz_t plaintext,
-		paillier_public_key *pub);
+int paillier_core_encrypt(
+		mp_limb_t *ciphertext,
+		const mp_limb_t *plaintext,
+		paillier_public_key *pub,
+		mp_limb_t *scratch);
 
-/** Encrypt from stdio stream
+/** Decrypt with the fixed-width core API
  *
  * @ingroup Paillier
- * @param[out] ciphertext output stream for ciphertext c=g^m*r^n mod n^2
- * @param[in] plaintext input stream for plaintext m
- * @param[in] public_key input stream for public key
- * @return 0 if no error
+ * @param[out] plaintext output plaintext, as many limbs as n
+ * @param[in] ciphertext input ciphertext, as many limbs as n^2
+ * @param[in] priv input private key with CRT parameters
+ * @param[in,out] scratch input scratch space of paillier_core_decrypt_scratch_limbs limbs
+ * @return 0 if no error, -1 if the private key has no CRT parameters or the ciphertext is a multiple of p^2 or q^2
+ *
+ * The exponentiations modulo p^2 and q^2 run in parallel on the thread pool, each with its own part of the scratch space.
  */
-int paillier_encrypt_str(
-		FILE *ciphertext,
-		FILE *plaintext,
-		FILE *public_key);
+int paillier_core_decrypt(
+		mp_limb_t *plaintext,
+		const mp_limb_t *ciphertext,
+		paillier_private_key *priv,
+		mp_limb_t *scratch);
 
+/** Homomorphically add two plaintexts with the fixed-width core API
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext3 output ciphertext, as many limbs as n^2, may be an input
+ * @param[in] ciphertext1 input first ciphertext, as many limbs as n^2
+ * @param[in] ciphertext2 input second ciphertext, as many limbs as n^2
+ * @param[in] pub input public key
+ * @param[in,out] scratch input scratch space of paillier_core_scratch_limbs limbs
+ * @return 0 if no error
+ */
+int paillier_core_homomorphic_add(
+		mp_limb_t *ciphertext3,
+		const mp_limb_t *ciphertext1,
+		const mp_limb_t *ciphertext2,
+		paillier_public_key *pub,
+		mp_limb_t *scratch);
 
-/** Decrypt
+/** Homomorphically multiply a plaintext with a constant with the fixed-width core API
  *
  * @ingroup Paillier
- * @param[out] plaintext output plaintext m
- * @param[in] ciphertext input ciphertext
- * @param[in] priv input private key
+ * @param[out] ciphertext2 output ciphertext, as many limbs as n^2, may be the input
+ * @param[in] ciphertext1 input ciphertext, as many limbs as n^2, less than n^2
+ * @param[in] constant input constant less than n, as many limbs as n
+ * @param[in] pub input public key
+ * @param[in,out] scratch input scratch space of paillier_core_scratch_limbs limbs
  * @return 0 if no error
  */
-int paillier_decrypt(
-		mpz_t plaintext,
-		mpz_t ciphertext,
-		paillier_private_key *priv);
+int paillier_core_homomorphic_multc(
+		mp_limb_t *ciphertext2,
+		const mp_limb_t *ciphertext1,
+		const mp_limb_t *constant,
+		paillier_public_key *pub,
+		mp_limb_t *scratch);
 
 /** Decrypt from stdio stream
  *
@@ -208,7 +1439,7 @@ int paillier_decrypt_str(
  * @param[in] ciphertext1 input first ciphertext corresponding to a plaintext to be homomorphically added
  * @param[in] ciphertext2 input second ciphertext corresponding to a plaintext to be homomorphically added
  * @param[in] pub input public key
- * @return 0 if no error
+ * @return 0 if no error, -1 if a ciphertext is not between 1 and n^2-1
  */
 int paillier_homomorphic_add(
 		mpz_t ciphertext3,
@@ -216,6 +1447,21 @@ int paillier_homomorphic_add(
 		mpz_t ciphertext2,
 		paillier_public_key *pub);
 
+/** Homomorphically add two plaintexts with public key context
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext3 output ciphertext corresponding to the homomorphic addition of the two plaintexts
+ * @param[in] ciphertext1 input first ciphertext corresponding to a plaintext to be homomorphically added
+ * @param[in] ciphertext2 input second ciphertext corresponding to a plaintext to be homomorphically added
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_homomorphic_add_ctx(
+		mpz_t ciphertext3,
+		mpz_t ciphertext1,
+		mpz_t ciphertext2,
+		paillier_public_ctx *ctx);
+
 /** Homomorphically add two plaintexts from stdio stream
  *
  * @ingroup Paillier
@@ -238,7 +1484,7 @@ int paillier_homomorphic_add_str(
  * @param[in] ciphertext1 input ciphertext corresponding to a plaintext to be homomorphically multiplied
  * @param[in] constant input constant to be homomorphically multiplied
  * @param[in] pub input public key
- * @return 0 if no error
+ * @return 0 if no error, -1 if a ciphertext is not between 1 and n^2-1
  */
 int paillier_homomorphic_multc(
 		mpz_t ciphertext2,
@@ -246,6 +1492,133 @@ int paillier_homomorphic_multc(
 		mpz_t constant,
 		paillier_public_key *pub);
 
+/** Homomorphically multiply a plaintext with a constant with public key context
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext2 output ciphertext corresponding to the homomorphic multiplication of the plaintext with the constant
+ * @param[in] ciphertext1 input ciphertext corresponding to a plaintext to be homomorphically multiplied
+ * @param[in] constant input constant to be homomorphically multiplied
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_homomorphic_multc_ctx(
+		mpz_t ciphertext2,
+		mpz_t ciphertext1,
+		mpz_t constant,
+		paillier_public_ctx *ctx);
+
+/** Homomorphically compute a weighted sum of plaintexts
+ *
+ * @ingroup Paillier
+ * @param[out] result output ciphertext corresponding to the sum of the plaintexts multiplied by the weights
+ * @param[in] ciphertexts input array of ciphertexts
+ * @param[in] weights input array of weights between 0 and n-1, one per ciphertext
+ * @param[in] count input number of ciphertexts
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if a weight is negative or not less than n, or if a ciphertext is not between 1 and n^2-1
+ *
+ * Computes prod c_i^{w_i} mod n^2, which decrypts to sum w_i*m_i mod n.
+ * A negative weight -w can be given as n-w.
+ * The product is evaluated with the bucket method of Pippenger, so that squarings are shared by all terms,
+ * and the terms are split in chunks running on the thread pool.
+ */
+int paillier_homomorphic_dot(
+		mpz_t result,
+		mpz_t *ciphertexts,
+		mpz_t *weights,
+		size_t count,
+		paillier_public_key *pub);
+
+/** Homomorphically add many plaintexts
+ *
+ * @ingroup Paillier
+ * @param[out] result output ciphertext corresponding to the sum of the plaintexts
+ * @param[in] ciphertexts input array of ciphertexts, each less than n^2
+ * @param[in] count input number of ciphertexts
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if a ciphertext is not between 1 and n^2-1 or if memory cannot be allocated
+ *
+ * Computes prod c_i mod n^2, which decrypts to sum m_i mod n.
+ * The ciphertexts are split in chunks multiplied in parallel on the thread pool with Montgomery multiplications,
+ * without a division after each product, and the partial products are combined at the end.
+ * The result for an empty array is 1, an encryption of 0.
+ */
+int paillier_homomorphic_sum(
+		mpz_t result,
+		mpz_t *ciphertexts,
+		size_t count,
+		paillier_public_key *pub);
+
+/** Memory allocation for ciphertext in the Montgomery domain
+ *
+ * @ingroup Paillier
+ * @param[out] c output ciphertext, allocated with the number of limbs of n^2
+ * @param[in] ctx input public key context
+ */
+void paillier_mont_init(paillier_mont_ciphertext *c, paillier_public_ctx *ctx);
+
+/** Free memory for ciphertext in the Montgomery domain
+ *
+ * @ingroup Paillier
+ * @param[in] c input ciphertext
+ */
+void paillier_mont_clear(paillier_mont_ciphertext *c);
+
+/** Convert a ciphertext to the Montgomery domain
+ *
+ * @ingroup Paillier
+ * @param[out] out output ciphertext c*R mod n^2
+ * @param[in] ciphertext input ciphertext, less than n^2
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_mont_import(
+		paillier_mont_ciphertext *out,
+		mpz_t ciphertext,
+		paillier_public_ctx *ctx);
+
+/** Convert a ciphertext from the Montgomery domain
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext in canonical form, for decryption or export
+ * @param[in] in input ciphertext in the Montgomery domain
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_mont_export(
+		mpz_t ciphertext,
+		paillier_mont_ciphertext *in,
+		paillier_public_ctx *ctx);
+
+/** Homomorphically add two plaintexts in the Montgomery domain
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext3 output ciphertext corresponding to the homomorphic addition of the two plaintexts, may be an input
+ * @param[in] ciphertext1 input first ciphertext
+ * @param[in] ciphertext2 input second ciphertext
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error
+ */
+int paillier_mont_add(
+		paillier_mont_ciphertext *ciphertext3,
+		paillier_mont_ciphertext *ciphertext1,
+		paillier_mont_ciphertext *ciphertext2,
+		paillier_public_ctx *ctx);
+
+/** Homomorphically multiply a plaintext with a constant in the Montgomery domain
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext2 output ciphertext corresponding to the homomorphic multiplication of the plaintext with the constant, may be the input
+ * @param[in] ciphertext1 input ciphertext
+ * @param[in] constant input non-negative constant
+ * @param[in,out] ctx input public key context
+ * @return 0 if no error, -1 if the constant is negative
+ */
+int paillier_mont_multc(
+		paillier_mont_ciphertext *ciphertext2,
+		paillier_mont_ciphertext *ciphertext1,
+		mpz_t constant,
+		paillier_public_ctx *ctx);
 
 /** Homomorphically multiply a plaintext with a constant from stdio stream
  *
@@ -262,4 +1635,247 @@ int paillier_homomorphic_multc_str(
 		FILE *plaintext,
 		FILE *public_key);
 
+/** Conversion of a public key between hexadecimal and binary formats
+ *
+ * @ingroup Paillier
+ * @param[out] out output stream, receiving the key in the other format
+ * @param[in] in input stream with the key in hexadecimal or binary format
+ * @return 0 if no error
+ */
+int paillier_public_convert_str(
+		FILE *out,
+		FILE *in);
+
+/** Conversion of a private key between hexadecimal and binary formats
+ *
+ * @ingroup Paillier
+ * @param[out] out output stream, receiving the key in the other format
+ * @param[in] in input stream with the key in hexadecimal or binary format
+ * @return 0 if no error
+ */
+int paillier_private_convert_str(
+		FILE *out,
+		FILE *in);
+
+/** Fingerprint of a public key
+ *
+ * @ingroup Paillier
+ * @param[in] pub input public key
+ * @return 64-bit FNV-1a hash of n written as little-endian 64-bit words, least significant word first
+ */
+uint64_t paillier_public_fingerprint(paillier_public_key *pub);
+
+/** Open a binary container of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] cont output container reader
+ * @param[in] fp input stream, can be closed once the container is open
+ * @return 0 if no error, -1 if the stream is not a valid container
+ *
+ * The container has a header of PAILLIER_BIN_HEADER_SIZE bytes, all integers being little-endian:
+ * - bytes 0-3: magic number PAILLIER_BIN_MAGIC
+ * - bytes 4-5: version PAILLIER_BIN_VERSION
+ * - bytes 6-7: type PAILLIER_BIN_CIPHERTEXTS
+ * - bytes 8-11: bit length of the key
+ * - bytes 12-15: width w of each ciphertext, in 64-bit words, enough for n^2
+ * - bytes 16-23: number of ciphertexts, all ones if the writer could not seek back to the header
+ * - bytes 24-31: fingerprint of the public key, see paillier_public_fingerprint
+ * .
+ * The ciphertexts follow, each stored as w little-endian 64-bit words, least significant word first.
+ * Regular files are mapped in memory, and on little-endian hosts with 64-bit limbs the ciphertexts are used in place.
+ */
+int paillier_container_open(paillier_container *cont, FILE *fp);
+
+/** Close a binary container of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[in] cont input container reader
+ */
+void paillier_container_close(paillier_container *cont);
+
+/** Ciphertext of a container
+ *
+ * @ingroup Paillier
+ * @param[in] cont input container reader
+ * @param[in] index input index of the ciphertext, less than cont->count
+ * @return read-only array of cont->size limbs, valid until the container is closed
+ */
+const mp_limb_t *paillier_container_get(paillier_container *cont, size_t index);
+
+/** Ciphertext of a container as an integer
+ *
+ * @ingroup Paillier
+ * @param[out] view output read-only integer sharing the limbs of the container, must not be modified nor cleared
+ * @param[in] cont input container reader
+ * @param[in] index input index of the ciphertext, less than cont->count
+ */
+void paillier_container_view(mpz_t view, paillier_container *cont, size_t index);
+
+/** Start writing a binary container of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] writer output container writer
+ * @param[in] fp input output stream
+ * @param[in] pub input public key of the ciphertexts
+ * @return 0 if no error
+ *
+ * The header is written immediately, and the number of ciphertexts is updated by paillier_container_writer_finish if the stream can seek.
+ */
+int paillier_container_writer_init(paillier_container_writer *writer, FILE *fp, paillier_public_key *pub);
+
+/** Append a ciphertext to a binary container
+ *
+ * @ingroup Paillier
+ * @param[in,out] writer input container writer
+ * @param[in] ciphertext input ciphertext, less than n^2
+ * @return 0 if no error
+ */
+int paillier_container_write(paillier_container_writer *writer, mpz_t ciphertext);
+
+/** Finish writing a binary container of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[in] writer input container writer, freed
+ * @return 0 if no error
+ *
+ * The output stream is flushed but not closed.
+ */
+int paillier_container_writer_finish(paillier_container_writer *writer);
+
+/** Decrypt a container of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] plaintexts output array of cont->count plaintexts, already initialized
+ * @param[in] cont input container reader
+ * @param[in] priv input private key
+ * @return 0 if no error, -1 if the container was written for another key or its records are not as wide as ciphertexts of the key,
+ * if a ciphertext is out of range or if memory cannot be allocated
+ * @see paillier_decrypt_batch
+ */
+int paillier_decrypt_container(
+		mpz_t *plaintexts,
+		paillier_container *cont,
+		paillier_private_key *priv);
+
+/** Homomorphically add all plaintexts of a container
+ *
+ * @ingroup Paillier
+ * @param[out] result output ciphertext corresponding to the sum of the plaintexts
+ * @param[in] cont input container reader
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if the container was written for another key or its records are not as wide as ciphertexts of the key,
+ * or if memory cannot be allocated
+ * @see paillier_homomorphic_sum
+ */
+int paillier_homomorphic_sum_container(
+		mpz_t result,
+		paillier_container *cont,
+		paillier_public_key *pub);
+
+/** Homomorphically compute a weighted sum of the plaintexts of a container
+ *
+ * @ingroup Paillier
+ * @param[out] result output ciphertext corresponding to the sum of the plaintexts multiplied by the weights
+ * @param[in] cont input container reader
+ * @param[in] weights input array of cont->count weights between 0 and n-1
+ * @param[in] pub input public key
+ * @return 0 if no error, -1 if the container was written for another key or its records are not as wide as ciphertexts of the key,
+ * if a weight or ciphertext is out of range or if memory cannot be allocated
+ * @see paillier_homomorphic_dot
+ */
+int paillier_homomorphic_dot_container(
+		mpz_t result,
+		paillier_container *cont,
+		mpz_t *weights,
+		paillier_public_key *pub);
+
+/** Encrypt a stream of plaintexts
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertexts output stream of ciphertexts, one hexadecimal value per line
+ * @param[in] plaintexts input stream of plaintexts, one hexadecimal value per line
+ * @param[in] pub input public key
+ * @param[in] window input number of values per batch, 0 for the default
+ * @return 0 if no error, -1 if a line is not a hexadecimal value or a plaintext is not less than n
+ *
+ * The values are processed by batches, with two batches in flight:
+ * while a batch is encrypted on the thread pool, the previous results are written and the next values are parsed.
+ * The public key context is computed once for the whole stream.
+ */
+int paillier_encrypt_stream(
+		FILE *ciphertexts,
+		FILE *plaintexts,
+		paillier_public_key *pub,
+		size_t window);
+
+/** Decrypt a stream of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] plaintexts output stream of plaintexts, one hexadecimal value per line
+ * @param[in] ciphertexts input stream of ciphertexts, one hexadecimal value per line
+ * @param[in] priv input private key
+ * @param[in] window input number of values per batch, 0 for the default
+ * @return 0 if no error, -1 if a line is not a hexadecimal value, a ciphertext is not less than n^2 or a batch fails to decrypt
+ * @see paillier_encrypt_stream
+ */
+int paillier_decrypt_stream(
+		FILE *plaintexts,
+		FILE *ciphertexts,
+		paillier_private_key *priv,
+		size_t window);
+
+/** Homomorphically add a stream of ciphertexts
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output stream for the ciphertext of the sum, one hexadecimal value
+ * @param[in] ciphertexts input stream of ciphertexts, one hexadecimal value per line
+ * @param[in] pub input public key
+ * @param[in] window input number of values per batch, 0 for the default
+ * @return 0 if no error, -1 if a line is not a hexadecimal value or a ciphertext is not less than n^2
+ * @see paillier_encrypt_stream
+ */
+int paillier_sum_stream(
+		FILE *ciphertext,
+		FILE *ciphertexts,
+		paillier_public_key *pub,
+		size_t window);
+
+/** Run an encryption server on a Unix domain socket
+ *
+ * @ingroup Paillier
+ * @param[in] socket_path input path of the socket, replaced if it is a stale socket; any other file is left in place
+ * @param[in] pub input public key, kept resident with its context
+ * @param[in] priv input private key, or NULL to refuse decryption requests
+ * @return 0 when the server stops after SIGINT or SIGTERM, -1 if the socket cannot be created
+ *
+ * An epoll event loop accepts connections and reads requests, which are processed on the thread pool.
+ * Responses are sent in the order in which requests complete, and carry the identifier of their request.
+ * All integers of the protocol are little-endian. Requests and responses have a header of PAILLIER_SERVER_HEADER_SIZE bytes:
+ * - bytes 0-3: request identifier, chosen by the client and copied to the response
+ * - byte 4: operation in a request (PAILLIER_SERVER_ENCRYPT, PAILLIER_SERVER_DECRYPT, PAILLIER_SERVER_ADD or PAILLIER_SERVER_MULTC),
+ *   status in a response (PAILLIER_SERVER_OK, PAILLIER_SERVER_BAD_REQUEST, PAILLIER_SERVER_UNSUPPORTED or PAILLIER_SERVER_FAILED)
+ * - bytes 5-7: reserved, zero
+ * - bytes 8-11: number of items
+ * - bytes 12-15: size of the payload in bytes
+ * .
+ * The payload is a sequence of integers, each written as a 4-byte length followed by that many little-endian bytes.
+ * A request has one operand per item for encryption and decryption, and two for homomorphic operations:
+ * two ciphertexts for additions, a ciphertext and a constant for multiplications.
+ * Plaintexts must be less than n and ciphertexts less than n^2, otherwise the status is PAILLIER_SERVER_BAD_REQUEST,
+ * and constants are reduced modulo n.
+ * A response has one result per item, or none if the status is not PAILLIER_SERVER_OK.
+ *
+ * A connection stops being read while it has too many requests in progress or too many bytes buffered,
+ * until responses are sent. When the client shuts down its side of the connection, the requests already received
+ * are answered before the connection is closed.
+ *
+ * SIGINT, SIGTERM and SIGUSR1 are blocked and handled by the event loop, which requires that the thread pool
+ * is not started before the server, so that worker threads inherit the signal mask.
+ * SIGUSR1 writes the statistics of the library to stderr, see paillier_stats_out_str.
+ */
+int paillier_serve(
+		const char *socket_path,
+		paillier_public_key *pub,
+		paillier_private_key *priv);
+
 #endif /* PAILLIER_H_ */
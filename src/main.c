@@ -29,6 +29,7 @@
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
+#include <time.h>
 #include "../include/paillier.h"
 
 /** Help message
@@ -36,13 +37,150 @@
  * @ingroup Interpreter
  */
 const char *hlp_message =
-		"Syntax: paillier [options]\n"
+		"Syntax: paillier [--stats] [options]\n"
 		"options:\n"
 		"  keygen [public_key_file] [private_key_file] [bit length]\n"
+		"  keygen-batch [count] [bit length] [out_dir]\n"
 		"  encrypt [out_file] [in_file] [public_key_file]\n"
 		"  decrypt [out_file] [in_file] [private_key_file]\n"
 		"  homoadd [out_file] [in_file1] [in_file2] [public_key_file]\n"
-		"  homomul [out_file] [in_file] [in_constant] [public_key_file]\n";
+		"  homomul [out_file] [in_file] [in_constant] [public_key_file]\n"
+		"  djn [public_key_file]\n"
+		"  convert-public [out_file] [in_file]\n"
+		"  convert-private [out_file] [in_file]\n"
+		"  encrypt-stream [public_key_file]\n"
+		"  decrypt-stream [private_key_file]\n"
+		"  sum-stream [public_key_file]\n"
+		"  serve --socket [socket_path] [public_key_file] [private_key_file]\n";
+
+/** Number of keys generated at once by keygen-batch
+ *
+ * @ingroup Interpreter
+ */
+#define KEYGEN_BATCH_CHUNK 64
+
+/** Parse a positive integer argument
+ *
+ * @ingroup Interpreter
+ * @param[in] str input argument
+ * @param[in] name input name of the argument for error messages
+ * @return value of the argument, exits on error
+ */
+static long parse_positive(const char *str, const char *name) {
+	long value;
+	char *end_ptr;
+
+	errno = 0;
+	value = strtol(str, &end_ptr, 10);
+	if(errno != 0 || str == end_ptr || *end_ptr != '\0' || value <= 0 || value >= INT_MAX) {
+		fprintf(stderr, "incorrect %s!\n", name);
+		exit(1);
+	}
+	return value;
+}
+
+/** Generate many key pairs in parallel
+ *
+ * @ingroup Interpreter
+ * @param[in] count input number of key pairs
+ * @param[in] bitlen input bit length of the public moduli
+ * @param[in] outdir input directory where key files pub<i> and priv<i> are written
+ *
+ * The keys are generated by chunks of KEYGEN_BATCH_CHUNK, and the generation time of each key is printed to stdout.
+ */
+static void keygen_batch(long count, long bitlen, const char *outdir) {
+	paillier_public_key pub[KEYGEN_BATCH_CHUNK];
+	paillier_private_key priv[KEYGEN_BATCH_CHUNK];
+	double seconds[KEYGEN_BATCH_CHUNK], total = 0;
+	struct timespec start, end;
+	char *path;
+	long first, i, chunk;
+	FILE *fp;
+
+	path = (char *)malloc(strlen(outdir) + 32);
+	if(path == NULL) {
+		fputs("cannot allocate file name!\n", stderr);
+		exit(1);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for(first = 0; first < count; first += chunk) {
+		chunk = count - first < KEYGEN_BATCH_CHUNK ? count - first : KEYGEN_BATCH_CHUNK;
+		for(i = 0; i < chunk; i++) {
+			paillier_public_init(&pub[i]);
+			paillier_private_init(&priv[i]);
+		}
+		paillier_keygen_batch(pub, priv, chunk, bitlen, seconds);
+
+		for(i = 0; i < chunk; i++) {
+			sprintf(path, "%s/pub%ld", outdir, first + i);
+			if(!(fp = fopen(path, "w"))) {
+				fputs("not possible to write to public key file!\n", stderr);
+				exit(1);
+			}
+			paillier_public_out_str(fp, &pub[i]);
+			fclose(fp);
+
+			sprintf(path, "%s/priv%ld", outdir, first + i);
+			if(!(fp = fopen(path, "w"))) {
+				fputs("not possible to write to private key file!\n", stderr);
+				exit(1);
+			}
+			paillier_private_out_str(fp, &priv[i]);
+			fclose(fp);
+
+			printf("key %ld: %.1f ms\n", first + i, seconds[i]*1e3);
+			total += seconds[i];
+			paillier_public_clear(&pub[i]);
+			paillier_private_clear(&priv[i]);
+		}
+	}
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	printf("%ld keys in %.2f s, %.1f ms per key on average, %.1f ms of wall time per key\n", count,
+			(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9, total*1e3/count,
+			((end.tv_sec - start.tv_sec)*1e3 + (end.tv_nsec - start.tv_nsec)*1e-6)/count);
+	free(path);
+}
+
+/** Load a public key from a file in hexadecimal or binary format
+ *
+ * @ingroup Interpreter
+ * @param[out] pub output public key, already initialized
+ * @param[in] path input file name, exits on error
+ */
+static void load_public_key(paillier_public_key *pub, const char *path) {
+	FILE *fp;
+
+	if(!(fp = fopen(path, "r"))) {
+		fputs("not possible to read from public key file!\n", stderr);
+		exit(1);
+	}
+	if(paillier_public_load(pub, fp)) {
+		fputs("invalid public key file!\n", stderr);
+		exit(1);
+	}
+	fclose(fp);
+}
+
+/** Load a private key from a file in hexadecimal or binary format
+ *
+ * @ingroup Interpreter
+ * @param[out] priv output private key, already initialized
+ * @param[in] path input file name, exits on error
+ */
+static void load_private_key(paillier_private_key *priv, const char *path) {
+	FILE *fp;
+
+	if(!(fp = fopen(path, "r"))) {
+		fputs("not possible to read from private key file!\n", stderr);
+		exit(1);
+	}
+	if(paillier_private_load(priv, fp)) {
+		fputs("invalid private key file!\n", stderr);
+		exit(1);
+	}
+	fclose(fp);
+}
 
 /** Main function
  *
@@ -52,15 +190,33 @@ const char *hlp_message =
  * @param[in] argc number of arguments
  * @param[in] argv arguments
  * - keygen [public_key_file] [private_key_file] [bit length]
+ * - keygen-batch [count] [bit length] [out_dir]
  * - encrypt [out_file] [in_file] [public_key_file]
  * - decrypt [out_file] [in_file] [private_key_file]
  * - homoadd [out_file] [in_file1] [in_file2] [public_key_file]
  * - homomul [out_file] [in_file] [in_constant] [public_key_file]
+ * - djn [public_key_file]
+ * - convert-public [out_file] [in_file]
+ * - convert-private [out_file] [in_file]
+ * - encrypt-stream [public_key_file]
+ * - decrypt-stream [private_key_file]
+ * - sum-stream [public_key_file]
+ * - serve --socket [socket_path] [public_key_file] [private_key_file], the private key being optional
+ * .
+ * With --stats before the command, the statistics of the library are written to stderr when the command completes.
  */
 int main(int argc, char *argv[]) {
 	FILE *fp1, *fp2, *fp3, *fp4;
 	long bitlen;
 	char *end_ptr;
+	int stats = 0;
+
+	//statistics dump after the command
+	if(argc > 1 && strcmp(argv[1], "--stats")==0) {
+		stats = 1;
+		argc--;
+		argv++;
+	}
 
 	//key generation
 	if(argc == 5 && strcmp(argv[1], "keygen")==0) {
@@ -95,6 +251,11 @@ int main(int argc, char *argv[]) {
 		fclose(fp2);
 	}
 
+	//batch key generation
+	else if(argc == 5 && strcmp(argv[1], "keygen-batch")==0) {
+		keygen_batch(parse_positive(argv[2], "count"), parse_positive(argv[3], "bit length"), argv[4]);
+	}
+
 	//encryption
 	else if(argc == 5 && strcmp(argv[1], "encrypt")==0) {
 		//open files
@@ -110,7 +271,10 @@ int main(int argc, char *argv[]) {
 			fputs("not possible to read from public key file!\n", stderr);
 			exit(1);
 		}
-		paillier_encrypt_str(fp1, fp2, fp3);
+		if(paillier_encrypt_str(fp1, fp2, fp3)) {
+			fputs("encryption failed!\n", stderr);
+			exit(1);
+		}
 		fclose(fp1);
 		fclose(fp2);
 		fclose(fp3);
@@ -131,7 +295,10 @@ int main(int argc, char *argv[]) {
 			fputs("not possible to read from private key file!\n", stderr);
 			exit(1);
 		}
-		paillier_decrypt_str(fp1, fp2, fp3);
+		if(paillier_decrypt_str(fp1, fp2, fp3)) {
+			fputs("decryption failed!\n", stderr);
+			exit(1);
+		}
 		fclose(fp1);
 		fclose(fp2);
 		fclose(fp3);
@@ -156,7 +323,10 @@ int main(int argc, char *argv[]) {
 			fputs("not possible to read from public key file!\n", stderr);
 			exit(1);
 		}
-		paillier_homomorphic_add_str(fp1, fp2, fp3, fp4);
+		if(paillier_homomorphic_add_str(fp1, fp2, fp3, fp4)) {
+			fputs("homomorphic addition failed!\n", stderr);
+			exit(1);
+		}
 		fclose(fp1);
 		fclose(fp2);
 		fclose(fp3);
@@ -181,14 +351,122 @@ int main(int argc, char *argv[]) {
 			fputs("not possible to read from public key file!\n", stderr);
 			exit(1);
 		}
-		paillier_homomorphic_multc_str(fp1, fp2, fp3, fp4);
+		if(paillier_homomorphic_multc_str(fp1, fp2, fp3, fp4)) {
+			fputs("homomorphic multiplication failed!\n", stderr);
+			exit(1);
+		}
 		fclose(fp1);
 		fclose(fp2);
 		fclose(fp3);
 		fclose(fp4);
 	}
+
+	//add h_s to public key for Damgard-Jurik-Nielsen encryption
+	else if(argc == 3 && strcmp(argv[1], "djn")==0) {
+		paillier_public_key pub;
+		char *tmp_path;
+		int binary, result;
+
+		//keep the format of the key file
+		if(!(fp1 = fopen(argv[2], "r"))) {
+			fputs("not possible to read from public key file!\n", stderr);
+			exit(1);
+		}
+		binary = getc(fp1) == PAILLIER_BIN_MAGIC[0];
+		fclose(fp1);
+		paillier_public_init(&pub);
+		load_public_key(&pub, argv[2]);
+
+		if(paillier_djn_setup(&pub)) {
+			fputs("cannot generate h_s!\n", stderr);
+			exit(1);
+		}
+
+		//write to a temporary file, and replace the key file only once it is complete
+		tmp_path = (char *)malloc(strlen(argv[2]) + 5);
+		if(tmp_path == NULL) {
+			fputs("cannot allocate file name!\n", stderr);
+			exit(1);
+		}
+		sprintf(tmp_path, "%s.tmp", argv[2]);
+		if(!(fp1 = fopen(tmp_path, "w"))) {
+			fputs("not possible to write to temporary key file!\n", stderr);
+			exit(1);
+		}
+		result = binary ? paillier_public_out_bin(fp1, &pub) : paillier_public_out_str(fp1, &pub);
+		if(fclose(fp1) || result < 0 || rename(tmp_path, argv[2])) {
+			fputs("not possible to write to public key file!\n", stderr);
+			remove(tmp_path);
+			exit(1);
+		}
+		free(tmp_path);
+		paillier_public_clear(&pub);
+	}
+
+	//conversion of keys between hexadecimal and binary formats
+	else if(argc == 4 && (strcmp(argv[1], "convert-public")==0 || strcmp(argv[1], "convert-private")==0)) {
+		if(!(fp1 = fopen(argv[2], "w"))) {
+			fputs("not possible to write to output key file!\n", stderr);
+			exit(1);
+		}
+		if(!(fp2 = fopen(argv[3], "r"))) {
+			fputs("not possible to read from input key file!\n", stderr);
+			exit(1);
+		}
+		if((strcmp(argv[1], "convert-public")==0 ? paillier_public_convert_str(fp1, fp2) : paillier_private_convert_str(fp1, fp2))) {
+			fputs("invalid key file!\n", stderr);
+			exit(1);
+		}
+		fclose(fp1);
+		fclose(fp2);
+	}
+
+	//streaming encryption, decryption and homomorphic sum from stdin to stdout
+	else if(argc == 3 && (strcmp(argv[1], "encrypt-stream")==0 || strcmp(argv[1], "sum-stream")==0)) {
+		paillier_public_key pub;
+		int result;
+
+		paillier_public_init(&pub);
+		load_public_key(&pub, argv[2]);
+		if(strcmp(argv[1], "encrypt-stream")==0) {
+			result = paillier_encrypt_stream(stdout, stdin, &pub, 0);
+		}
+		else {
+			result = paillier_sum_stream(stdout, stdin, &pub, 0);
+		}
+		paillier_public_clear(&pub);
+		if(result) exit(1);
+	}
+	else if(argc == 3 && strcmp(argv[1], "decrypt-stream")==0) {
+		paillier_private_key priv;
+		int result;
+
+		paillier_private_init(&priv);
+		load_private_key(&priv, argv[2]);
+		result = paillier_decrypt_stream(stdout, stdin, &priv, 0);
+		paillier_private_clear(&priv);
+		if(result) exit(1);
+	}
+
+	//server with resident keys
+	else if((argc == 5 || argc == 6) && strcmp(argv[1], "serve")==0 && strcmp(argv[2], "--socket")==0) {
+		paillier_public_key pub;
+		paillier_private_key priv;
+
+		paillier_public_init(&pub);
+		paillier_private_init(&priv);
+		load_public_key(&pub, argv[4]);
+		if(argc == 6) load_private_key(&priv, argv[5]);
+		if(paillier_serve(argv[3], &pub, argc == 6 ? &priv : NULL)) {
+			fputs("cannot listen on socket!\n", stderr);
+			exit(1);
+		}
+		paillier_public_clear(&pub);
+		paillier_private_clear(&priv);
+	}
 	else {
 		fputs(hlp_message, stderr);
 	}
+	if(stats) paillier_stats_out_str(stderr);
 	return 0;
 }
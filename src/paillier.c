@@ -24,8 +24,13 @@
  */
 
 #include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include <stdatomic.h>
+#include <time.h>
 #include "../include/paillier.h"
 #include "tools.h"
+#include "thread_pool.h"
 
 /** Function L(u)=(u-1)/n
  *
@@ -56,47 +61,57 @@ int paillier_ell(mpz_t result, mpz_t input, mpz_t ninv, mp_bitcnt_t len) {
 	return 0;
 }
 
-/**
- * The function does the following.
- * - It generates two (probable) primes p and q having bits/2 bits.
- * - It computes the modulus n=p*q and sets the basis g to 1+n.
- * - It pre-computes n^{-1} mod 2^len.
- * - It pre-computes the CRT paramter p^{-2} mod q^2.
- * - It calculates lambda = lcm((p-1)*(q-1))
- * - It calculates mu = L(g^lambda mod n^2)^{-1} mod n using the CRT.
- * .
- * Since /dev/random is one of the sources of randomness in prime generation, the program may block.
- * In that case, you have to wait or move your mouse to feed /dev/random with fresh randomness.
+/** Function L_p(u)=(u-1)/p
+ *
+ * @ingroup Paillier
+ * @param[out] result output result (u-1)/p
+ * @param[in] input u
+ * @param[in] p input prime p
+ * @return 0 if no error
+ *
+ * Since u = 1 mod p, the division is exact.
  */
-int paillier_keygen(paillier_public_key *pub, paillier_private_key *priv, mp_bitcnt_t len) {
-	mpz_t p, q, n2, temp, mask, g;
+int paillier_ell_prime(mpz_t result, const mpz_t input, const mpz_t p) {
+	mpz_sub_ui(result, input, 1);
+	mpz_divexact(result, result, p);
+	return 0;
+}
+
+/** Key generation
+ *
+ * @ingroup Paillier
+ * @param[out] pub output public key
+ * @param[out] priv output private key
+ * @param[in] len input bit length of public modulus
+ * @param[in] sequential input if nonzero, the primes are generated in the calling thread instead of the thread pool
+ * @return 0 if no error
+ */
+static int keygen(paillier_public_key *pub, paillier_private_key *priv, mp_bitcnt_t len, int sequential) {
+	mpz_t p, q, temp;
 
 	mpz_init(p);
 	mpz_init(q);
-	mpz_init(n2);
 	mpz_init(temp);
-	mpz_init(mask);
-	mpz_init(g);
 
 	//write bit lengths
 	priv->len = len;
 	pub->len = len;
 
 	//generate p and q
-	DEBUG_MSG("generating prime p\n");
-	gen_prime(p, len/2);
-	DEBUG_MSG("generating prime q\n");
-	gen_prime(q, len/2);
+	DEBUG_MSG("generating primes p and q\n");
+	if(sequential) {
+		gen_prime_sequential(p, len/2);
+		gen_prime_sequential(q, len/2);
+	}
+	else {
+		gen_prime_pair(p, q, len/2);
+	}
 
 	//calculate modulus n=p*q
 	DEBUG_MSG("calculating modulus n=p*q\n");
 	mpz_mul(pub->n, p, q);
 	mpz_mul(priv->n, p, q);
 
-	//set g = 1+n
-	DEBUG_MSG("calculating basis g=1+n\n");
-	mpz_add_ui(g, pub->n, 1);
-
 	//compute n^{-1} mod 2^{len}
 	DEBUG_MSG("computing modular inverse n^{-1} mod 2^{len}\n");
 	mpz_setbit(temp, len);
@@ -104,10 +119,7 @@ int paillier_keygen(paillier_public_key *pub, paillier_private_key *priv, mp_bit
 		fputs("Inverse does not exist!\n", stderr);
 		mpz_clear(p);
 		mpz_clear(q);
-		mpz_clear(n2);
 		mpz_clear(temp);
-		mpz_clear(mask);
-		mpz_clear(g);
 		exit(1);
 	}
 
@@ -119,29 +131,25 @@ int paillier_keygen(paillier_public_key *pub, paillier_private_key *priv, mp_bit
 	DEBUG_MSG("calculating CRT parameter p^{-2} mod q^2\n");
 	mpz_invert(priv->p2invq2, priv->p2, priv->q2);
 
+	//store p and q and generate parameters for decryption modulo p and q
+	DEBUG_MSG("calculating CRT parameters p^{-1} mod q, h_p and h_q\n");
+	mpz_set(priv->p, p);
+	mpz_set(priv->q, q);
+	paillier_private_crt_init(priv);
+
 	//calculate lambda = lcm(p-1,q-1)
 	DEBUG_MSG("calculating lambda=lcm((p-1)*(q-1))\n");
 	mpz_clrbit(p, 0);
 	mpz_clrbit(q, 0);
 	mpz_lcm(priv->lambda, p, q);
 
-	//calculate n^2
-	mpz_mul(n2, pub->n, pub->n);
-
-	//calculate mu
+	//calculate mu = L(g^lambda mod n^2)^{-1} = lambda^{-1} mod n, since g^lambda = 1+lambda*n mod n^2
 	DEBUG_MSG("calculating mu\n");
-	crt_exponentiation(temp, g, priv->lambda, priv->lambda, priv->p2invq2, priv->p2, priv->q2);
-
-	paillier_ell(temp, temp, priv->ninv, len);
-
-	if(!mpz_invert(priv->mu, temp, pub->n)) {
+	if(!mpz_invert(priv->mu, priv->lambda, pub->n)) {
 		fputs("Inverse does not exist!\n", stderr);
 		mpz_clear(p);
 		mpz_clear(q);
-		mpz_clear(n2);
 		mpz_clear(temp);
-		mpz_clear(mask);
-		mpz_clear(g);
 		exit(1);
 	}
 
@@ -149,66 +157,648 @@ int paillier_keygen(paillier_public_key *pub, paillier_private_key *priv, mp_bit
 	DEBUG_MSG("freeing memory\n");
 	mpz_clear(p);
 	mpz_clear(q);
-	mpz_clear(n2);
 	mpz_clear(temp);
-	mpz_clear(mask);
-	mpz_clear(g);
 	DEBUG_MSG("exiting\n");
 	return 0;
 }
 
 /**
- * The function calculates c=g^m*r^n mod n^2 with r random number.
+ * The function does the following.
+ * - It generates two (probable) primes p and q having bits/2 bits.
+ * - It computes the modulus n=p*q, the basis g being 1+n.
+ * - It pre-computes n^{-1} mod 2^len.
+ * - It pre-computes the CRT paramter p^{-2} mod q^2.
+ * - It calculates h_p = L_p(g^{p-1} mod p^2)^{-1} mod p and h_q = L_q(g^{q-1} mod q^2)^{-1} mod q.
+ * - It calculates lambda = lcm((p-1)*(q-1))
+ * - It calculates mu = L(g^lambda mod n^2)^{-1} mod n.
+ * .
+ * Since g=1+n, g^lambda = 1+lambda*n mod n^2 and mu is simply lambda^{-1} mod n: no exponentiation is needed.
+ * For the same reason, h_p and h_q are computed without exponentiation.
+ * The primes p and q are searched in parallel, each search sieving candidates with small primes and spreading the probable-prime tests over the thread pool.
+ * The randomness of prime generation comes from a generator seeded with getrandom(), which does not block.
+ */
+int paillier_keygen(paillier_public_key *pub, paillier_private_key *priv, mp_bitcnt_t len) {
+	return keygen(pub, priv, len, 0);
+}
+
+/** Arguments of a key generation task
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	paillier_public_key *pub;	/**< generated public key */
+	paillier_private_key *priv;	/**< generated private key */
+	mp_bitcnt_t len;			/**< bit length of the modulus */
+	double *seconds;			/**< generation time, NULL if not measured */
+} keygen_args;
+
+/** Key generation as a task of the thread pool
+ *
+ * @ingroup Paillier
+ */
+static void do_keygen(void *args) {
+	keygen_args *args_struct = (keygen_args *)args;
+	struct timespec start, end;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	keygen(args_struct->pub, args_struct->priv, args_struct->len, 1);
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	if(args_struct->seconds != NULL) {
+		*args_struct->seconds = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec)*1e-9;
+	}
+}
+
+/**
+ * Each key is generated by one task of the thread pool, with its primes searched in that task only,
+ * so that keys are generated in parallel and the measured time of a key does not include the work on other keys.
+ */
+int paillier_keygen_batch(paillier_public_key *pub, paillier_private_key *priv, size_t count, mp_bitcnt_t len, double *seconds) {
+	keygen_args *args;
+	task_group group;
+	size_t i;
+
+	args = (keygen_args *)malloc(sizeof(keygen_args)*(count ? count : 1));
+	if(args == NULL) return -1;
+
+	DEBUG_MSG("generating keys\n");
+	task_group_init(&group);
+	for(i = 0; i < count; i++) {
+		args[i].pub = &pub[i];
+		args[i].priv = &priv[i];
+		args[i].len = len;
+		args[i].seconds = seconds != NULL ? &seconds[i] : NULL;
+		thread_pool_submit(&group, do_keygen, (void *)&args[i]);
+	}
+	task_group_wait(&group);
+
+	free(args);
+	return 0;
+}
+
+/**
+ * h=-x^2 mod n is a random element of the subgroup of Z*_n with Jacobi symbol 1,
+ * and h_s^alpha mod n^2 = (h^alpha)^n mod n^2 is a valid random factor r^n mod n^2.
+ */
+int paillier_djn_setup(paillier_public_key *pub) {
+	mpz_t x, n2;
+
+	mpz_init(x);
+	mpz_init(n2);
+
+	//generate random x and compute h = -x^2 mod n
+	DEBUG_MSG("generating h=-x^2 mod n\n");
+	do {
+		if(gen_pseudorandom(x, pub->len)) {
+			mpz_clear(x);
+			mpz_clear(n2);
+			return -1;
+		}
+		mpz_mod(x, x, pub->n);
+	} while(mpz_cmp_ui(x, 0) == 0);
+	mpz_mul(x, x, x);
+	mpz_neg(x, x);
+	mpz_mod(x, x, pub->n);
+
+	//compute h_s = h^n mod n^2
+	DEBUG_MSG("computing h_s=h^n mod n^2\n");
+	mpz_mul(n2, pub->n, pub->n);
+	mpz_powm(pub->hs, x, pub->n, n2);
+
+	mpz_clear(x);
+	mpz_clear(n2);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/** Check that a ciphertext is in the range of the fixed-width functions
+ *
+ * @ingroup Paillier
+ * @param[in] c input ciphertext
+ * @param[in] n input modulus n
+ * @return 1 if 0 < c < n^2, 0 otherwise
+ *
+ * n^2 is only computed when c has as many bits as n^2.
+ */
+static int ciphertext_valid(mpz_srcptr c, mpz_srcptr n) {
+	size_t bits = 2*mpz_sizeinbase(n, 2), cbits;
+	mpz_t n2;
+	int valid;
+
+	if(mpz_sgn(c) <= 0) return 0;
+	cbits = mpz_sizeinbase(c, 2);
+	if(cbits < bits - 1) return 1;
+	if(cbits > bits) return 0;
+	mpz_init(n2);
+	mpz_mul(n2, n, n);
+	valid = mpz_cmp(c, n2) < 0;
+	mpz_clear(n2);
+	return valid;
+}
+
+/** Copy a number to a fixed number of limbs
+ *
+ * @ingroup Paillier
+ * @param[out] dest output limbs, zero-padded
+ * @param[in] src input number, at most k limbs
+ * @param[in] k input number of limbs
+ */
+static void copy_limbs(mp_ptr dest, mpz_srcptr src, mp_size_t k) {
+	mp_size_t size = mpz_size(src);
+
+	assert(size <= k);
+	mpn_copyi(dest, mpz_limbs_read(src), size);
+	mpn_zero(dest + size, k - size);
+}
+
+/** Set a number from a fixed number of limbs
+ *
+ * @ingroup Paillier
+ * @param[out] dest output number
+ * @param[in] src input limbs
+ * @param[in] k input number of limbs
+ */
+static void set_limbs(mpz_ptr dest, mp_srcptr src, mp_size_t k) {
+	mpn_copyi(mpz_limbs_write(dest, k), src, k);
+	mpz_limbs_finish(dest, k);
+}
+
+/**
+ * The function calculates c=g^m*r^n mod n^2 with r random number, and the plaintext is reduced modulo n.
  * Encryption benefits from the fact that g=1+n, because (1+n)^m = 1+n*m mod n^2.
+ * If the public key has h_s, r^n mod n^2 is replaced by h_s^alpha mod n^2 with a random alpha of len/2 bits.
+ * The plaintext and ciphertext are copied to and from fixed-width limbs, and the computation is done by paillier_core_encrypt.
  */
 int paillier_encrypt(mpz_t ciphertext, mpz_t plaintext, paillier_public_key *pub) {
-	mpz_t n2, r;
+	mp_size_t k, kn;
+	mp_limb_t *limbs;
+	int result = 0;
+
+	k = paillier_core_limbs(pub);
+	kn = mpz_size(pub->n);
+	limbs = (mp_limb_t *)malloc(sizeof(mp_limb_t)*(k + kn + paillier_core_scratch_limbs(pub)));
+	if(limbs == NULL) return -1;
+
+	//plaintext modulo n
+	if(mpz_sgn(plaintext) < 0 || mpz_cmp(plaintext, pub->n) >= 0) {
+		mpz_mod(ciphertext, plaintext, pub->n);
+		copy_limbs(limbs + k, ciphertext, kn);
+	}
+	else {
+		copy_limbs(limbs + k, plaintext, kn);
+	}
+
+	result = paillier_core_encrypt(limbs, limbs + k, pub, limbs + k + kn);
+	if(result == 0) set_limbs(ciphertext, limbs, k);
 
-	if(mpz_cmp(pub->n, plaintext)) {
-		mpz_init(n2);
-		mpz_init(r);
+	DEBUG_MSG("freeing memory\n");
+	free(limbs);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
 
-		//re-compute n^2
-		mpz_mul(n2, pub->n, pub->n);
+/**
+ * Without h_s, a random r is reduced modulo n and r^n mod n^2 is computed.
+ * With h_s, a random alpha of len/2 bits is generated, and h_s^alpha mod n^2 is computed with the fixed-base table:
+ * alpha is split in windows of w bits, and the table entry of each non-zero window is multiplied to the result.
+ */
+int gen_noise(mpz_t rn, paillier_public_ctx *ctx, mpz_t r, mpz_t t) {
+	size_t i;
+	mp_bitcnt_t bit;
+	unsigned int shift;
+	mp_limb_t digit;
 
+	if(ctx->table == NULL) {
 		DEBUG_MSG("generating random number\n");
 		//generate random r and reduce modulo n
-		gen_pseudorandom(r, pub->len);
-		mpz_mod(r, r, pub->n);
+		if(gen_pseudorandom(r, ctx->len)) return -1;
+		mpz_mod(r, r, ctx->n);
 		if(mpz_cmp_ui(r, 0) == 0) {
 			fputs("random number is zero!\n", stderr);
-			mpz_clear(n2);
-			mpz_clear(r);
 			exit(1);
 		}
 
-		DEBUG_MSG("computing ciphertext\n");
 		//compute r^n mod n2
-		mpz_powm(ciphertext, r, pub->n, n2);
+		mpz_powm(rn, r, ctx->n, ctx->n2);
+		return 0;
+	}
 
-		//compute (1+m*n)
-		mpz_mul(r, plaintext, pub->n);
-		mpz_add_ui(r, r, 1);
+	DEBUG_MSG("generating random exponent\n");
+	if(gen_pseudorandom(r, ctx->alpha_len)) return -1;
 
-		//multiply with (1+m*n)
-		mpz_mul(ciphertext, ciphertext, r);
-		mpz_mod(ciphertext, ciphertext, n2);
+	//compute h_s^alpha mod n^2 as a product of table entries
+	mpz_set_ui(rn, 1);
+	for(i = 0; i < ctx->windows; i++) {
+		bit = i*ctx->window;
+		shift = bit % GMP_NUMB_BITS;
+		digit = mpz_getlimbn(r, bit/GMP_NUMB_BITS) >> shift;
+		//window straddling two limbs
+		if(shift + ctx->window > GMP_NUMB_BITS) {
+			digit |= mpz_getlimbn(r, bit/GMP_NUMB_BITS + 1) << (GMP_NUMB_BITS - shift);
+		}
+		digit &= ((mp_limb_t)1 << ctx->window) - 1;
+		if(digit) {
+			mpz_mul(t, rn, ctx->table[i*((1UL << ctx->window) - 1) + digit - 1]);
+			mpz_mod(rn, t, ctx->n2);
+		}
+	}
+	return 0;
+}
 
-		DEBUG_MSG("freeing memory\n");
-		mpz_clear(n2);
+/**
+ * Plaintexts out of range are reduced modulo n, as in paillier_encrypt: n itself is encrypted as 0.
+ */
+void plaintext_factor(mpz_t result, mpz_t plaintext, paillier_public_ctx *ctx) {
+	if(mpz_sgn(plaintext) < 0 || mpz_cmp(plaintext, ctx->n) >= 0) {
+		mpz_mod(result, plaintext, ctx->n);
+		mpz_mul(result, result, ctx->n);
+	}
+	else {
+		mpz_mul(result, plaintext, ctx->n);
+	}
+	mpz_add_ui(result, result, 1);
+}
+
+/** Encrypt with public key context and scratch variables
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertext output ciphertext c=g^m*r^n mod n^2
+ * @param[in] plaintext input plaintext m
+ * @param[in] ctx input public key context, only read
+ * @param[in,out] r input scratch variable for the random number
+ * @param[in,out] t input scratch variable for the product
+ * @return 0 if no error
+ *
+ * Several threads can share the same context as long as they have their own scratch variables.
+ */
+static int encrypt_scratch(mpz_t ciphertext, mpz_t plaintext, paillier_public_ctx *ctx, mpz_t r, mpz_t t) {
+	STATS_START(start);
+	DEBUG_MSG("computing ciphertext\n");
+	//compute r^n mod n2
+	if(gen_noise(ciphertext, ctx, r, t)) return -1;
+
+	//compute (1+m*n)
+	plaintext_factor(r, plaintext, ctx);
+
+	//multiply with (1+m*n)
+	mpz_mul(t, ciphertext, r);
+	mpz_mod(ciphertext, t, ctx->n2);
+	STATS_STOP(PAILLIER_STAT_ENCRYPT, start);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/**
+ * Same as paillier_encrypt, but n^2 is taken from the context and intermediate values are stored
+ * in the pre-allocated scratch variables of the context.
+ * @see paillier_encrypt
+ */
+int paillier_encrypt_ctx(mpz_t ciphertext, mpz_t plaintext, paillier_public_ctx *ctx) {
+	return encrypt_scratch(ciphertext, plaintext, ctx, ctx->r, ctx->t);
+}
+
+/** Re-randomize with public key context and scratch variables
+ *
+ * @ingroup Paillier
+ * @param[out] output output ciphertext c*r^n mod n^2, may be the input ciphertext
+ * @param[in] ciphertext input ciphertext c
+ * @param[in] ctx input public key context, only read
+ * @param[in,out] rn input scratch variable for the random factor
+ * @param[in,out] r input scratch variable for the random number
+ * @param[in,out] t input scratch variable for the product
+ * @return 0 if no error
+ */
+static int rerandomize_scratch(mpz_t output, mpz_t ciphertext, paillier_public_ctx *ctx, mpz_t rn, mpz_t r, mpz_t t) {
+	DEBUG_MSG("computing random factor\n");
+	if(gen_noise(rn, ctx, r, t)) return -1;
+
+	//multiply with the random factor
+	mpz_mul(t, ciphertext, rn);
+	mpz_mod(output, t, ctx->n2);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/**
+ * The random factor is computed by gen_noise, with the fixed-base table of the context if the public key has h_s.
+ */
+int paillier_rerandomize(mpz_t output, mpz_t ciphertext, paillier_public_ctx *ctx) {
+	mpz_t rn;
+	int result;
+
+	mpz_init2(rn, ctx->len2);
+	result = rerandomize_scratch(output, ciphertext, ctx, rn, ctx->r, ctx->t);
+	mpz_clear(rn);
+	return result;
+}
+
+/**
+ * The value r^n mod p^2 only depends on r mod p, and since x -> x^q is a permutation of Z*_p,
+ * it has the same distribution as s^p mod p^2 for a random s. The same holds modulo q^2.
+ * The random factor is therefore computed by crt_exponentiation with the exponents p and q, half as long as n,
+ * modulo p^2 and q^2 in parallel, and recombined modulo n^2 with p^{-2} mod q^2.
+ * Private keys without p and q use the exponent n modulo p^2 and q^2.
+ */
+int paillier_encrypt_priv(mpz_t ciphertext, mpz_t plaintext, paillier_private_key *priv) {
+	mpz_t r, t, n2;
+
+	mpz_init(r);
+	mpz_init(t);
+	mpz_init(n2);
+	STATS_START(start);
+
+	DEBUG_MSG("generating random number\n");
+	//generate random s and reduce modulo n
+	if(gen_pseudorandom(r, priv->len)) {
 		mpz_clear(r);
+		mpz_clear(t);
+		mpz_clear(n2);
+		return -1;
+	}
+	mpz_mod(r, r, priv->n);
+	if(mpz_cmp_ui(r, 0) == 0) {
+		fputs("random number is zero!\n", stderr);
+		exit(1);
 	}
+
+	DEBUG_MSG("computing random factor with CRT\n");
+	if(mpz_sgn(priv->p) != 0) {
+		//s^p mod p^2 and s^q mod q^2
+		crt_exponentiation(r, r, priv->p, priv->q, priv->p2invq2, priv->p2, priv->q2);
+	}
+	else {
+		//s^n mod p^2 and s^n mod q^2
+		crt_exponentiation(r, r, priv->n, priv->n, priv->p2invq2, priv->p2, priv->q2);
+	}
+
+	DEBUG_MSG("computing ciphertext\n");
+	//compute (1+m*n)
+	mpz_mod(t, plaintext, priv->n);
+	mpz_mul(t, t, priv->n);
+	mpz_add_ui(t, t, 1);
+
+	//multiply with the random factor
+	mpz_mul(n2, priv->n, priv->n);
+	mpz_mul(t, t, r);
+	mpz_mod(ciphertext, t, n2);
+	STATS_STOP(PAILLIER_STAT_ENCRYPT, start);
+
+	DEBUG_MSG("freeing memory\n");
+	mpz_clear(r);
+	mpz_clear(t);
+	mpz_clear(n2);
 	DEBUG_MSG("exiting\n");
 	return 0;
 }
 
+/** Number of chunks for splitting a batch operation
+ *
+ * @ingroup Paillier
+ * @param[in] count input number of elements in the batch
+ * @return number of chunks, a few per worker thread for balancing the load
+ */
+static size_t batch_chunks(size_t count) {
+	size_t nchunks = 4*(size_t)thread_pool_size();
+
+	return count < nchunks ? count : nchunks;
+}
+
+/** Chunk of a batch encryption
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	mpz_t *ciphertexts; /**< output ciphertexts of the chunk */
+	mpz_t *plaintexts; /**< input plaintexts of the chunk, or ciphertexts to be re-randomized */
+	size_t count; /**< number of elements in the chunk */
+	paillier_public_ctx *ctx; /**< public key context shared by all chunks */
+	int rerandomize; /**< set if the inputs are ciphertexts to be re-randomized */
+	int result; /**< -1 if an element of the chunk failed */
+} encrypt_chunk;
+
+/** Encrypt a chunk of a batch
+ *
+ * @ingroup Paillier
+ * @param[in,out] args pointer to an encrypt_chunk
+ *
+ * Intended to be run as a task of the thread pool, with its own scratch variables.
+ */
+static void do_encrypt_chunk(void *args) {
+	encrypt_chunk *chunk = (encrypt_chunk *)args;
+	mpz_t rn, r, t;
+	size_t i;
+
+	mpz_init2(rn, chunk->ctx->len2);
+	mpz_init2(r, 2*chunk->ctx->len2 + GMP_NUMB_BITS);
+	mpz_init2(t, 2*chunk->ctx->len2 + GMP_NUMB_BITS);
+
+	chunk->result = 0;
+	for(i = 0; i < chunk->count && chunk->result == 0; i++) {
+		if(chunk->rerandomize) {
+			chunk->result = rerandomize_scratch(chunk->ciphertexts[i], chunk->plaintexts[i], chunk->ctx, rn, r, t);
+		}
+		else {
+			chunk->result = encrypt_scratch(chunk->ciphertexts[i], chunk->plaintexts[i], chunk->ctx, r, t);
+		}
+	}
+
+	mpz_clear(rn);
+	mpz_clear(r);
+	mpz_clear(t);
+}
+
+/** Encrypt or re-randomize a batch with a public key context
+ *
+ * @ingroup Paillier
+ * @param[out] outputs output array of ciphertexts, already initialized
+ * @param[in] inputs input array of plaintexts, or of ciphertexts to be re-randomized
+ * @param[in] count input number of elements
+ * @param[in] ctx input public key context, only read
+ * @param[in] rerandomize input set if the inputs are ciphertexts to be re-randomized
+ * @return 0 if no error
+ *
+ * The batch is split in a few chunks per worker thread of the pool, and each chunk has its own scratch variables,
+ * so that the context is only read.
+ */
+static int encrypt_batch_run(mpz_t *outputs, mpz_t *inputs, size_t count, paillier_public_ctx *ctx, int rerandomize) {
+	encrypt_chunk *chunks;
+	task_group group;
+	size_t nchunks, i, start, end;
+	int result = 0;
+
+	if(count == 0) return 0;
+
+	nchunks = batch_chunks(count);
+	chunks = (encrypt_chunk *)malloc(sizeof(encrypt_chunk)*nchunks);
+	if(chunks == NULL) return -1;
+
+	DEBUG_MSG("encrypting batch\n");
+	task_group_init(&group);
+	for(i = 0; i < nchunks; i++) {
+		start = count*i/nchunks;
+		end = count*(i+1)/nchunks;
+		chunks[i].ciphertexts = outputs + start;
+		chunks[i].plaintexts = inputs + start;
+		chunks[i].count = end - start;
+		chunks[i].ctx = ctx;
+		chunks[i].rerandomize = rerandomize;
+		thread_pool_submit(&group, do_encrypt_chunk, (void *)&chunks[i]);
+	}
+	task_group_wait(&group);
+	for(i = 0; i < nchunks; i++) {
+		if(chunks[i].result) result = -1;
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	free(chunks);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
+
+/**
+ * The public key context is computed once and shared by all chunks.
+ * @see paillier_encrypt_batch_ctx
+ */
+int paillier_encrypt_batch(mpz_t *ciphertexts, mpz_t *plaintexts, size_t count, paillier_public_key *pub) {
+	paillier_public_ctx ctx;
+	int result;
+
+	if(count == 0) return 0;
+
+	paillier_public_ctx_init(&ctx, pub);
+	result = paillier_encrypt_batch_ctx(ciphertexts, plaintexts, count, &ctx);
+	paillier_public_ctx_clear(&ctx);
+	return result;
+}
+
+/**
+ * @see encrypt_batch_run
+ */
+int paillier_encrypt_batch_ctx(mpz_t *ciphertexts, mpz_t *plaintexts, size_t count, paillier_public_ctx *ctx) {
+	return encrypt_batch_run(ciphertexts, plaintexts, count, ctx, 0);
+}
+
+/**
+ * @see encrypt_batch_run
+ */
+int paillier_rerandomize_batch(mpz_t *outputs, mpz_t *ciphertexts, size_t count, paillier_public_ctx *ctx) {
+	return encrypt_batch_run(outputs, ciphertexts, count, ctx, 1);
+}
+
+/** Branch modulo p or modulo q of CRT decryptions
+ *
+ * @ingroup Paillier
+ *
+ * Arguments for computing m_p = L_p(c^{p-1} mod p^2)*h_p mod p for several ciphertexts.
+ * The same structure is used modulo q. The operands are not copied, they point to the variables of the caller.
+ */
+typedef struct {
+	mp_limb_t *results; /**< output m_p for each ciphertext, size limbs each */
+	mp_size_t size; /**< number of limbs of p */
+	mpz_t *ciphertexts; /**< input ciphertexts */
+	size_t count; /**< number of ciphertexts */
+	mpz_srcptr exponent; /**< exponent p-1 */
+	mpz_srcptr prime; /**< prime p */
+	mpz_srcptr prime2; /**< square p^2 */
+	mpz_srcptr h; /**< h_p */
+	unsigned int stat; /**< statistics probe of the branch */
+	int status; /**< -1 if a ciphertext is a multiple of p */
+} decrypt_branch;
+
+/** Compute a branch of CRT decryptions
+ *
+ * @ingroup Paillier
+ * @param[in,out] args pointer to a decrypt_branch
+ *
+ * Intended to be run as a task of the thread pool, with its own scratch variable.
+ * The result of a ciphertext that is a multiple of p is set to 0 and the branch fails.
+ */
+static void do_decrypt_branch(void *args) {
+	decrypt_branch *branch = (decrypt_branch *)args;
+	mpz_t t;
+	size_t i;
+
+	mpz_init2(t, 2*mpz_sizeinbase(branch->prime2, 2) + GMP_NUMB_BITS);
+	branch->status = 0;
+	for(i = 0; i < branch->count; i++) {
+		STATS_START(start);
+		//compute c^{p-1} mod p^2, for c coprime to p
+		mpz_mod(t, branch->ciphertexts[i], branch->prime2);
+		if(mpz_divisible_p(t, branch->prime)) {
+			mpz_set_ui(t, 0);
+			branch->status = -1;
+		}
+		else {
+			mpz_powm(t, t, branch->exponent, branch->prime2);
+
+			//compute L_p(c^{p-1} mod p^2)*h_p mod p
+			paillier_ell_prime(t, t, branch->prime);
+			mpz_mul(t, t, branch->h);
+			mpz_mod(t, t, branch->prime);
+		}
+		copy_limbs(branch->results + i*branch->size, t, branch->size);
+		STATS_STOP(branch->stat, start);
+	}
+	mpz_clear(t);
+}
+
+/** CRT recombination of the plaintext
+ *
+ * @ingroup Paillier
+ * @param[out] plaintext output plaintext m = m_p + p*(p^{-1} mod q)*(m_q-m_p) mod n
+ * @param[in] mp input plaintext modulo p
+ * @param[in] mq input plaintext modulo q, overwritten
+ * @param[in] priv input private key
+ */
+static void decrypt_recombine(mpz_t plaintext, mpz_t mp, mpz_t mq, paillier_private_key *priv) {
+	STATS_START(start);
+	mpz_sub(mq, mq, mp);
+	mpz_mul(mq, mq, priv->pinvq);
+	mpz_mod(mq, mq, priv->q);
+	mpz_mul(mq, mq, priv->p);
+	mpz_add(plaintext, mq, mp);
+	STATS_STOP(PAILLIER_STAT_RECOMBINE, start);
+}
+
 /**
- * The decryption function computes m = L(c^lambda mod n^2)*mu mod n.
+ * If the private key has the parameters p, q, h_p and h_q, the decryption follows Paillier's original CRT method:
+ * - m_p = L_p(c^{p-1} mod p^2)*h_p mod p
+ * - m_q = L_q(c^{q-1} mod q^2)*h_q mod q
+ * - Recombination: m = m_p + p*(p^{-1} mod q)*(m_q-m_p) mod n
+ * .
+ * The exponents p-1 and q-1 are half as long as lambda, and exponentiations mod p^2 and q^2 run in their own thread.
+ * The ciphertext and plaintext are copied to and from fixed-width limbs, and the computation is done by paillier_core_decrypt.
+ * Note that reducing lambda modulo p(p-1) and q(q-1), the orders of Z*_{p^2} and Z*_{q^2}, would not help:
+ * the reduced exponents are still about as long as n, whereas p-1 and q-1 are half as long.
+ *
+ * Otherwise, the decryption function computes m = L(c^lambda mod n^2)*mu mod n.
  * The exponentiation is calculated using the CRT, and exponentiations mod p^2 and q^2 run in their own thread.
  *
  */
 int paillier_decrypt(mpz_t plaintext, mpz_t ciphertext, paillier_private_key *priv) {
+	mp_size_t k = BIT2LIMB(2*mpz_sizeinbase(priv->n, 2)), kn;
+	mp_limb_t *limbs;
+	int result;
+
+	if(!ciphertext_valid(ciphertext, priv->n)) return -1;
+	if(mpz_sgn(priv->p) != 0) {
+		kn = mpz_size(priv->n);
+		limbs = (mp_limb_t *)malloc(sizeof(mp_limb_t)*(k + kn + paillier_core_decrypt_scratch_limbs(priv)));
+		if(limbs == NULL) return -1;
+
+		copy_limbs(limbs, ciphertext, k);
+		result = paillier_core_decrypt(limbs + k, limbs, priv, limbs + k + kn);
+		if(result == 0) set_limbs(plaintext, limbs + k, kn);
+
+		DEBUG_MSG("freeing memory\n");
+		free(limbs);
+		DEBUG_MSG("exiting\n");
+		return result;
+	}
+
+	if(mpz_divisible_p(ciphertext, priv->p2) || mpz_divisible_p(ciphertext, priv->q2)) return -1;
+
 	DEBUG_MSG("computing plaintext\n");
+	STATS_START(start);
 	//compute exponentiation c^lambda mod n^2
 	crt_exponentiation(plaintext, ciphertext, priv->lambda, priv->lambda, priv->p2invq2, priv->p2, priv->q2);
 
@@ -218,29 +808,191 @@ int paillier_decrypt(mpz_t plaintext, mpz_t ciphertext, paillier_private_key *pr
 	//compute L(c^lambda mod n^2)*mu mod n
 	mpz_mul(plaintext, plaintext, priv->mu);
 	mpz_mod(plaintext, plaintext, priv->n);
+	STATS_STOP(PAILLIER_STAT_DECRYPT, start);
 
 	DEBUG_MSG("exiting\n");
 	return 0;
 }
 
+/** Chunk of a batch decryption
+ *
+ * @ingroup Paillier
+ *
+ * The branches modulo p and modulo q of a chunk run as two separate tasks,
+ * and the last one to complete recombines the plaintexts of the chunk.
+ */
+typedef struct {
+	decrypt_branch branch_p; /**< branch modulo p, with results written to the scratch limbs of the chunk */
+	decrypt_branch branch_q; /**< branch modulo q, with results written to the scratch limbs of the chunk */
+	mpz_t *plaintexts; /**< output plaintexts of the chunk */
+	atomic_int remaining; /**< number of branches not completed yet */
+	paillier_private_key *priv; /**< private key */
+	int status; /**< -1 if a ciphertext of the chunk is out of range or failed to decrypt */
+} decrypt_chunk;
+
+/** Compute a branch of a chunk, and recombine the chunk if the other branch is completed
+ *
+ * @ingroup Paillier
+ */
+static void finish_decrypt_chunk(decrypt_chunk *chunk) {
+	mpz_t mp, mq;
+	size_t i;
+
+	if(atomic_fetch_sub_explicit(&chunk->remaining, 1, memory_order_acq_rel) == 1) {
+		mpz_init2(mp, mpz_sizeinbase(chunk->priv->p, 2));
+		mpz_init2(mq, 2*mpz_sizeinbase(chunk->priv->n, 2));
+		for(i = 0; i < chunk->branch_p.count; i++) {
+			set_limbs(mp, chunk->branch_p.results + i*chunk->branch_p.size, chunk->branch_p.size);
+			set_limbs(mq, chunk->branch_q.results + i*chunk->branch_q.size, chunk->branch_q.size);
+			decrypt_recombine(chunk->plaintexts[i], mp, mq, chunk->priv);
+		}
+		mpz_clear(mp);
+		mpz_clear(mq);
+	}
+}
+
+/** Task for the branch modulo p of a chunk
+ *
+ * @ingroup Paillier
+ *
+ * The range of the ciphertexts is checked by this branch only.
+ */
+static void do_decrypt_chunk_p(void *args) {
+	decrypt_chunk *chunk = (decrypt_chunk *)args;
+	size_t i;
+
+	for(i = 0; i < chunk->branch_p.count; i++) {
+		if(!ciphertext_valid(chunk->branch_p.ciphertexts[i], chunk->priv->n)) chunk->status = -1;
+	}
+	do_decrypt_branch((void *)&chunk->branch_p);
+	finish_decrypt_chunk(chunk);
+}
+
+/** Task for the branch modulo q of a chunk
+ *
+ * @ingroup Paillier
+ */
+static void do_decrypt_chunk_q(void *args) {
+	decrypt_chunk *chunk = (decrypt_chunk *)args;
+
+	do_decrypt_branch((void *)&chunk->branch_q);
+	finish_decrypt_chunk(chunk);
+}
+
+/** Task for a chunk decrypted with lambda
+ *
+ * @ingroup Paillier
+ */
+static void do_decrypt_chunk_lambda(void *args) {
+	decrypt_chunk *chunk = (decrypt_chunk *)args;
+	size_t i;
+
+	for(i = 0; i < chunk->branch_p.count; i++) {
+		if(paillier_decrypt(chunk->plaintexts[i], chunk->branch_p.ciphertexts[i], chunk->priv)) chunk->status = -1;
+	}
+}
+
+/**
+ * The batch is split in a few chunks per worker thread of the pool, and each chunk is split again in its branches
+ * modulo p and modulo q, so that all worker threads are busy with independent exponentiations.
+ * The results modulo p and q are stored in a single array of limbs, and each task has its own scratch variables.
+ * The plaintexts are only written by the recombination, once both branches have read the ciphertexts.
+ */
+int paillier_decrypt_batch(mpz_t *plaintexts, mpz_t *ciphertexts, size_t count, paillier_private_key *priv) {
+	mpz_t exp_p, exp_q;
+	mp_limb_t *scratch = NULL;
+	mp_size_t kp = 0, kq = 0;
+	decrypt_chunk *chunks;
+	task_group group;
+	size_t nchunks, i, start, end;
+	int result = 0, crt = mpz_sgn(priv->p) != 0;
+
+	if(count == 0) return 0;
+
+	nchunks = batch_chunks(count);
+	chunks = (decrypt_chunk *)malloc(sizeof(decrypt_chunk)*nchunks);
+	if(chunks == NULL) return -1;
+	if(crt) {
+		kp = mpz_size(priv->p);
+		kq = mpz_size(priv->q);
+		scratch = (mp_limb_t *)malloc(sizeof(mp_limb_t)*(kp + kq)*count);
+		if(scratch == NULL) {
+			free(chunks);
+			return -1;
+		}
+	}
+	mpz_init(exp_p);
+	mpz_init(exp_q);
+	mpz_sub_ui(exp_p, priv->p, 1);
+	mpz_sub_ui(exp_q, priv->q, 1);
+
+	DEBUG_MSG("decrypting batch\n");
+	task_group_init(&group);
+	for(i = 0; i < nchunks; i++) {
+		start = count*i/nchunks;
+		end = count*(i+1)/nchunks;
+		chunks[i].branch_p = (decrypt_branch){scratch + kp*start, kp, ciphertexts + start, end - start, exp_p, priv->p, priv->p2, priv->hp, PAILLIER_STAT_CRT_P, 0};
+		chunks[i].branch_q = (decrypt_branch){scratch + kp*count + kq*start, kq, ciphertexts + start, end - start, exp_q, priv->q, priv->q2, priv->hq, PAILLIER_STAT_CRT_Q, 0};
+		chunks[i].plaintexts = plaintexts + start;
+		atomic_init(&chunks[i].remaining, 2);
+		chunks[i].priv = priv;
+		chunks[i].status = 0;
+		if(crt) {
+			thread_pool_submit(&group, do_decrypt_chunk_p, (void *)&chunks[i]);
+			thread_pool_submit(&group, do_decrypt_chunk_q, (void *)&chunks[i]);
+		}
+		else {
+			thread_pool_submit(&group, do_decrypt_chunk_lambda, (void *)&chunks[i]);
+		}
+	}
+	task_group_wait(&group);
+	for(i = 0; i < nchunks; i++) {
+		if(chunks[i].status || chunks[i].branch_p.status || chunks[i].branch_q.status) result = -1;
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	mpz_clear(exp_p);
+	mpz_clear(exp_q);
+	free(scratch);
+	free(chunks);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
+
 /**
  * "Add" two plaintexts homomorphically by multiplying ciphertexts modulo n^2.
  * For example, given the ciphertexts c1 and c2, encryptions of plaintexts m1 and m2,
  * the value c3=c1*c2 mod n^2 is a ciphertext that decrypts to m1+m2 mod n.
+ * The computation is done by paillier_core_homomorphic_add on fixed-width copies of the ciphertexts.
  */
 int paillier_homomorphic_add(mpz_t ciphertext3, mpz_t ciphertext1, mpz_t ciphertext2, paillier_public_key *pub) {
-	mpz_t n2;
+	mp_size_t k = paillier_core_limbs(pub);
+	mp_limb_t *limbs;
 
-	mpz_init(n2);
-	DEBUG_MSG("compute n^2");
-	mpz_mul(n2, pub->n, pub->n);
+	if(!ciphertext_valid(ciphertext1, pub->n) || !ciphertext_valid(ciphertext2, pub->n)) return -1;
+	limbs = (mp_limb_t *)malloc(sizeof(mp_limb_t)*(2*k + paillier_core_scratch_limbs(pub)));
+	if(limbs == NULL) return -1;
 
-	DEBUG_MSG("homomorphic add plaintexts");
-	mpz_mul(ciphertext3, ciphertext1, ciphertext2);
-	mpz_mod(ciphertext3, ciphertext3, n2);
+	copy_limbs(limbs, ciphertext1, k);
+	copy_limbs(limbs + k, ciphertext2, k);
+	paillier_core_homomorphic_add(limbs, limbs, limbs + k, pub, limbs + 2*k);
+	set_limbs(ciphertext3, limbs, k);
 
 	DEBUG_MSG("freeing memory\n");
-	mpz_clear(n2);
+	free(limbs);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/**
+ * Same as paillier_homomorphic_add, but n^2 is taken from the context.
+ * @see paillier_homomorphic_add
+ */
+int paillier_homomorphic_add_ctx(mpz_t ciphertext3, mpz_t ciphertext1, mpz_t ciphertext2, paillier_public_ctx *ctx) {
+	DEBUG_MSG("homomorphic add plaintexts");
+	mpz_mul(ctx->t, ciphertext1, ciphertext2);
+	mpz_mod(ciphertext3, ctx->t, ctx->n2);
+
 	DEBUG_MSG("exiting\n");
 	return 0;
 }
@@ -249,19 +1001,444 @@ int paillier_homomorphic_add(mpz_t ciphertext3, mpz_t ciphertext1, mpz_t ciphert
  * "Multiplies" a plaintext with a constant homomorphically by exponentiating the ciphertext modulo n^2 with the constant as exponent.
  * For example, given the ciphertext c, encryptions of plaintext m, and the constant 5,
  * the value c3=c^5 n^2 is a ciphertext that decrypts to 5*m mod n.
+ * The computation is done by paillier_core_homomorphic_multc on fixed-width copies of the ciphertext and of the constant modulo n.
  */
 int paillier_homomorphic_multc(mpz_t ciphertext2, mpz_t ciphertext1, mpz_t constant, paillier_public_key *pub) {
+	mp_size_t k = paillier_core_limbs(pub), kn = mpz_size(pub->n);
+	mp_limb_t *limbs;
+	mpz_t reduced;
+
+	if(!ciphertext_valid(ciphertext1, pub->n)) return -1;
+	limbs = (mp_limb_t *)malloc(sizeof(mp_limb_t)*(k + kn + paillier_core_scratch_limbs(pub)));
+	if(limbs == NULL) return -1;
+
+	copy_limbs(limbs, ciphertext1, k);
+	//constant modulo n, which does not change the plaintext
+	if(mpz_sgn(constant) < 0 || mpz_cmp(constant, pub->n) >= 0) {
+		mpz_init(reduced);
+		mpz_mod(reduced, constant, pub->n);
+		copy_limbs(limbs + k, reduced, kn);
+		mpz_clear(reduced);
+	}
+	else {
+		copy_limbs(limbs + k, constant, kn);
+	}
+
+	DEBUG_MSG("homomorphic multiplies plaintext with constant\n");
+	paillier_core_homomorphic_multc(limbs, limbs, limbs + k, pub, limbs + k + kn);
+	set_limbs(ciphertext2, limbs, k);
+
+	DEBUG_MSG("freeing memory\n");
+	free(limbs);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/**
+ * Same as paillier_homomorphic_multc, but n^2 is taken from the context.
+ * @see paillier_homomorphic_multc
+ */
+int paillier_homomorphic_multc_ctx(mpz_t ciphertext2, mpz_t ciphertext1, mpz_t constant, paillier_public_ctx *ctx) {
+	DEBUG_MSG("homomorphic multiplies plaintext with constant");
+	mpz_powm(ciphertext2, ciphertext1, constant, ctx->n2);
+
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/** Maximum window size of multi-exponentiations
+ *
+ * @ingroup Paillier
+ */
+#define DOT_MAX_WINDOW 16
+
+/** Minimum number of terms per chunk of multi-exponentiations
+ *
+ * @ingroup Paillier
+ */
+#define DOT_MIN_CHUNK 64
+
+/** Number of chunks of a reduction over an array
+ *
+ * @ingroup Paillier
+ * @param[in] count input number of elements
+ * @param[in] min_chunk input minimum number of elements per chunk
+ * @return one chunk per worker thread of the pool, fewer if the chunks would be too small, at least one
+ *
+ * Unlike batch operations, each chunk of a reduction has a fixed cost, so there are no more chunks than threads.
+ */
+static size_t reduction_chunks(size_t count, size_t min_chunk) {
+	size_t nchunks = thread_pool_size();
+
+	if(count/min_chunk < nchunks) nchunks = count/min_chunk;
+	return nchunks ? nchunks : 1;
+}
+
+/** Chunk of a multi-exponentiation
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	mpz_t result; /**< output product of the chunk */
+	mpz_t *ciphertexts; /**< input ciphertexts of the chunk */
+	mpz_t *weights; /**< input weights of the chunk */
+	size_t count; /**< number of terms in the chunk */
+	mpz_srcptr n2; /**< modulus n^2 */
+	int status; /**< -1 if the buckets cannot be allocated */
+} dot_chunk;
+
+/** Extract a window of bits from a non-negative number
+ *
+ * @ingroup Paillier
+ * @param[in] e input number
+ * @param[in] start input index of the least significant bit of the window
+ * @param[in] width input number of bits of the window, at most DOT_MAX_WINDOW
+ * @return the bits start..start+width-1 of e
+ */
+static unsigned long get_window(mpz_srcptr e, mp_bitcnt_t start, unsigned int width) {
+	mp_size_t limb = start/GMP_NUMB_BITS;
+	unsigned int shift = start % GMP_NUMB_BITS;
+	unsigned long digit;
+
+	digit = mpz_getlimbn(e, limb) >> shift;
+	if(shift + width > GMP_NUMB_BITS) {
+		digit |= mpz_getlimbn(e, limb + 1) << (GMP_NUMB_BITS - shift);
+	}
+	return digit & ((1UL << width) - 1);
+}
+
+/** Choose the window size of a multi-exponentiation
+ *
+ * @ingroup Paillier
+ * @param[in] count input number of terms
+ * @param[in] bits input bit length of the largest exponent
+ * @return window size minimizing the number of multiplications
+ *
+ * Each window costs one multiplication per term and two per bucket.
+ */
+static unsigned int dot_window(size_t count, mp_bitcnt_t bits) {
+	unsigned int width, best = 1;
+	double cost, best_cost = 0;
+
+	for(width = 1; width <= DOT_MAX_WINDOW; width++) {
+		cost = (double)((bits + width - 1)/width)*((double)count + 2.0*(double)(1UL << width));
+		if(width == 1 || cost < best_cost) {
+			best = width;
+			best_cost = cost;
+		}
+	}
+	return best;
+}
+
+/** Compute the multi-exponentiation of a chunk
+ *
+ * @ingroup Paillier
+ * @param[in,out] args pointer to a dot_chunk
+ *
+ * Intended to be run as a task of the thread pool.
+ * For each window of the exponents, starting from the most significant one, the accumulated result is squared w times,
+ * each ciphertext is multiplied into the bucket of its digit, and the buckets are combined with running products
+ * so that bucket j contributes with multiplicity j.
+ */
+static void do_dot_chunk(void *args) {
+	dot_chunk *chunk = (dot_chunk *)args;
+	mpz_t *buckets, running, acc, t;
+	char *used;
+	mp_bitcnt_t bits = 0, len2, pos;
+	unsigned int width, k;
+	unsigned long digit, nbuckets, j;
+	size_t i;
+	int started = 0, nonempty;
+
+	mpz_set_ui(chunk->result, 1);
+	chunk->status = 0;
+	for(i = 0; i < chunk->count; i++) {
+		if(mpz_sgn(chunk->weights[i]) && mpz_sizeinbase(chunk->weights[i], 2) > bits) {
+			bits = mpz_sizeinbase(chunk->weights[i], 2);
+		}
+	}
+	if(bits == 0) return;
+
+	width = dot_window(chunk->count, bits);
+	nbuckets = (1UL << width) - 1;
+	len2 = mpz_sizeinbase(chunk->n2, 2);
+	buckets = (mpz_t *)malloc(sizeof(mpz_t)*nbuckets);
+	used = (char *)malloc(nbuckets);
+	if(buckets == NULL || used == NULL) {
+		free(buckets);
+		free(used);
+		chunk->status = -1;
+		return;
+	}
+	for(j = 0; j < nbuckets; j++) {
+		mpz_init2(buckets[j], len2);
+	}
+	mpz_init2(running, len2);
+	mpz_init2(acc, len2);
+	mpz_init2(t, 2*len2 + GMP_NUMB_BITS);
+
+	pos = ((bits + width - 1)/width)*width;
+	while(pos > 0) {
+		pos -= width;
+		if(started) {
+			for(k = 0; k < width; k++) {
+				mpz_mul(t, chunk->result, chunk->result);
+				mpz_mod(chunk->result, t, chunk->n2);
+			}
+		}
+
+		//sort the ciphertexts in buckets by digit
+		memset(used, 0, nbuckets);
+		for(i = 0; i < chunk->count; i++) {
+			digit = get_window(chunk->weights[i], pos, width);
+			if(digit == 0) continue;
+			if(used[digit - 1]) {
+				mpz_mul(t, buckets[digit - 1], chunk->ciphertexts[i]);
+				mpz_mod(buckets[digit - 1], t, chunk->n2);
+			}
+			else {
+				mpz_set(buckets[digit - 1], chunk->ciphertexts[i]);
+				used[digit - 1] = 1;
+			}
+		}
+
+		//acc = prod_j B_j^j, computed as a product of running products
+		nonempty = 0;
+		for(j = nbuckets; j > 0; j--) {
+			if(used[j - 1]) {
+				if(nonempty) {
+					mpz_mul(t, running, buckets[j - 1]);
+					mpz_mod(running, t, chunk->n2);
+				}
+				else {
+					mpz_set(running, buckets[j - 1]);
+					mpz_set(acc, running);
+					nonempty = 1;
+					continue;
+				}
+			}
+			if(nonempty) {
+				mpz_mul(t, acc, running);
+				mpz_mod(acc, t, chunk->n2);
+			}
+		}
+
+		if(nonempty) {
+			mpz_mul(t, chunk->result, acc);
+			mpz_mod(chunk->result, t, chunk->n2);
+			started = 1;
+		}
+	}
+
+	for(j = 0; j < nbuckets; j++) {
+		mpz_clear(buckets[j]);
+	}
+	free(buckets);
+	free(used);
+	mpz_clear(running);
+	mpz_clear(acc);
+	mpz_clear(t);
+}
+
+/**
+ * The terms are split in one chunk per worker thread, with at least DOT_MIN_CHUNK terms per chunk,
+ * since each chunk repeats the squarings. The products of the chunks are multiplied at the end.
+ */
+int paillier_homomorphic_dot(mpz_t result, mpz_t *ciphertexts, mpz_t *weights, size_t count, paillier_public_key *pub) {
+	dot_chunk *chunks;
+	task_group group;
+	mpz_t n2, t;
+	size_t nchunks, i, start, end;
+	int ret = 0;
+
+	//mpz_sizeinbase and mpz_getlimbn ignore the sign, so that negative weights must be rejected
+	for(i = 0; i < count; i++) {
+		if(mpz_sgn(weights[i]) < 0 || mpz_cmp(weights[i], pub->n) >= 0 || !ciphertext_valid(ciphertexts[i], pub->n)) return -1;
+	}
+
+	mpz_init(n2);
+	mpz_mul(n2, pub->n, pub->n);
+
+	nchunks = reduction_chunks(count, DOT_MIN_CHUNK);
+	chunks = (dot_chunk *)malloc(sizeof(dot_chunk)*nchunks);
+	if(chunks == NULL) {
+		mpz_clear(n2);
+		return -1;
+	}
+
+	DEBUG_MSG("computing multi-exponentiation\n");
+	task_group_init(&group);
+	for(i = 0; i < nchunks; i++) {
+		start = count*i/nchunks;
+		end = count*(i+1)/nchunks;
+		mpz_init(chunks[i].result);
+		chunks[i].ciphertexts = ciphertexts + start;
+		chunks[i].weights = weights + start;
+		chunks[i].count = end - start;
+		chunks[i].n2 = n2;
+		if(i + 1 < nchunks) {
+			thread_pool_submit(&group, do_dot_chunk, (void *)&chunks[i]);
+		}
+	}
+	//last chunk in the calling thread
+	do_dot_chunk((void *)&chunks[nchunks - 1]);
+	task_group_wait(&group);
+
+	DEBUG_MSG("combining chunks\n");
+	mpz_init(t);
+	mpz_set_ui(result, 1);
+	for(i = 0; i < nchunks; i++) {
+		if(chunks[i].status) ret = -1;
+		mpz_mul(t, result, chunks[i].result);
+		mpz_mod(result, t, n2);
+		mpz_clear(chunks[i].result);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	free(chunks);
+	mpz_clear(t);
+	mpz_clear(n2);
+	DEBUG_MSG("exiting\n");
+	return ret;
+}
+
+/** Minimum number of ciphertexts per chunk of homomorphic sums
+ *
+ * @ingroup Paillier
+ */
+#define SUM_MIN_CHUNK 256
+
+/** Chunk of a homomorphic sum
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	mpz_t result; /**< output product of the chunk */
+	mpz_t *ciphertexts; /**< input ciphertexts of the chunk */
+	size_t count; /**< number of ciphertexts in the chunk */
+	mpz_srcptr n2; /**< modulus n^2 */
+	int status; /**< -1 if the accumulator cannot be allocated */
+} sum_chunk;
+
+/** Compute the product of the ciphertexts of a chunk
+ *
+ * @ingroup Paillier
+ * @param[in,out] args pointer to a sum_chunk
+ *
+ * Intended to be run as a task of the thread pool.
+ * The ciphertexts are multiplied with Montgomery multiplications without converting them to the Montgomery domain,
+ * so that the product of m ciphertexts carries a factor R^{-(m-1)}. That factor is removed at the end
+ * with one multiplication by R^{m-1} mod n^2.
+ */
+static void do_sum_chunk(void *args) {
+	sum_chunk *chunk = (sum_chunk *)args;
+	mp_size_t k = mpz_size(chunk->n2);
+	mp_srcptr m = mpz_limbs_read(chunk->n2);
+	mp_limb_t minv = mont_inverse(m[0]);
+	mp_ptr acc, op, tp;
+	mpz_t factor;
+	size_t i;
+
+	chunk->status = 0;
+	if(chunk->count == 0) {
+		mpz_set_ui(chunk->result, 1);
+		return;
+	}
+
+	acc = (mp_ptr)malloc(sizeof(mp_limb_t)*4*k);
+	if(acc == NULL) {
+		chunk->status = -1;
+		return;
+	}
+	op = acc + k;
+	tp = acc + 2*k;
+
+	copy_limbs(acc, chunk->ciphertexts[0], k);
+	for(i = 1; i < chunk->count; i++) {
+		//use the limbs of the ciphertext directly unless they need padding
+		if((mp_size_t)mpz_size(chunk->ciphertexts[i]) == k) {
+			mont_mul(acc, acc, mpz_limbs_read(chunk->ciphertexts[i]), m, k, minv, tp);
+		}
+		else {
+			copy_limbs(op, chunk->ciphertexts[i], k);
+			mont_mul(acc, acc, op, m, k, minv, tp);
+		}
+	}
+	mpn_copyi(mpz_limbs_write(chunk->result, k), acc, k);
+	mpz_limbs_finish(chunk->result, k);
+
+	//remove the factor R^{-(count-1)}
+	mpz_init(factor);
+	mpz_setbit(factor, k*GMP_NUMB_BITS);
+	mpz_powm_ui(factor, factor, chunk->count - 1, chunk->n2);
+	mpz_mul(chunk->result, chunk->result, factor);
+	mpz_mod(chunk->result, chunk->result, chunk->n2);
+
+	mpz_clear(factor);
+	free(acc);
+}
+
+/**
+ * The ciphertexts are split in one chunk per worker thread, each chunk is multiplied with Montgomery multiplications,
+ * and the products of the chunks are multiplied at the end.
+ */
+int paillier_homomorphic_sum(mpz_t result, mpz_t *ciphertexts, size_t count, paillier_public_key *pub) {
+	sum_chunk *chunks;
+	task_group group;
 	mpz_t n2;
+	size_t nchunks, i, start, end;
+	int ret;
 
 	mpz_init(n2);
-	DEBUG_MSG("compute n^2");
 	mpz_mul(n2, pub->n, pub->n);
 
-	DEBUG_MSG("homomorphic multiplies plaintext with constant");
-	mpz_powm(ciphertext2, ciphertext1, constant, n2);
+	//the Montgomery multiplications need ciphertexts of at most as many limbs as n^2, and less than n^2
+	for(i = 0; i < count; i++) {
+		if(mpz_sgn(ciphertexts[i]) <= 0 || mpz_cmp(ciphertexts[i], n2) >= 0) {
+			mpz_clear(n2);
+			return -1;
+		}
+	}
+
+	nchunks = reduction_chunks(count, SUM_MIN_CHUNK);
+	chunks = (sum_chunk *)malloc(sizeof(sum_chunk)*nchunks);
+	if(chunks == NULL) {
+		mpz_clear(n2);
+		return -1;
+	}
+
+	DEBUG_MSG("computing homomorphic sum\n");
+	task_group_init(&group);
+	for(i = 0; i < nchunks; i++) {
+		start = count*i/nchunks;
+		end = count*(i+1)/nchunks;
+		mpz_init(chunks[i].result);
+		chunks[i].ciphertexts = ciphertexts + start;
+		chunks[i].count = end - start;
+		chunks[i].n2 = n2;
+		if(i + 1 < nchunks) {
+			thread_pool_submit(&group, do_sum_chunk, (void *)&chunks[i]);
+		}
+	}
+	//last chunk in the calling thread
+	do_sum_chunk((void *)&chunks[nchunks - 1]);
+	task_group_wait(&group);
+
+	DEBUG_MSG("combining chunks\n");
+	ret = chunks[0].status;
+	mpz_set(result, chunks[0].result);
+	for(i = 1; i < nchunks; i++) {
+		if(chunks[i].status) ret = -1;
+		mpz_mul(result, result, chunks[i].result);
+		mpz_mod(result, result, n2);
+	}
 
 	DEBUG_MSG("freeing memory\n");
+	for(i = 0; i < nchunks; i++) {
+		mpz_clear(chunks[i].result);
+	}
+	free(chunks);
 	mpz_clear(n2);
 	DEBUG_MSG("exiting\n");
-	return 0;
+	return ret;
 }
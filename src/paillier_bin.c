@@ -0,0 +1,507 @@
+/**
+ * @file paillier_bin.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+#if GMP_NUMB_BITS != 64 || GMP_NAIL_BITS != 0
+#error "binary containers need 64-bit limbs without nails"
+#endif
+
+/** Number of fields of a binary private key
+ *
+ * @ingroup Paillier
+ */
+#define BIN_PRIVATE_FIELDS 12
+
+/** Write an unsigned integer in little-endian order
+ *
+ * @ingroup Paillier
+ * @param[out] dest output bytes
+ * @param[in] value input integer
+ * @param[in] size input number of bytes
+ */
+static void put_le(unsigned char *dest, uint64_t value, size_t size) {
+	size_t i;
+
+	for(i = 0; i < size; i++) {
+		dest[i] = (unsigned char)(value >> (8*i));
+	}
+}
+
+/** Read an unsigned integer in little-endian order
+ *
+ * @ingroup Paillier
+ * @param[in] src input bytes
+ * @param[in] size input number of bytes
+ * @return integer
+ */
+static uint64_t get_le(const unsigned char *src, size_t size) {
+	uint64_t value = 0;
+	size_t i;
+
+	for(i = 0; i < size; i++) {
+		value |= (uint64_t)src[i] << (8*i);
+	}
+	return value;
+}
+
+/** Update a 64-bit FNV-1a hash
+ *
+ * @ingroup Paillier
+ * @param[in] hash input current hash value
+ * @param[in] data input bytes, NULL for zero bytes
+ * @param[in] size input number of bytes
+ * @return updated hash value
+ */
+static uint64_t fnv1a(uint64_t hash, const unsigned char *data, size_t size) {
+	size_t i;
+
+	for(i = 0; i < size; i++) {
+		hash ^= data != NULL ? data[i] : 0;
+		hash *= 0x100000001b3ULL;
+	}
+	return hash;
+}
+
+/**
+ * The checksum is a 64-bit FNV-1a hash of the whole file, where the checksum field of the header counts as zero.
+ * It detects truncated or corrupted files, it is not a protection against tampering.
+ */
+uint64_t paillier_bin_checksum(const void *data, size_t size) {
+	const unsigned char *bytes = (const unsigned char *)data;
+	uint64_t hash = 0xcbf29ce484222325ULL;
+
+	if(size < PAILLIER_BIN_HEADER_SIZE) return fnv1a(hash, bytes, size);
+	hash = fnv1a(hash, bytes, 24);
+	hash = fnv1a(hash, NULL, 8);
+	return fnv1a(hash, bytes + 32, size - 32);
+}
+
+/** Fingerprint of a modulus
+ *
+ * @ingroup Paillier
+ * @param[in] n input modulus
+ * @return 64-bit FNV-1a hash of n written as little-endian 64-bit words
+ */
+static uint64_t fingerprint(mpz_t n) {
+	unsigned char bytes[8];
+	uint64_t hash = 0xcbf29ce484222325ULL;
+	size_t i;
+
+	for(i = 0; i < mpz_size(n); i++) {
+		put_le(bytes, mpz_getlimbn(n, i), 8);
+		hash = fnv1a(hash, bytes, 8);
+	}
+	return hash;
+}
+
+/** Map a whole file in memory
+ *
+ * @ingroup Paillier
+ * @param[in] fp input stream, read from its current position
+ * @param[out] size output size of the data
+ * @param[out] mapped output 1 if the data is mapped, 0 if it was read in an allocated buffer
+ * @return data, or NULL on error
+ *
+ * Regular files read from their beginning are mapped; other streams, such as pipes, are read in one buffer.
+ */
+static void *map_file(FILE *fp, size_t *size, int *mapped) {
+	struct stat st;
+	unsigned char *data, *grown;
+	size_t capacity, count;
+
+	if(fstat(fileno(fp), &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 && ftell(fp) == 0) {
+		data = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+		if(data != MAP_FAILED) {
+			*size = st.st_size;
+			*mapped = 1;
+			return data;
+		}
+	}
+
+	capacity = 1 << 14;
+	count = 0;
+	data = (unsigned char *)malloc(capacity);
+	while(data != NULL) {
+		count += fread(data + count, 1, capacity - count, fp);
+		if(count < capacity) break;
+		capacity *= 2;
+		grown = (unsigned char *)realloc(data, capacity);
+		if(grown == NULL) free(data);
+		data = grown;
+	}
+	*size = count;
+	*mapped = 0;
+	return data;
+}
+
+/** Release the data returned by map_file
+ *
+ * @ingroup Paillier
+ */
+static void unmap_file(void *data, size_t size, int mapped) {
+	if(mapped) {
+		munmap(data, size);
+	}
+	else {
+		free(data);
+	}
+}
+
+/** Write a binary key file
+ *
+ * @ingroup Paillier
+ * @param[out] fp output stream
+ * @param[in] type input PAILLIER_BIN_PUBLIC or PAILLIER_BIN_PRIVATE
+ * @param[in] len input bit length of the key
+ * @param[in] fields input integers of the key
+ * @param[in] count input number of integers
+ * @return 0 if no error
+ *
+ * The header holds the magic number, the version, the type, the bit length, the width of fields in 64-bit words,
+ * the number of fields and the checksum. It is followed by the fields, each stored as fixed-width little-endian 64-bit words.
+ * The checksum covers the header, with the checksum set to zero, and the fields.
+ */
+static int write_key(FILE *fp, unsigned int type, mp_bitcnt_t len, mpz_ptr *fields, size_t count) {
+	unsigned char *data;
+	size_t i, words = 1, size, written;
+
+	for(i = 0; i < count; i++) {
+		if(mpz_sgn(fields[i]) < 0) return -1;
+		size = (mpz_sizeinbase(fields[i], 2) + 63)/64;
+		if(size > words) words = size;
+	}
+
+	size = PAILLIER_BIN_HEADER_SIZE + 8*words*count;
+	data = (unsigned char *)calloc(size, 1);
+	if(data == NULL) return -1;
+	memcpy(data, PAILLIER_BIN_MAGIC, 4);
+	put_le(data + 4, PAILLIER_BIN_VERSION, 2);
+	put_le(data + 6, type, 2);
+	put_le(data + 8, len, 4);
+	put_le(data + 12, words, 4);
+	put_le(data + 16, count, 4);
+	for(i = 0; i < count; i++) {
+		mpz_export(data + PAILLIER_BIN_HEADER_SIZE + 8*words*i, NULL, -1, 8, -1, 0, fields[i]);
+	}
+	put_le(data + 24, paillier_bin_checksum(data, size), 8);
+
+	written = fwrite(data, 1, size, fp);
+	free(data);
+	return written == size ? 0 : -1;
+}
+
+/** Read a binary key file
+ *
+ * @ingroup Paillier
+ * @param[out] fields output integers of the key
+ * @param[in] min_count input minimum number of fields
+ * @param[in] max_count input maximum number of fields, missing fields are set to zero
+ * @param[in] type input PAILLIER_BIN_PUBLIC or PAILLIER_BIN_PRIVATE
+ * @param[out] len output bit length of the key
+ * @param[in] fp input stream
+ * @return 0 if no error, -1 if the file is not a valid key of the given type
+ */
+static int read_key(mpz_ptr *fields, size_t min_count, size_t max_count, unsigned int type, mp_bitcnt_t *len, FILE *fp) {
+	unsigned char *data;
+	size_t i, size, words, count;
+	int mapped, result = -1;
+
+	data = map_file(fp, &size, &mapped);
+	if(data == NULL) return -1;
+
+	DEBUG_MSG("checking header\n");
+	if(size >= PAILLIER_BIN_HEADER_SIZE && !memcmp(data, PAILLIER_BIN_MAGIC, 4)
+			&& get_le(data + 4, 2) == PAILLIER_BIN_VERSION && get_le(data + 6, 2) == type) {
+		words = get_le(data + 12, 4);
+		count = get_le(data + 16, 4);
+		if(count >= min_count && count <= max_count && words > 0 && size == PAILLIER_BIN_HEADER_SIZE + 8*words*count
+				&& get_le(data + 24, 8) == paillier_bin_checksum(data, size)) {
+			DEBUG_MSG("importing fields\n");
+			*len = get_le(data + 8, 4);
+			for(i = 0; i < max_count; i++) {
+				if(i < count) {
+					mpz_import(fields[i], words, -1, 8, -1, 0, data + PAILLIER_BIN_HEADER_SIZE + 8*words*i);
+				}
+				else {
+					mpz_set_ui(fields[i], 0);
+				}
+			}
+			result = 0;
+		}
+	}
+
+	unmap_file(data, size, mapped);
+	return result;
+}
+
+/**
+ * The public key is written with the fields n and, if set, h_s.
+ */
+int paillier_public_out_bin(FILE *fp, paillier_public_key *pub) {
+	mpz_ptr fields[2] = {pub->n, pub->hs};
+
+	return write_key(fp, PAILLIER_BIN_PUBLIC, pub->len, fields, mpz_sgn(pub->hs) ? 2 : 1);
+}
+
+/**
+ * The private key is written with the same fields and in the same order as the hexadecimal format.
+ */
+int paillier_private_out_bin(FILE *fp, paillier_private_key *priv) {
+	mpz_ptr fields[BIN_PRIVATE_FIELDS] = {priv->lambda, priv->mu, priv->p2, priv->q2, priv->p2invq2, priv->ninv,
+			priv->n, priv->p, priv->q, priv->pinvq, priv->hp, priv->hq};
+
+	return write_key(fp, PAILLIER_BIN_PRIVATE, priv->len, fields, BIN_PRIVATE_FIELDS);
+}
+
+/**
+ * A public key without h_s has a single field.
+ */
+int paillier_public_import_bin(paillier_public_key *pub, FILE *fp) {
+	mpz_ptr fields[2] = {pub->n, pub->hs};
+
+	return read_key(fields, 1, 2, PAILLIER_BIN_PUBLIC, &pub->len, fp);
+}
+
+/**
+ * Like paillier_private_in_str, p, q, p^{-1} mod q, h_p and h_q are re-computed if the file does not have them.
+ */
+int paillier_private_import_bin(paillier_private_key *priv, FILE *fp) {
+	mpz_ptr fields[BIN_PRIVATE_FIELDS] = {priv->lambda, priv->mu, priv->p2, priv->q2, priv->p2invq2, priv->ninv,
+			priv->n, priv->p, priv->q, priv->pinvq, priv->hp, priv->hq};
+
+	if(read_key(fields, BIN_PRIVATE_FIELDS, BIN_PRIVATE_FIELDS, PAILLIER_BIN_PRIVATE, &priv->len, fp)) return -1;
+	if(mpz_sgn(priv->p) == 0) {
+		DEBUG_MSG("re-computing p, q, p^-1 mod q, h_p and h_q\n");
+		mpz_sqrt(priv->p, priv->p2);
+		mpz_sqrt(priv->q, priv->q2);
+		if(paillier_private_crt_init(priv)) mpz_set_ui(priv->p, 0);
+	}
+	return 0;
+}
+
+uint64_t paillier_public_fingerprint(paillier_public_key *pub) {
+	return fingerprint(pub->n);
+}
+
+int paillier_container_open(paillier_container *cont, FILE *fp) {
+	unsigned char *data;
+	uint64_t count;
+	size_t i, words;
+
+	data = map_file(fp, &cont->data_size, &cont->mapped);
+	if(data == NULL) return -1;
+	cont->data = data;
+	cont->copy = NULL;
+
+	DEBUG_MSG("checking header\n");
+	if(cont->data_size < PAILLIER_BIN_HEADER_SIZE || memcmp(data, PAILLIER_BIN_MAGIC, 4)
+			|| get_le(data + 4, 2) != PAILLIER_BIN_VERSION || get_le(data + 6, 2) != PAILLIER_BIN_CIPHERTEXTS
+			|| (words = get_le(data + 12, 4)) == 0) {
+		unmap_file(cont->data, cont->data_size, cont->mapped);
+		return -1;
+	}
+	count = get_le(data + 16, 8);
+	//the writer could not seek back to the header, the ciphertexts go until the end of the file
+	if(count == UINT64_MAX) {
+		count = (cont->data_size - PAILLIER_BIN_HEADER_SIZE)/(8*words);
+	}
+	if(count > (cont->data_size - PAILLIER_BIN_HEADER_SIZE)/(8*words)
+			|| cont->data_size != PAILLIER_BIN_HEADER_SIZE + 8*words*count) {
+		unmap_file(cont->data, cont->data_size, cont->mapped);
+		return -1;
+	}
+	cont->len = get_le(data + 8, 4);
+	cont->size = words;
+	cont->count = count;
+	cont->fingerprint = get_le(data + 24, 8);
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	//the records are already limbs
+	(void)i;
+	cont->records = (const mp_limb_t *)(data + PAILLIER_BIN_HEADER_SIZE);
+#else
+	DEBUG_MSG("converting ciphertexts to the byte order of the host\n");
+	cont->copy = (mp_limb_t *)malloc(sizeof(mp_limb_t)*words*count + 1);
+	if(cont->copy == NULL) {
+		unmap_file(cont->data, cont->data_size, cont->mapped);
+		return -1;
+	}
+	for(i = 0; i < words*count; i++) {
+		cont->copy[i] = get_le(data + PAILLIER_BIN_HEADER_SIZE + 8*i, 8);
+	}
+	cont->records = cont->copy;
+#endif
+	return 0;
+}
+
+void paillier_container_close(paillier_container *cont) {
+	free(cont->copy);
+	unmap_file(cont->data, cont->data_size, cont->mapped);
+}
+
+const mp_limb_t *paillier_container_get(paillier_container *cont, size_t index) {
+	return cont->records + cont->size*index;
+}
+
+/**
+ * The view is made with mpz_roinit_n, which does not copy the limbs.
+ */
+void paillier_container_view(mpz_t view, paillier_container *cont, size_t index) {
+	mpz_roinit_n(view, paillier_container_get(cont, index), cont->size);
+}
+
+/**
+ * The number of ciphertexts is written as all ones, and overwritten when the writer finishes if the stream can seek.
+ */
+int paillier_container_writer_init(paillier_container_writer *writer, FILE *fp, paillier_public_key *pub) {
+	unsigned char header[PAILLIER_BIN_HEADER_SIZE];
+
+	writer->fp = fp;
+	writer->start = ftell(fp);
+	writer->size = paillier_core_limbs(pub);
+	writer->count = 0;
+	writer->record = (unsigned char *)malloc(8*writer->size);
+	if(writer->record == NULL) return -1;
+
+	memset(header, 0, sizeof(header));
+	memcpy(header, PAILLIER_BIN_MAGIC, 4);
+	put_le(header + 4, PAILLIER_BIN_VERSION, 2);
+	put_le(header + 6, PAILLIER_BIN_CIPHERTEXTS, 2);
+	put_le(header + 8, pub->len, 4);
+	put_le(header + 12, writer->size, 4);
+	put_le(header + 16, UINT64_MAX, 8);
+	put_le(header + 24, paillier_public_fingerprint(pub), 8);
+	if(fwrite(header, 1, sizeof(header), fp) != sizeof(header)) {
+		free(writer->record);
+		return -1;
+	}
+	return 0;
+}
+
+int paillier_container_write(paillier_container_writer *writer, mpz_t ciphertext) {
+	STATS_START(start);
+
+	if(mpz_sgn(ciphertext) < 0 || mpz_size(ciphertext) > (size_t)writer->size) return -1;
+	memset(writer->record, 0, 8*writer->size);
+	mpz_export(writer->record, NULL, -1, 8, -1, 0, ciphertext);
+	if(fwrite(writer->record, 8, writer->size, writer->fp) != (size_t)writer->size) return -1;
+	writer->count++;
+	STATS_STOP(PAILLIER_STAT_SERIALIZE, start);
+	return 0;
+}
+
+int paillier_container_writer_finish(paillier_container_writer *writer) {
+	unsigned char count[8];
+	int result = 0;
+
+	free(writer->record);
+	if(writer->start >= 0 && fseek(writer->fp, writer->start + 16, SEEK_SET) == 0) {
+		DEBUG_MSG("writing number of ciphertexts\n");
+		put_le(count, writer->count, 8);
+		if(fwrite(count, 1, 8, writer->fp) != 8) result = -1;
+		fseek(writer->fp, 0, SEEK_END);
+	}
+	if(fflush(writer->fp)) result = -1;
+	return result;
+}
+
+/** Views of all ciphertexts of a container
+ *
+ * @ingroup Paillier
+ * @param[in] cont input container reader
+ * @return array of cont->count read-only integers sharing the limbs of the container, to be freed with free, NULL if it cannot be allocated
+ */
+static mpz_t *container_views(paillier_container *cont) {
+	mpz_t *views;
+	size_t i;
+
+	views = (mpz_t *)malloc(sizeof(mpz_t)*(cont->count ? cont->count : 1));
+	if(views == NULL) {
+		DEBUG_MSG("cannot allocate ciphertext views!\n");
+		return NULL;
+	}
+	for(i = 0; i < cont->count; i++) {
+		paillier_container_view(views[i], cont, i);
+	}
+	return views;
+}
+
+/** Check that a container was written for a key
+ *
+ * @ingroup Paillier
+ * @param[in] cont input container reader
+ * @param[in] n input modulus of the key
+ * @return 1 if the fingerprint matches n and the records are as wide as ciphertexts of the key, 0 otherwise
+ */
+static int container_matches(paillier_container *cont, mpz_t n) {
+	return cont->fingerprint == fingerprint(n) && cont->size == (mp_size_t)BIT2LIMB(2*mpz_sizeinbase(n, 2));
+}
+
+/**
+ * The ciphertexts are passed to paillier_decrypt_batch as views of the container, without copy.
+ */
+int paillier_decrypt_container(mpz_t *plaintexts, paillier_container *cont, paillier_private_key *priv) {
+	mpz_t *views;
+	int result;
+
+	if(!container_matches(cont, priv->n)) return -1;
+	views = container_views(cont);
+	if(views == NULL) return -1;
+	result = paillier_decrypt_batch(plaintexts, views, cont->count, priv);
+	free(views);
+	return result;
+}
+
+int paillier_homomorphic_sum_container(mpz_t result, paillier_container *cont, paillier_public_key *pub) {
+	mpz_t *views;
+	int ret;
+
+	if(!container_matches(cont, pub->n)) return -1;
+	views = container_views(cont);
+	if(views == NULL) return -1;
+	ret = paillier_homomorphic_sum(result, views, cont->count, pub);
+	free(views);
+	return ret;
+}
+
+int paillier_homomorphic_dot_container(mpz_t result, paillier_container *cont, mpz_t *weights, paillier_public_key *pub) {
+	mpz_t *views;
+	int ret;
+
+	if(!container_matches(cont, pub->n)) return -1;
+	views = container_views(cont);
+	if(views == NULL) return -1;
+	ret = paillier_homomorphic_dot(result, views, weights, cont->count, pub);
+	free(views);
+	return ret;
+}
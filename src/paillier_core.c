@@ -0,0 +1,368 @@
+/**
+ * @file paillier_core.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include "../include/paillier.h"
+#include "tools.h"
+#include "thread_pool.h"
+#include "random.h"
+
+/** Remainder of a division, also for dividends shorter than the divisor
+ *
+ * @ingroup Paillier
+ * @param[out] r output remainder, dn limbs
+ * @param[out] qp output quotient, an-dn+1 limbs
+ * @param[in] a input dividend, an limbs
+ * @param[in] an input number of limbs of the dividend
+ * @param[in] d input divisor, dn limbs with non-zero most significant limb
+ * @param[in] dn input number of limbs of the divisor
+ */
+static void core_mod(mp_ptr r, mp_ptr qp, mp_srcptr a, mp_size_t an, mp_srcptr d, mp_size_t dn) {
+	if(an < dn) {
+		mpn_copyi(r, a, an);
+		mpn_zero(r + an, dn - an);
+	}
+	else {
+		mpn_tdiv_qr(qp, r, 0, a, an, d, dn);
+	}
+}
+
+/** Product of two numbers of any lengths
+ *
+ * @ingroup Paillier
+ * @param[out] r output product, an+bn limbs
+ * @param[in] a input first factor, an limbs
+ * @param[in] an input number of limbs of the first factor
+ * @param[in] b input second factor, bn limbs
+ * @param[in] bn input number of limbs of the second factor
+ */
+static void core_mul(mp_ptr r, mp_srcptr a, mp_size_t an, mp_srcptr b, mp_size_t bn) {
+	if(an >= bn) {
+		mpn_mul(r, a, an, b, bn);
+	}
+	else {
+		mpn_mul(r, b, bn, a, an);
+	}
+}
+
+mp_size_t paillier_core_limbs(paillier_public_key *pub) {
+	return BIT2LIMB(2*mpz_sizeinbase(pub->n, 2));
+}
+
+/**
+ * Layout of the scratch space: n^2, random base, r^n, 1+m*n, double-size product and quotient, each sized by n^2,
+ * followed by the scratch space of mpn_sec_powm for an exponent as long as n, or of mont_powm if it is larger.
+ */
+mp_size_t paillier_core_scratch_limbs(paillier_public_key *pub) {
+	mp_size_t k = paillier_core_limbs(pub);
+	mp_size_t itch = mpn_sec_powm_itch(k, mpz_sizeinbase(pub->n, 2), k);
+
+	if(itch < (mp_size_t)MONT_POWM_SCRATCH(k)) itch = MONT_POWM_SCRATCH(k);
+	return 7*k + 1 + itch;
+}
+
+/** Compute n^2 in the scratch space
+ *
+ * @ingroup Paillier
+ * @param[out] n2 output n^2, k limbs
+ * @param[out] tp output scratch space, 2*size(n) limbs
+ * @param[in] pub input public key
+ * @param[in] k input number of limbs of n^2
+ */
+static void core_n2(mp_ptr n2, mp_ptr tp, paillier_public_key *pub, mp_size_t k) {
+	mpn_sqr(tp, mpz_limbs_read(pub->n), mpz_size(pub->n));
+	mpn_copyi(n2, tp, k);
+}
+
+/**
+ * Same computation as paillier_encrypt, with mpn_sec_powm for the exponentiation:
+ * its running time does not depend on the random base.
+ */
+int paillier_core_encrypt(mp_limb_t *ciphertext, const mp_limb_t *plaintext, paillier_public_key *pub, mp_limb_t *scratch) {
+	mp_size_t k = paillier_core_limbs(pub);
+	mp_size_t kn = mpz_size(pub->n);
+	mp_srcptr n = mpz_limbs_read(pub->n);
+	mp_bitcnt_t bits;
+	mp_ptr n2 = scratch;
+	mp_ptr base = n2 + k;
+	mp_ptr rn = base + k;
+	mp_ptr t = rn + k;
+	mp_ptr prod = t + k;
+	mp_ptr quot = prod + 2*k;
+	mp_ptr tp = quot + k + 1;
+	STATS_START(start);
+
+	core_n2(n2, prod, pub, k);
+
+	if(mpz_sgn(pub->hs) != 0) {
+		//h_s is the base of mpn_sec_powm, it must be between 1 and n^2-1
+		if(mpz_sgn(pub->hs) < 0 || mpz_size(pub->hs) > k
+				|| (mpz_size(pub->hs) == k && mpn_cmp(mpz_limbs_read(pub->hs), n2, k) >= 0)) return -1;
+
+		DEBUG_MSG("generating random exponent\n");
+		//generate random alpha of len/2 bits
+		bits = (pub->len + 1)/2;
+		if(random_bytes(base, sizeof(mp_limb_t)*BIT2LIMB(bits))) return -1;
+		if(bits % GMP_NUMB_BITS) base[bits/GMP_NUMB_BITS] &= ((mp_limb_t)1 << (bits % GMP_NUMB_BITS)) - 1;
+
+		DEBUG_MSG("computing ciphertext\n");
+		//compute h_s^alpha mod n2
+		mpn_sec_powm(rn, mpz_limbs_read(pub->hs), mpz_size(pub->hs), base, bits, n2, k, tp);
+	}
+	else {
+		DEBUG_MSG("generating random number\n");
+		//generate random r and reduce modulo n
+		if(random_bytes(base, sizeof(mp_limb_t)*kn)) return -1;
+		mpn_tdiv_qr(quot, base, 0, base, kn, n, kn);
+		if(mpn_zero_p(base, kn)) {
+			fputs("random number is zero!\n", stderr);
+			exit(1);
+		}
+
+		DEBUG_MSG("computing ciphertext\n");
+		//compute r^n mod n2
+		mpn_sec_powm(rn, base, kn, n, mpz_sizeinbase(pub->n, 2), n2, k, tp);
+	}
+
+	//compute (1+m*n), less than n^2
+	mpn_mul_n(prod, plaintext, n, kn);
+	mpn_add_1(prod, prod, 2*kn, 1);
+	mpn_copyi(t, prod, k);
+
+	//multiply with (1+m*n)
+	mpn_mul_n(prod, rn, t, k);
+	mpn_tdiv_qr(quot, ciphertext, 0, prod, 2*k, n2, k);
+	STATS_STOP(PAILLIER_STAT_ENCRYPT, start);
+
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+int paillier_core_homomorphic_add(mp_limb_t *ciphertext3, const mp_limb_t *ciphertext1, const mp_limb_t *ciphertext2, paillier_public_key *pub, mp_limb_t *scratch) {
+	mp_size_t k = paillier_core_limbs(pub);
+	mp_ptr n2 = scratch;
+	mp_ptr prod = n2 + 4*k;
+	mp_ptr quot = prod + 2*k;
+
+	core_n2(n2, prod, pub, k);
+
+	DEBUG_MSG("homomorphic add plaintexts\n");
+	mpn_mul_n(prod, ciphertext1, ciphertext2, k);
+	mpn_tdiv_qr(quot, ciphertext3, 0, prod, 2*k, n2, k);
+	return 0;
+}
+
+/**
+ * The ciphertext and the constant are public, so that the exponentiation is done by mont_powm, with sliding windows,
+ * rather than by mpn_sec_powm. The ciphertext is brought to the Montgomery domain with a division of c*R by n^2.
+ */
+int paillier_core_homomorphic_multc(mp_limb_t *ciphertext2, const mp_limb_t *ciphertext1, const mp_limb_t *constant, paillier_public_key *pub, mp_limb_t *scratch) {
+	mp_size_t k = paillier_core_limbs(pub);
+	mp_size_t kc = mpz_size(pub->n);
+	mp_ptr n2 = scratch;
+	mp_ptr base = n2 + k;
+	mp_ptr rn = n2 + 2*k;
+	mp_ptr prod = n2 + 4*k;
+	mp_ptr quot = prod + 2*k;
+	mp_ptr tp = prod + 3*k + 1;
+	mp_limb_t minv;
+
+	core_n2(n2, prod, pub, k);
+
+	//c^0 = 1
+	while(kc > 0 && constant[kc - 1] == 0) kc--;
+	if(kc == 0) {
+		mpn_zero(ciphertext2, k);
+		ciphertext2[0] = 1;
+		return 0;
+	}
+
+	DEBUG_MSG("homomorphic multiplies plaintext with constant\n");
+	//c*R mod n^2
+	minv = mont_inverse(n2[0]);
+	mpn_zero(prod, k);
+	mpn_copyi(prod + k, ciphertext1, k);
+	mpn_tdiv_qr(quot, base, 0, prod, 2*k, n2, k);
+
+	//c^constant*R mod n^2, and back from the Montgomery domain with a multiplication by 1
+	mont_powm(rn, base, constant, kc, n2, k, minv, tp);
+	mpn_zero(base, k);
+	base[0] = 1;
+	mont_mul(ciphertext2, rn, base, n2, k, minv, tp);
+	return 0;
+}
+
+/** Scratch space of a branch of CRT decryption
+ *
+ * @ingroup Paillier
+ * @param[in] prime input prime p or q
+ * @param[in] prime2 input square of the prime
+ * @param[in] h input h_p or h_q
+ * @param[in] k input number of limbs of n^2
+ * @return number of limbs
+ */
+static mp_size_t branch_scratch_limbs(mpz_srcptr prime, mpz_srcptr prime2, mpz_srcptr h, mp_size_t k) {
+	mp_size_t kp = mpz_size(prime), kp2 = mpz_size(prime2);
+
+	//c mod p^2, p-1, c^{p-1} mod p^2, L_p, product with h_p, quotients, remainder and exponentiation
+	return kp2 + kp + kp2 + (kp2 + 1) + (kp2 + 1 + mpz_size(h) + 1) + (k + 2) + kp
+			+ mpn_sec_powm_itch(kp2, mpz_sizeinbase(prime, 2), kp2);
+}
+
+/**
+ * Layout of the scratch space: m_p and m_q, scratch of the branch modulo p, scratch of the branch modulo q,
+ * and scratch of the recombination.
+ */
+mp_size_t paillier_core_decrypt_scratch_limbs(paillier_private_key *priv) {
+	mp_size_t k = BIT2LIMB(2*mpz_sizeinbase(priv->n, 2));
+	mp_size_t kp = mpz_size(priv->p), kq = mpz_size(priv->q);
+
+	if(kp == 0) return 0;
+	return kp + kq
+			+ branch_scratch_limbs(priv->p, priv->p2, priv->hp, k)
+			+ branch_scratch_limbs(priv->q, priv->q2, priv->hq, k)
+			+ (k + 2) + 4*(kp + kq + 2);
+}
+
+/** Branch modulo p or modulo q of a CRT decryption on limbs
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	mp_ptr result;		/**< output m_p, as many limbs as p */
+	mp_srcptr ciphertext;	/**< input ciphertext */
+	mp_size_t k;		/**< number of limbs of the ciphertext */
+	mpz_srcptr prime;	/**< prime p */
+	mpz_srcptr prime2;	/**< square p^2 */
+	mpz_srcptr h;		/**< h_p */
+	mp_ptr scratch;		/**< scratch space of the branch */
+	unsigned int stat;	/**< statistics probe of the branch */
+	int status;		/**< output 0 if no error, -1 if the ciphertext is a multiple of the square of the prime */
+} core_branch;
+
+/** Compute a branch of a CRT decryption on limbs
+ *
+ * @ingroup Paillier
+ * @param[in,out] args pointer to a core_branch
+ *
+ * Computes m_p = L_p(c^{p-1} mod p^2)*h_p mod p. Intended to be run as a task of the thread pool.
+ */
+static void do_core_branch(void *args) {
+	core_branch *branch = (core_branch *)args;
+	mp_size_t kp = mpz_size(branch->prime), kp2 = mpz_size(branch->prime2), kh = mpz_size(branch->h);
+	mp_size_t kl = kp2 - kp + 1;
+	mp_srcptr p = mpz_limbs_read(branch->prime);
+	mp_srcptr p2 = mpz_limbs_read(branch->prime2);
+	mp_ptr red = branch->scratch;
+	mp_ptr e = red + kp2;
+	mp_ptr u = e + kp;
+	mp_ptr l = u + kp2;
+	mp_ptr prod = l + kp2 + 1;
+	mp_ptr quot = prod + kp2 + 1 + kh + 1;
+	mp_ptr rem = quot + branch->k + 2;
+	mp_ptr tp = rem + kp;
+	STATS_START(start);
+
+	//c mod p^2, the base of mpn_sec_powm, must not be zero
+	core_mod(red, quot, branch->ciphertext, branch->k, p2, kp2);
+	branch->status = mpn_zero_p(red, kp2) ? -1 : 0;
+	if(branch->status) return;
+
+	//c^{p-1} mod p^2
+	mpn_sub_1(e, p, kp, 1);
+	mpn_sec_powm(u, red, kp2, e, mpz_sizeinbase(branch->prime, 2), p2, kp2, tp);
+
+	//L_p(u) = (u-1)/p, an exact division
+	mpn_sub_1(u, u, kp2, 1);
+	mpn_tdiv_qr(l, rem, 0, u, kp2, p, kp);
+
+	//L_p(u)*h_p mod p
+	core_mul(prod, l, kl, mpz_limbs_read(branch->h), kh);
+	core_mod(branch->result, quot, prod, kl + kh, p, kp);
+	STATS_STOP(branch->stat, start);
+}
+
+/**
+ * Same computation as the CRT decryption of paillier_decrypt, with mpn_sec_powm for the exponentiations:
+ * their running time does not depend on the secret exponents p-1 and q-1.
+ * The branch modulo q is submitted to the thread pool, with its own part of the scratch space.
+ */
+int paillier_core_decrypt(mp_limb_t *plaintext, const mp_limb_t *ciphertext, paillier_private_key *priv, mp_limb_t *scratch) {
+	mp_size_t k = BIT2LIMB(2*mpz_sizeinbase(priv->n, 2));
+	mp_size_t kn = mpz_size(priv->n), kp = mpz_size(priv->p), kq = mpz_size(priv->q), ki = mpz_size(priv->pinvq);
+	mp_srcptr q = mpz_limbs_read(priv->q);
+	mp_ptr mp, mq, quot, x, d, prod, z;
+	core_branch branch_p, branch_q;
+	task_group group;
+
+	if(kp == 0) return -1;
+	STATS_START(start);
+
+	mp = scratch;
+	mq = mp + kp;
+	branch_p = (core_branch){mp, ciphertext, k, priv->p, priv->p2, priv->hp, mq + kq, PAILLIER_STAT_CRT_P, 0};
+	branch_q = (core_branch){mq, ciphertext, k, priv->q, priv->q2, priv->hq,
+		branch_p.scratch + branch_scratch_limbs(priv->p, priv->p2, priv->hp, k), PAILLIER_STAT_CRT_Q, 0};
+
+	DEBUG_MSG("computing plaintext modulo p and q\n");
+	task_group_init(&group);
+	thread_pool_submit(&group, do_core_branch, (void *)&branch_q);
+	do_core_branch((void *)&branch_p);
+	task_group_wait(&group);
+	if(branch_p.status || branch_q.status) return -1;
+
+	DEBUG_MSG("recombination\n");
+	STATS_START(recombine);
+	quot = branch_q.scratch + branch_scratch_limbs(priv->q, priv->q2, priv->hq, k);
+	x = quot + k + 2;
+	d = x + kq;
+	prod = d + kq;
+	z = prod + kq + ki;
+
+	//d = m_q - m_p mod q
+	core_mod(x, quot, mp, kp, q, kq);
+	if(mpn_cmp(mq, x, kq) >= 0) {
+		mpn_sub_n(d, mq, x, kq);
+	}
+	else {
+		mpn_sub_n(d, q, x, kq);
+		mpn_add_n(d, d, mq, kq);
+	}
+
+	//d*(p^{-1} mod q) mod q
+	core_mul(prod, d, kq, mpz_limbs_read(priv->pinvq), ki);
+	core_mod(x, quot, prod, kq + ki, q, kq);
+
+	//m = m_p + p*x, less than n
+	core_mul(z, x, kq, mpz_limbs_read(priv->p), kp);
+	mpn_add(z, z, kq + kp, mp, kp);
+	mpn_copyi(plaintext, z, kn);
+	STATS_STOP(PAILLIER_STAT_RECOMBINE, recombine);
+	STATS_STOP(PAILLIER_STAT_DECRYPT, start);
+
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file paillier_dj.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+int paillier_dj_public_ctx_init(paillier_dj_public_ctx *ctx, paillier_public_key *pub, unsigned int s) {
+	unsigned int j;
+
+	if(s == 0) return -1;
+	ctx->s = s;
+	ctx->len = pub->len;
+	ctx->ns = (mpz_t *)malloc(sizeof(mpz_t)*(s + 2));
+	if(ctx->ns == NULL) {
+		fputs("cannot allocate powers of n!\n", stderr);
+		exit(1);
+	}
+	mpz_init_set_ui(ctx->ns[0], 1);
+	for(j = 1; j <= s + 1; j++) {
+		mpz_init(ctx->ns[j]);
+		mpz_mul(ctx->ns[j], ctx->ns[j - 1], pub->n);
+	}
+	mpz_init2(ctx->t, 2*mpz_sizeinbase(ctx->ns[s + 1], 2) + GMP_NUMB_BITS);
+	return 0;
+}
+
+void paillier_dj_public_ctx_clear(paillier_dj_public_ctx *ctx) {
+	unsigned int j;
+
+	for(j = 0; j <= ctx->s + 1; j++) {
+		mpz_clear(ctx->ns[j]);
+	}
+	free(ctx->ns);
+	mpz_clear(ctx->t);
+}
+
+/**
+ * Keys generated by older versions do not store p and q, which are then recovered from p^2 and q^2.
+ */
+int paillier_dj_private_ctx_init(paillier_dj_private_ctx *ctx, paillier_private_key *priv, unsigned int s) {
+	paillier_public_key pub;
+	mpz_t p, q;
+	unsigned int k;
+
+	if(s == 0) return -1;
+	mpz_init(p);
+	mpz_init(q);
+	if(mpz_sgn(priv->p) != 0) {
+		mpz_set(p, priv->p);
+		mpz_set(q, priv->q);
+	}
+	else {
+		mpz_sqrt(p, priv->p2);
+		mpz_sqrt(q, priv->q2);
+	}
+
+	//public part from n
+	pub.len = priv->len;
+	mpz_init_set(pub.n, priv->n);
+	paillier_dj_public_ctx_init(&ctx->pub, &pub, s);
+	mpz_clear(pub.n);
+
+	DEBUG_MSG("computing lambda and lambda^{-1} mod n^s\n");
+	mpz_init(ctx->lambda);
+	mpz_init(ctx->lambda_inv);
+	mpz_sub_ui(p, p, 1);
+	mpz_sub_ui(q, q, 1);
+	mpz_lcm(ctx->lambda, p, q);
+	mpz_add_ui(p, p, 1);
+	mpz_add_ui(q, q, 1);
+	mpz_invert(ctx->lambda_inv, ctx->lambda, ctx->pub.ns[s]);
+
+	DEBUG_MSG("computing CRT parameters modulo p^{s+1} and q^{s+1}\n");
+	mpz_init(ctx->ps);
+	mpz_init(ctx->qs);
+	mpz_init(ctx->psinvqs);
+	mpz_pow_ui(ctx->ps, p, s + 1);
+	mpz_pow_ui(ctx->qs, q, s + 1);
+	mpz_invert(ctx->psinvqs, ctx->ps, ctx->qs);
+
+	DEBUG_MSG("computing inverses of factorials\n");
+	ctx->factinv = (mpz_t *)malloc(sizeof(mpz_t)*(s + 1));
+	if(ctx->factinv == NULL) {
+		fputs("cannot allocate inverses of factorials!\n", stderr);
+		exit(1);
+	}
+	mpz_init_set_ui(ctx->factinv[0], 1);
+	for(k = 1; k <= s; k++) {
+		mpz_init(ctx->factinv[k]);
+		mpz_fac_ui(ctx->factinv[k], k);
+		mpz_invert(ctx->factinv[k], ctx->factinv[k], ctx->pub.ns[s]);
+	}
+
+	mpz_clear(p);
+	mpz_clear(q);
+	return 0;
+}
+
+void paillier_dj_private_ctx_clear(paillier_dj_private_ctx *ctx) {
+	unsigned int k;
+
+	for(k = 0; k <= ctx->pub.s; k++) {
+		mpz_clear(ctx->factinv[k]);
+	}
+	free(ctx->factinv);
+	mpz_clear(ctx->lambda);
+	mpz_clear(ctx->lambda_inv);
+	mpz_clear(ctx->ps);
+	mpz_clear(ctx->qs);
+	mpz_clear(ctx->psinvqs);
+	paillier_dj_public_ctx_clear(&ctx->pub);
+}
+
+/**
+ * (1+n)^m mod n^{s+1} is computed with the binomial expansion sum_{k=0}^{s} C(m,k)*n^k, without exponentiation,
+ * and the random factor is r^{n^s} mod n^{s+1} for a random r modulo n.
+ */
+int paillier_dj_encrypt(mpz_t ciphertext, mpz_t plaintext, paillier_dj_public_ctx *ctx) {
+	mpz_t r, binomial;
+	unsigned int k;
+
+	mpz_init(r);
+	mpz_init(binomial);
+
+	DEBUG_MSG("computing (1+n)^m\n");
+	mpz_set_ui(binomial, 1);
+	mpz_set_ui(ctx->t, 1);
+	for(k = 1; k <= ctx->s; k++) {
+		//C(m,k) = C(m,k-1)*(m-k+1)/k, an exact division
+		mpz_sub_ui(r, plaintext, k - 1);
+		mpz_mul(binomial, binomial, r);
+		mpz_divexact_ui(binomial, binomial, k);
+		mpz_mul(r, binomial, ctx->ns[k]);
+		mpz_add(ctx->t, ctx->t, r);
+	}
+	mpz_mod(ctx->t, ctx->t, ctx->ns[ctx->s + 1]);
+
+	DEBUG_MSG("generating random number\n");
+	//generate random r and reduce modulo n
+	if(gen_pseudorandom(r, ctx->len)) {
+		mpz_clear(r);
+		mpz_clear(binomial);
+		return -1;
+	}
+	mpz_mod(r, r, ctx->ns[1]);
+	if(mpz_cmp_ui(r, 0) == 0) {
+		fputs("random number is zero!\n", stderr);
+		exit(1);
+	}
+
+	DEBUG_MSG("computing ciphertext\n");
+	//compute r^{n^s} mod n^{s+1}
+	mpz_powm(r, r, ctx->ns[ctx->s], ctx->ns[ctx->s + 1]);
+	mpz_mul(ctx->t, ctx->t, r);
+	mpz_mod(ciphertext, ctx->t, ctx->ns[ctx->s + 1]);
+
+	DEBUG_MSG("freeing memory\n");
+	mpz_clear(r);
+	mpz_clear(binomial);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+/**
+ * The value a = c^lambda mod n^{s+1} equals (1+n)^{i} with i = lambda*m mod n^s.
+ * The digits of i are extracted iteratively as in the paper of Damgard and Jurik: for j=1..s,
+ * L(a mod n^{j+1}) = sum_{k=1}^{j} C(i,k)*n^{k-1} mod n^j, from which i mod n^j is obtained using i mod n^{j-1}.
+ */
+int paillier_dj_decrypt(mpz_t plaintext, mpz_t ciphertext, paillier_dj_private_ctx *ctx) {
+	paillier_dj_public_ctx *pub = &ctx->pub;
+	mpz_t a, i, t1, t2;
+	unsigned int j, k;
+
+	mpz_init(a);
+	mpz_init(i);
+	mpz_init(t1);
+	mpz_init(t2);
+
+	DEBUG_MSG("computing c^lambda mod n^{s+1}\n");
+	crt_exponentiation(a, ciphertext, ctx->lambda, ctx->lambda, ctx->psinvqs, ctx->ps, ctx->qs);
+
+	DEBUG_MSG("extracting lambda*m mod n^s\n");
+	for(j = 1; j <= pub->s; j++) {
+		//t1 = L(a mod n^{j+1})
+		mpz_mod(t1, a, pub->ns[j + 1]);
+		mpz_sub_ui(t1, t1, 1);
+		mpz_divexact(t1, t1, pub->ns[1]);
+
+		//t1 = t1 - sum_{k=2}^{j} C(i,k)*n^{k-1} mod n^j, with t2 = i*(i-1)*...*(i-k+1)
+		mpz_set(t2, i);
+		for(k = 2; k <= j; k++) {
+			mpz_sub_ui(i, i, 1);
+			mpz_mul(t2, t2, i);
+			mpz_mod(t2, t2, pub->ns[j]);
+			mpz_mul(pub->t, t2, pub->ns[k - 1]);
+			mpz_mul(pub->t, pub->t, ctx->factinv[k]);
+			mpz_sub(t1, t1, pub->t);
+			mpz_mod(t1, t1, pub->ns[j]);
+		}
+		mpz_set(i, t1);
+	}
+
+	//m = i*lambda^{-1} mod n^s
+	mpz_mul(i, i, ctx->lambda_inv);
+	mpz_mod(plaintext, i, pub->ns[pub->s]);
+
+	DEBUG_MSG("freeing memory\n");
+	mpz_clear(a);
+	mpz_clear(i);
+	mpz_clear(t1);
+	mpz_clear(t2);
+	DEBUG_MSG("exiting\n");
+	return 0;
+}
+
+int paillier_dj_homomorphic_add(mpz_t ciphertext3, mpz_t ciphertext1, mpz_t ciphertext2, paillier_dj_public_ctx *ctx) {
+	DEBUG_MSG("homomorphic add plaintexts\n");
+	mpz_mul(ctx->t, ciphertext1, ciphertext2);
+	mpz_mod(ciphertext3, ctx->t, ctx->ns[ctx->s + 1]);
+	return 0;
+}
+
+int paillier_dj_homomorphic_multc(mpz_t ciphertext2, mpz_t ciphertext1, mpz_t constant, paillier_dj_public_ctx *ctx) {
+	DEBUG_MSG("homomorphic multiplies plaintext with constant\n");
+	mpz_powm(ciphertext2, ciphertext1, constant, ctx->ns[ctx->s + 1]);
+	return 0;
+}
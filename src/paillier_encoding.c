@@ -0,0 +1,383 @@
+/**
+ * @file paillier_encoding.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <math.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+#if ULONG_MAX < UINT64_MAX
+#error "signed encoding requires unsigned long of at least 64 bits"
+#endif
+
+/** Number of values converted at once by the encoding loops, held in arrays on the stack
+ *
+ * @ingroup Paillier
+ */
+#define ENCODING_BLOCK 256
+
+/** Maximum number of plaintexts held at once by the batch encryptions and decryptions of encoded values
+ *
+ * @ingroup Paillier
+ */
+#define ENCODING_BATCH 4096
+
+/** Encode a block of values given by their magnitudes and signs
+ *
+ * @ingroup Paillier
+ * @param[out] plaintexts output plaintexts, |v| or n-|v|
+ * @param[in] mag input magnitudes |v|
+ * @param[in] sign input sign masks, all ones for negative values and zero otherwise
+ * @param[in] count input number of values
+ * @param[in] n input modulus
+ */
+static void encode_block(mpz_t *plaintexts, const uint64_t *mag, const uint64_t *sign, size_t count, mpz_t n) {
+	size_t i;
+
+	for(i = 0; i < count; i++) {
+		mpz_set_ui(plaintexts[i], mag[i]);
+		if(sign[i]) mpz_sub(plaintexts[i], n, plaintexts[i]);
+	}
+}
+
+/** Encode 64-bit signed integers
+ *
+ * @ingroup Paillier
+ * @see paillier_encode_int64
+ */
+static int encode_int64(mpz_t *plaintexts, const int64_t *values, size_t count, mpz_t n) {
+	uint64_t mag[ENCODING_BLOCK], sign[ENCODING_BLOCK];
+	size_t i, j, len;
+
+	//-2^63 must stay below n/2
+	if(mpz_sizeinbase(n, 2) <= 65) return -1;
+	for(i = 0; i < count; i += len) {
+		len = count - i < ENCODING_BLOCK ? count - i : ENCODING_BLOCK;
+		//branch-free absolute values, which the compiler can vectorize
+		for(j = 0; j < len; j++) {
+			sign[j] = (uint64_t)(values[i + j] >> 63);
+			mag[j] = ((uint64_t)values[i + j] ^ sign[j]) - sign[j];
+		}
+		encode_block(plaintexts + i, mag, sign, len, n);
+	}
+	return 0;
+}
+
+/** Encode fixed-point values
+ *
+ * @ingroup Paillier
+ * @see paillier_encode_double
+ */
+static int encode_double(mpz_t *plaintexts, const double *values, size_t count, int exponent, mpz_t n) {
+	double scaled[ENCODING_BLOCK], scale;
+	uint64_t mag[ENCODING_BLOCK], sign[ENCODING_BLOCK];
+	size_t i, j, len;
+	mpz_t half;
+	int large, result = 0;
+
+	if(exponent < PAILLIER_ENCODING_MIN_EXPONENT || exponent > PAILLIER_ENCODING_MAX_EXPONENT) return -1;
+	if(mpz_sizeinbase(n, 2) <= 65) return -1;
+	scale = ldexp(1.0, exponent);
+	mpz_init(half);
+	mpz_tdiv_q_2exp(half, n, 1);
+
+	for(i = 0; i < count && result == 0; i += len) {
+		len = count - i < ENCODING_BLOCK ? count - i : ENCODING_BLOCK;
+		//scale and round to the nearest integer
+		large = 0;
+		for(j = 0; j < len; j++) {
+			scaled[j] = nearbyint(values[i + j]*scale);
+			large |= !(fabs(scaled[j]) < 0x1p63);
+		}
+
+		if(!large) {
+			for(j = 0; j < len; j++) {
+				sign[j] = -(uint64_t)(scaled[j] < 0);
+				mag[j] = (uint64_t)fabs(scaled[j]);
+			}
+			encode_block(plaintexts + i, mag, sign, len, n);
+			continue;
+		}
+
+		//some values do not fit in 64 bits, or are not finite
+		for(j = 0; j < len; j++) {
+			if(!isfinite(scaled[j])) {
+				result = -1;
+				break;
+			}
+			mpz_set_d(plaintexts[i + j], scaled[j]);
+			if(mpz_cmpabs(plaintexts[i + j], half) > 0) {
+				result = -1;
+				break;
+			}
+			if(mpz_sgn(plaintexts[i + j]) < 0) mpz_add(plaintexts[i + j], plaintexts[i + j], n);
+		}
+	}
+	mpz_clear(half);
+	return result;
+}
+
+/** Decode 64-bit signed integers
+ *
+ * @ingroup Paillier
+ * @see paillier_decode_int64
+ */
+static int decode_int64(int64_t *values, mpz_t *plaintexts, size_t count, mpz_t n) {
+	uint64_t mag[ENCODING_BLOCK], sign[ENCODING_BLOCK];
+	size_t i, j, len;
+	mpz_t half, t;
+	mpz_ptr abs;
+	int result = 0;
+
+	mpz_init(half);
+	mpz_init(t);
+	mpz_tdiv_q_2exp(half, n, 1);
+
+	for(i = 0; i < count && result == 0; i += len) {
+		len = count - i < ENCODING_BLOCK ? count - i : ENCODING_BLOCK;
+		for(j = 0; j < len; j++) {
+			if(mpz_sgn(plaintexts[i + j]) < 0 || mpz_cmp(plaintexts[i + j], n) >= 0) {
+				result = -1;
+				break;
+			}
+			//values above n/2 are negative
+			if(mpz_cmp(plaintexts[i + j], half) > 0) {
+				mpz_sub(t, n, plaintexts[i + j]);
+				abs = t;
+				sign[j] = ~(uint64_t)0;
+			}
+			else {
+				abs = plaintexts[i + j];
+				sign[j] = 0;
+			}
+			mag[j] = mpz_getlimbn(abs, 0);
+			if(mpz_size(abs) > 1 || mag[j] > (uint64_t)INT64_MAX + (sign[j] & 1)) {
+				result = -1;
+				break;
+			}
+		}
+		if(result) break;
+		for(j = 0; j < len; j++) {
+			values[i + j] = (int64_t)((mag[j] ^ sign[j]) - sign[j]);
+		}
+	}
+	mpz_clear(half);
+	mpz_clear(t);
+	return result;
+}
+
+/** Decode fixed-point values
+ *
+ * @ingroup Paillier
+ * @see paillier_decode_double
+ */
+static int decode_double(double *values, mpz_t *plaintexts, size_t count, int exponent, mpz_t n) {
+	double mag[ENCODING_BLOCK], sign[ENCODING_BLOCK], scale;
+	size_t i, j, len;
+	mpz_t half, t;
+	int result = 0;
+
+	if(exponent < PAILLIER_ENCODING_MIN_EXPONENT || exponent > PAILLIER_ENCODING_MAX_EXPONENT) return -1;
+	scale = ldexp(1.0, -exponent);
+	mpz_init(half);
+	mpz_init(t);
+	mpz_tdiv_q_2exp(half, n, 1);
+
+	for(i = 0; i < count && result == 0; i += len) {
+		len = count - i < ENCODING_BLOCK ? count - i : ENCODING_BLOCK;
+		for(j = 0; j < len; j++) {
+			if(mpz_sgn(plaintexts[i + j]) < 0 || mpz_cmp(plaintexts[i + j], n) >= 0) {
+				result = -1;
+				break;
+			}
+			//values above n/2 are negative
+			if(mpz_cmp(plaintexts[i + j], half) > 0) {
+				mpz_sub(t, n, plaintexts[i + j]);
+				mag[j] = mpz_get_d(t);
+				sign[j] = -1.0;
+			}
+			else {
+				mag[j] = mpz_get_d(plaintexts[i + j]);
+				sign[j] = 1.0;
+			}
+		}
+		if(result) break;
+		for(j = 0; j < len; j++) {
+			values[i + j] = sign[j]*mag[j]*scale;
+		}
+	}
+	mpz_clear(half);
+	mpz_clear(t);
+	return result;
+}
+
+int paillier_encode_int64(mpz_t *plaintexts, const int64_t *values, size_t count, paillier_public_key *pub) {
+	return encode_int64(plaintexts, values, count, pub->n);
+}
+
+int paillier_decode_int64(int64_t *values, mpz_t *plaintexts, size_t count, paillier_public_key *pub) {
+	return decode_int64(values, plaintexts, count, pub->n);
+}
+
+/**
+ * Blocks of values that all fit in 64 bits once scaled are converted without going through mpz_set_d.
+ */
+int paillier_encode_double(mpz_t *plaintexts, const double *values, size_t count, int exponent, paillier_public_key *pub) {
+	return encode_double(plaintexts, values, count, exponent, pub->n);
+}
+
+int paillier_decode_double(double *values, mpz_t *plaintexts, size_t count, int exponent, paillier_public_key *pub) {
+	return decode_double(values, plaintexts, count, exponent, pub->n);
+}
+
+/** Allocate the plaintexts of a batch of encoded values
+ *
+ * @ingroup Paillier
+ * @param[in] count input number of values of the batch
+ * @param[in] len input bit length of n
+ * @param[out] nplain output number of allocated plaintexts, at most ENCODING_BATCH
+ * @return array of plaintexts, to be freed with clear_plaintexts, or NULL
+ */
+static mpz_t *alloc_plaintexts(size_t count, mp_bitcnt_t len, size_t *nplain) {
+	mpz_t *plaintexts;
+	size_t i;
+
+	*nplain = count < ENCODING_BATCH ? count : ENCODING_BATCH;
+	plaintexts = (mpz_t *)malloc(sizeof(mpz_t)*(*nplain));
+	if(plaintexts == NULL) return NULL;
+	for(i = 0; i < *nplain; i++) {
+		mpz_init2(plaintexts[i], len);
+	}
+	return plaintexts;
+}
+
+/** Free the plaintexts of a batch of encoded values
+ *
+ * @ingroup Paillier
+ * @param[in] plaintexts input array of plaintexts
+ * @param[in] nplain input number of plaintexts
+ */
+static void clear_plaintexts(mpz_t *plaintexts, size_t nplain) {
+	size_t i;
+
+	for(i = 0; i < nplain; i++) {
+		mpz_clear(plaintexts[i]);
+	}
+	free(plaintexts);
+}
+
+/** Encode and encrypt a batch of integers or fixed-point values
+ *
+ * @ingroup Paillier
+ * @param[out] ciphertexts output array of ciphertexts, already initialized
+ * @param[in] ints input 64-bit signed integers, or NULL
+ * @param[in] reals input fixed-point values if ints is NULL
+ * @param[in] count input number of values
+ * @param[in] exponent input scaling exponent of fixed-point values
+ * @param[in] ctx input public key context, only read
+ * @return 0 if no error
+ *
+ * The values are encoded by slices of at most ENCODING_BATCH plaintexts, allocated once,
+ * and each slice is encrypted by paillier_encrypt_batch_ctx.
+ */
+static int encrypt_encoded(mpz_t *ciphertexts, const int64_t *ints, const double *reals, size_t count, int exponent, paillier_public_ctx *ctx) {
+	mpz_t *plaintexts;
+	size_t i, len, nplain;
+	int result = 0;
+
+	if(count == 0) return 0;
+	plaintexts = alloc_plaintexts(count, ctx->len, &nplain);
+	if(plaintexts == NULL) return -1;
+
+	for(i = 0; i < count && result == 0; i += len) {
+		len = count - i < nplain ? count - i : nplain;
+		DEBUG_MSG("encoding values\n");
+		if(ints) result = encode_int64(plaintexts, ints + i, len, ctx->n);
+		else result = encode_double(plaintexts, reals + i, len, exponent, ctx->n);
+		if(result == 0) result = paillier_encrypt_batch_ctx(ciphertexts + i, plaintexts, len, ctx);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	clear_plaintexts(plaintexts, nplain);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
+
+/** Decrypt and decode a batch of integers or fixed-point values
+ *
+ * @ingroup Paillier
+ * @param[out] ints output 64-bit signed integers, or NULL
+ * @param[out] reals output fixed-point values if ints is NULL
+ * @param[in] ciphertexts input array of ciphertexts
+ * @param[in] count input number of ciphertexts
+ * @param[in] exponent input scaling exponent of fixed-point values
+ * @param[in] priv input private key
+ * @return 0 if no error
+ *
+ * The ciphertexts are decrypted by slices of at most ENCODING_BATCH with paillier_decrypt_batch,
+ * into plaintexts allocated once.
+ */
+static int decrypt_encoded(int64_t *ints, double *reals, mpz_t *ciphertexts, size_t count, int exponent, paillier_private_key *priv) {
+	mpz_t *plaintexts;
+	size_t i, len, nplain;
+	int result = 0;
+
+	if(count == 0) return 0;
+	plaintexts = alloc_plaintexts(count, priv->len, &nplain);
+	if(plaintexts == NULL) return -1;
+
+	for(i = 0; i < count && result == 0; i += len) {
+		len = count - i < nplain ? count - i : nplain;
+		result = paillier_decrypt_batch(plaintexts, ciphertexts + i, len, priv);
+		if(result) break;
+		DEBUG_MSG("decoding values\n");
+		if(ints) result = decode_int64(ints + i, plaintexts, len, priv->n);
+		else result = decode_double(reals + i, plaintexts, len, exponent, priv->n);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	clear_plaintexts(plaintexts, nplain);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
+
+int paillier_encrypt_int64_batch(mpz_t *ciphertexts, const int64_t *values, size_t count, paillier_public_ctx *ctx) {
+	return encrypt_encoded(ciphertexts, values, NULL, count, 0, ctx);
+}
+
+int paillier_encrypt_double_batch(mpz_t *ciphertexts, const double *values, size_t count, int exponent, paillier_public_ctx *ctx) {
+	return encrypt_encoded(ciphertexts, NULL, values, count, exponent, ctx);
+}
+
+int paillier_decrypt_int64_batch(int64_t *values, mpz_t *ciphertexts, size_t count, paillier_private_key *priv) {
+	return decrypt_encoded(values, NULL, ciphertexts, count, 0, priv);
+}
+
+int paillier_decrypt_double_batch(double *values, mpz_t *ciphertexts, size_t count, int exponent, paillier_private_key *priv) {
+	return decrypt_encoded(NULL, values, ciphertexts, count, exponent, priv);
+}
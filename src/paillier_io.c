@@ -26,6 +26,38 @@
 #include "tools.h"
 #include "../include/paillier.h"
 
+/** Tell whether a key stream is in binary format
+ *
+ * @ingroup Paillier
+ * @param[in] fp input stream, left unchanged
+ * @return 1 if the stream starts with the magic number of binary files
+ *
+ * Hexadecimal key files start with the bit length in decimal, so that the first character is enough.
+ */
+static int is_binary(FILE *fp) {
+	int c;
+
+	c = getc(fp);
+	if(c != EOF) ungetc(c, fp);
+	return c == PAILLIER_BIN_MAGIC[0];
+}
+
+/**
+ * The format is detected from the first byte of the stream.
+ */
+int paillier_public_load(paillier_public_key *pub, FILE *fp) {
+	if(is_binary(fp)) return paillier_public_import_bin(pub, fp);
+	return paillier_public_in_str(pub, fp) < 2 ? -1 : 0;
+}
+
+/**
+ * The format is detected from the first byte of the stream.
+ */
+int paillier_private_load(paillier_private_key *priv, FILE *fp) {
+	if(is_binary(fp)) return paillier_private_import_bin(priv, fp);
+	return paillier_private_in_str(priv, fp) < 8 ? -1 : 0;
+}
+
 /**
  * Wrapper to the key generation function using stdio streams as inputs and output.
  * @see paillier_keygen
@@ -72,7 +104,13 @@ int paillier_encrypt_str(FILE *ciphertext, FILE *plaintext, FILE *public_key) {
 
 	//import public key
 	DEBUG_MSG("importing public key: \n");
-	paillier_public_in_str(&pub, public_key);
+	if(paillier_public_load(&pub, public_key)) {
+		DEBUG_MSG("invalid public key\n");
+		mpz_clear(c);
+		mpz_clear(m);
+		paillier_public_clear(&pub);
+		return -1;
+	}
 
 	//convert plaintext from stream
 	DEBUG_MSG("importing plaintext: \n");
@@ -86,7 +124,7 @@ int paillier_encrypt_str(FILE *ciphertext, FILE *plaintext, FILE *public_key) {
 
 	//convert ciphertext to stream
 	DEBUG_MSG("exporting ciphertext: \n");
-	gmp_fprintf(ciphertext, "%Zx\n", c);
+	if(result == 0) gmp_fprintf(ciphertext, "%Zx\n", c);
 
 	DEBUG_MSG("freeing memory\n");
 	mpz_clear(c);
@@ -113,7 +151,14 @@ int paillier_decrypt_str(FILE *plaintext, FILE *ciphertext, FILE *private_key) {
 
 	//import private key
 	DEBUG_MSG("importing private key: \n");
-	paillier_private_in_str(&priv, private_key);
+	if(paillier_private_load(&priv, private_key)) {
+		DEBUG_MSG("invalid private key\n");
+		mpz_clear(c);
+		mpz_clear(m);
+		mpz_clear(n2);
+		paillier_private_clear(&priv);
+		return -1;
+	}
 
 	//compute n^2
 	mpz_mul(n2, priv.n, priv.n);
@@ -158,7 +203,15 @@ int paillier_homomorphic_add_str(FILE *ciphertext3, FILE *ciphertext1, FILE *cip
 
 	//import public key
 	DEBUG_MSG("importing public key: \n");
-	paillier_public_in_str(&pub, public_key);
+	if(paillier_public_load(&pub, public_key)) {
+		DEBUG_MSG("invalid public key\n");
+		mpz_clear(c3);
+		mpz_clear(c1);
+		mpz_clear(c2);
+		mpz_clear(n2);
+		paillier_public_clear(&pub);
+		return -1;
+	}
 
 	//compute n^2
 	mpz_mul(n2, pub.n, pub.n);
@@ -208,7 +261,15 @@ int paillier_homomorphic_multc_str(FILE *ciphertext2, FILE *ciphertext1, FILE *c
 
 	//import public key
 	DEBUG_MSG("importing public key: \n");
-	paillier_public_in_str(&pub, public_key);
+	if(paillier_public_load(&pub, public_key)) {
+		DEBUG_MSG("invalid public key\n");
+		mpz_clear(c2);
+		mpz_clear(c1);
+		mpz_clear(k);
+		mpz_clear(n2);
+		paillier_public_clear(&pub);
+		return -1;
+	}
 
 	//compute n^2
 	mpz_mul(n2, pub.n, pub.n);
@@ -241,3 +302,47 @@ int paillier_homomorphic_multc_str(FILE *ciphertext2, FILE *ciphertext1, FILE *c
 	return result;
 }
 
+
+/**
+ * The format of the input is detected from its first byte.
+ */
+int paillier_public_convert_str(FILE *out, FILE *in) {
+	paillier_public_key pub;
+	int binary, result;
+
+	paillier_public_init(&pub);
+	binary = is_binary(in);
+	result = paillier_public_load(&pub, in);
+	if(result == 0) {
+		if(binary) {
+			result = paillier_public_out_str(out, &pub) < 0 ? -1 : 0;
+		}
+		else {
+			result = paillier_public_out_bin(out, &pub);
+		}
+	}
+	paillier_public_clear(&pub);
+	return result;
+}
+
+/**
+ * The format of the input is detected from its first byte.
+ */
+int paillier_private_convert_str(FILE *out, FILE *in) {
+	paillier_private_key priv;
+	int binary, result;
+
+	paillier_private_init(&priv);
+	binary = is_binary(in);
+	result = paillier_private_load(&priv, in);
+	if(result == 0) {
+		if(binary) {
+			result = paillier_private_out_str(out, &priv) < 0 ? -1 : 0;
+		}
+		else {
+			result = paillier_private_out_bin(out, &priv);
+		}
+	}
+	paillier_private_clear(&priv);
+	return result;
+}
@@ -23,11 +23,13 @@
  *
  */
 
+#include <stdlib.h>
 #include "../include/paillier.h"
 #include "tools.h"
 
 void paillier_public_init(paillier_public_key *pub) {
 	mpz_init(pub->n);
+	mpz_init(pub->hs);
 }
 
 void paillier_private_init(paillier_private_key *priv) {
@@ -38,10 +40,105 @@ void paillier_private_init(paillier_private_key *priv) {
 	mpz_init(priv->p2invq2);
 	mpz_init(priv->ninv);
 	mpz_init(priv->n);
+	mpz_init(priv->p);
+	mpz_init(priv->q);
+	mpz_init(priv->pinvq);
+	mpz_init(priv->hp);
+	mpz_init(priv->hq);
+}
+
+/**
+ * The scratch variables are allocated for products of two numbers modulo n^2,
+ * so that operations with the context do not need to re-allocate memory.
+ *
+ * If the public key has h_s, window i of the table holds h_s^{j*2^{w*i}} mod n^2 for j=1..2^w-1,
+ * and the first entry of window i+1 is the product of the first and last entries of window i.
+ */
+void paillier_public_ctx_init(paillier_public_ctx *ctx, paillier_public_key *pub) {
+	size_t i, j, entries;
+	mpz_t *window;
+
+	ctx->len = pub->len;
+	mpz_init_set(ctx->n, pub->n);
+	mpz_init(ctx->n2);
+	mpz_mul(ctx->n2, pub->n, pub->n);
+	mpz_init(ctx->g);
+	mpz_add_ui(ctx->g, pub->n, 1);
+	ctx->len2 = mpz_sizeinbase(ctx->n2, 2);
+	mpz_init2(ctx->r, 2*ctx->len2 + GMP_NUMB_BITS);
+	mpz_init2(ctx->t, 2*ctx->len2 + GMP_NUMB_BITS);
+	mpz_init_set(ctx->hs, pub->hs);
+
+	//Montgomery constants and scratch limbs: product, table of odd powers and accumulator
+	ctx->size = mpz_size(ctx->n2);
+	ctx->minv = mont_inverse(mpz_getlimbn(ctx->n2, 0));
+	ctx->r2 = (mp_limb_t *)malloc(sizeof(mp_limb_t)*ctx->size);
+	ctx->scratch = (mp_limb_t *)malloc(sizeof(mp_limb_t)*MONT_POWM_SCRATCH(ctx->size));
+	if(ctx->r2 == NULL || ctx->scratch == NULL) {
+		fputs("cannot allocate Montgomery scratch!\n", stderr);
+		exit(1);
+	}
+	mpz_set_ui(ctx->t, 0);
+	mpz_setbit(ctx->t, 2*ctx->size*GMP_NUMB_BITS);
+	mpz_mod(ctx->t, ctx->t, ctx->n2);
+	mpn_copyi(ctx->r2, mpz_limbs_read(ctx->t), mpz_size(ctx->t));
+	mpn_zero(ctx->r2 + mpz_size(ctx->t), ctx->size - mpz_size(ctx->t));
+
+	ctx->alpha_len = (pub->len + 1)/2;
+	ctx->window = DJN_WINDOW;
+	ctx->windows = (ctx->alpha_len + ctx->window - 1)/ctx->window;
+	ctx->table = NULL;
+	if(mpz_sgn(pub->hs) == 0) return;
+
+	DEBUG_MSG("computing fixed-base table\n");
+	entries = (1UL << ctx->window) - 1;
+	ctx->table = (mpz_t *)malloc(sizeof(mpz_t)*entries*ctx->windows);
+	if(ctx->table == NULL) {
+		fputs("cannot allocate fixed-base table!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < ctx->windows; i++) {
+		window = ctx->table + i*entries;
+		for(j = 0; j < entries; j++) {
+			mpz_init2(window[j], ctx->len2);
+		}
+		//first entry is h_s for the first window, and the last entry of the previous window times its first entry otherwise
+		if(i == 0) {
+			mpz_mod(window[0], pub->hs, ctx->n2);
+		}
+		else {
+			mpz_mul(ctx->t, window[-1], window[-(long)entries]);
+			mpz_mod(window[0], ctx->t, ctx->n2);
+		}
+		for(j = 1; j < entries; j++) {
+			mpz_mul(ctx->t, window[j - 1], window[0]);
+			mpz_mod(window[j], ctx->t, ctx->n2);
+		}
+	}
 }
 
 void paillier_public_clear(paillier_public_key *pub) {
 	mpz_clear(pub->n);
+	mpz_clear(pub->hs);
+}
+
+void paillier_public_ctx_clear(paillier_public_ctx *ctx) {
+	size_t i;
+
+	mpz_clear(ctx->n);
+	mpz_clear(ctx->n2);
+	mpz_clear(ctx->g);
+	mpz_clear(ctx->r);
+	mpz_clear(ctx->t);
+	mpz_clear(ctx->hs);
+	free(ctx->r2);
+	free(ctx->scratch);
+	if(ctx->table != NULL) {
+		for(i = 0; i < ((1UL << ctx->window) - 1)*ctx->windows; i++) {
+			mpz_clear(ctx->table[i]);
+		}
+		free(ctx->table);
+	}
 }
 
 void paillier_private_clear(paillier_private_key *priv) {
@@ -52,18 +149,49 @@ void paillier_private_clear(paillier_private_key *priv) {
 	mpz_clear(priv->p2invq2);
 	mpz_clear(priv->ninv);
 	mpz_clear(priv->n);
+	mpz_clear(priv->p);
+	mpz_clear(priv->q);
+	mpz_clear(priv->pinvq);
+	mpz_clear(priv->hp);
+	mpz_clear(priv->hq);
+}
+
+/**
+ * Since g=1+n, g^{p-1} = 1+(p-1)*n mod p^2, therefore L_p(g^{p-1} mod p^2) = (p-1)*q = -q mod p
+ * and h_p = (-q)^{-1} mod p. The same holds for h_q, and no exponentiation is needed.
+ */
+int paillier_private_crt_init(paillier_private_key *priv) {
+	if(!mpz_invert(priv->pinvq, priv->p, priv->q)) return -1;
+
+	//h_p = (-q)^{-1} mod p
+	mpz_mod(priv->hp, priv->q, priv->p);
+	mpz_sub(priv->hp, priv->p, priv->hp);
+	if(!mpz_invert(priv->hp, priv->hp, priv->p)) return -1;
+
+	//h_q = (-p)^{-1} mod q
+	mpz_mod(priv->hq, priv->p, priv->q);
+	mpz_sub(priv->hq, priv->q, priv->hq);
+	if(!mpz_invert(priv->hq, priv->hq, priv->q)) return -1;
+
+	return 0;
 }
 
 int paillier_public_out_str(FILE *fp, paillier_public_key *pub) {
 	int printf_ret, result = 0;
 
-	printf_ret = gmp_fprintf(fp, "%d\n", pub->len);
+	printf_ret = gmp_fprintf(fp, "%lu\n", pub->len);
 	if(printf_ret < 0) return printf_ret;
 	result += printf_ret;
 	DEBUG_MSG("output modulus n\n");
 	printf_ret = gmp_fprintf(fp, "%Zx\n", pub->n);
 	if(printf_ret < 0) return printf_ret;
 	result += printf_ret;
+	if(mpz_sgn(pub->hs) != 0) {
+		DEBUG_MSG("output h_s\n");
+		printf_ret = gmp_fprintf(fp, "%Zx\n", pub->hs);
+		if(printf_ret < 0) return printf_ret;
+		result += printf_ret;
+	}
 
 	return result;
 }
@@ -71,7 +199,7 @@ int paillier_public_out_str(FILE *fp, paillier_public_key *pub) {
 int paillier_private_out_str(FILE *fp, paillier_private_key *priv) {
 	int printf_ret, result = 0;
 
-	printf_ret = gmp_fprintf(fp, "%d\n", priv->len);
+	printf_ret = gmp_fprintf(fp, "%lu\n", priv->len);
 	if(printf_ret < 0) return printf_ret;
 	result += printf_ret;
 	printf_ret = gmp_fprintf(fp, "%Zx\n", priv->lambda);
@@ -96,6 +224,24 @@ int paillier_private_out_str(FILE *fp, paillier_private_key *priv) {
 	if(printf_ret < 0) return printf_ret;
 	result += printf_ret;
 
+	//CRT decryption parameters are only written when available
+	if(mpz_sgn(priv->p) == 0) return result;
+	printf_ret = gmp_fprintf(fp, "%Zx\n", priv->p);
+	if(printf_ret < 0) return printf_ret;
+	result += printf_ret;
+	printf_ret = gmp_fprintf(fp, "%Zx\n", priv->q);
+	if(printf_ret < 0) return printf_ret;
+	result += printf_ret;
+	printf_ret = gmp_fprintf(fp, "%Zx\n", priv->pinvq);
+	if(printf_ret < 0) return printf_ret;
+	result += printf_ret;
+	printf_ret = gmp_fprintf(fp, "%Zx\n", priv->hp);
+	if(printf_ret < 0) return printf_ret;
+	result += printf_ret;
+	printf_ret = gmp_fprintf(fp, "%Zx\n", priv->hq);
+	if(printf_ret < 0) return printf_ret;
+	result += printf_ret;
+
 	return result;
 }
 
@@ -103,13 +249,21 @@ int paillier_public_in_str(paillier_public_key *pub, FILE *fp) {
 	int scanf_ret, result = 0;
 
 	DEBUG_MSG("importing bit length\n");
-	scanf_ret = gmp_fscanf(fp, "%d\n", &(pub->len));
+	scanf_ret = gmp_fscanf(fp, "%lu\n", &(pub->len));
 	if(scanf_ret < 0) return scanf_ret;
 	result += scanf_ret;
 	DEBUG_MSG("importing modulus\n");
 	scanf_ret = gmp_fscanf(fp, "%Zx\n", pub->n);
 	if(scanf_ret < 0) return scanf_ret;
 	result += scanf_ret;
+	//h_s is optional
+	DEBUG_MSG("importing h_s\n");
+	if(gmp_fscanf(fp, "%Zx\n", pub->hs) == 1) {
+		result++;
+	}
+	else {
+		mpz_set_ui(pub->hs, 0);
+	}
 
 	return result;
 }
@@ -118,7 +272,7 @@ int paillier_private_in_str(paillier_private_key *priv, FILE *fp) {
 	int scanf_ret, result = 0;
 
 	DEBUG_MSG("importing bit length\n");
-	scanf_ret = gmp_fscanf(fp, "%d\n", &(priv->len));
+	scanf_ret = gmp_fscanf(fp, "%lu\n", &(priv->len));
 	if(scanf_ret < 0) return scanf_ret;
 	result += scanf_ret;
 	DEBUG_MSG("importing lambda\n");
@@ -150,5 +304,35 @@ int paillier_private_in_str(paillier_private_key *priv, FILE *fp) {
 	if(scanf_ret < 0) return scanf_ret;
 	result += scanf_ret;
 
+	//keys from older versions end here, recover p and q from p^2 and q^2
+	DEBUG_MSG("importing p\n");
+	scanf_ret = gmp_fscanf(fp, "%Zx\n", priv->p);
+	if(scanf_ret == EOF) {
+		DEBUG_MSG("re-computing p, q, p^-1 mod q, h_p and h_q\n");
+		mpz_sqrt(priv->p, priv->p2);
+		mpz_sqrt(priv->q, priv->q2);
+		if(paillier_private_crt_init(priv)) mpz_set_ui(priv->p, 0);
+		return result;
+	}
+	//otherwise all of p, q, p^-1 mod q, h_p and h_q must be present
+	if(scanf_ret < 1) return -1;
+	result += scanf_ret;
+	DEBUG_MSG("importing q\n");
+	scanf_ret = gmp_fscanf(fp, "%Zx\n", priv->q);
+	if(scanf_ret < 1) return -1;
+	result += scanf_ret;
+	DEBUG_MSG("importing p^-1 mod q\n");
+	scanf_ret = gmp_fscanf(fp, "%Zx\n", priv->pinvq);
+	if(scanf_ret < 1) return -1;
+	result += scanf_ret;
+	DEBUG_MSG("importing h_p\n");
+	scanf_ret = gmp_fscanf(fp, "%Zx\n", priv->hp);
+	if(scanf_ret < 1) return -1;
+	result += scanf_ret;
+	DEBUG_MSG("importing h_q\n");
+	scanf_ret = gmp_fscanf(fp, "%Zx\n", priv->hq);
+	if(scanf_ret < 1) return -1;
+	result += scanf_ret;
+
 	return result;
 }
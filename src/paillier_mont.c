@@ -0,0 +1,106 @@
+/**
+ * @file paillier_mont.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+void paillier_mont_init(paillier_mont_ciphertext *c, paillier_public_ctx *ctx) {
+	c->size = ctx->size;
+	c->limbs = (mp_limb_t *)calloc(c->size, sizeof(mp_limb_t));
+	if(c->limbs == NULL) {
+		fputs("cannot allocate ciphertext!\n", stderr);
+		exit(1);
+	}
+}
+
+void paillier_mont_clear(paillier_mont_ciphertext *c) {
+	free(c->limbs);
+}
+
+/**
+ * The ciphertext is reduced modulo n^2 if necessary, and multiplied with R^2 mod n^2 in the Montgomery domain,
+ * which gives c*R^2*R^{-1} = c*R mod n^2.
+ */
+int paillier_mont_import(paillier_mont_ciphertext *out, mpz_t ciphertext, paillier_public_ctx *ctx) {
+	mpz_srcptr c = ciphertext;
+	mp_size_t size;
+
+	if(mpz_sgn(ciphertext) < 0 || mpz_cmp(ciphertext, ctx->n2) >= 0) {
+		mpz_mod(ctx->t, ciphertext, ctx->n2);
+		c = ctx->t;
+	}
+	size = mpz_size(c);
+	mpn_copyi(out->limbs, mpz_limbs_read(c), size);
+	mpn_zero(out->limbs + size, ctx->size - size);
+
+	mont_mul(out->limbs, out->limbs, ctx->r2, mpz_limbs_read(ctx->n2), ctx->size, ctx->minv, ctx->scratch);
+	return 0;
+}
+
+/**
+ * A Montgomery multiplication with 1 gives c*R*R^{-1} = c mod n^2.
+ */
+int paillier_mont_export(mpz_t ciphertext, paillier_mont_ciphertext *in, paillier_public_ctx *ctx) {
+	mp_limb_t *one = ctx->scratch + 2*ctx->size;
+
+	mpn_zero(one, ctx->size);
+	one[0] = 1;
+	mont_mul(mpz_limbs_write(ciphertext, ctx->size), in->limbs, one,
+			mpz_limbs_read(ctx->n2), ctx->size, ctx->minv, ctx->scratch);
+	mpz_limbs_finish(ciphertext, ctx->size);
+	return 0;
+}
+
+/**
+ * In the Montgomery domain, (c1*R)*(c2*R)*R^{-1} = c1*c2*R mod n^2, so that addition is a single Montgomery multiplication.
+ */
+int paillier_mont_add(paillier_mont_ciphertext *ciphertext3, paillier_mont_ciphertext *ciphertext1, paillier_mont_ciphertext *ciphertext2, paillier_public_ctx *ctx) {
+	mont_mul(ciphertext3->limbs, ciphertext1->limbs, ciphertext2->limbs,
+			mpz_limbs_read(ctx->n2), ctx->size, ctx->minv, ctx->scratch);
+	return 0;
+}
+
+/**
+ * The exponentiation with sliding windows is done by mont_powm, in the scratch limbs of the context.
+ */
+int paillier_mont_multc(paillier_mont_ciphertext *ciphertext2, paillier_mont_ciphertext *ciphertext1, mpz_t constant, paillier_public_ctx *ctx) {
+	mp_size_t k = ctx->size;
+	mp_srcptr m = mpz_limbs_read(ctx->n2);
+	mp_limb_t *one = ctx->scratch + 2*k;
+
+	if(mpz_sgn(constant) < 0) return -1;
+	if(mpz_sgn(constant) == 0) {
+		//c^0 = 1, that is R mod n^2 in the Montgomery domain
+		mpn_zero(one, k);
+		one[0] = 1;
+		mont_mul(ciphertext2->limbs, one, ctx->r2, m, k, ctx->minv, ctx->scratch);
+		return 0;
+	}
+
+	mont_powm(ciphertext2->limbs, ciphertext1->limbs, mpz_limbs_read(constant), mpz_size(constant), m, k, ctx->minv, ctx->scratch);
+	return 0;
+}
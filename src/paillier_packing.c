@@ -0,0 +1,133 @@
+/**
+ * @file paillier_packing.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdint.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+#if GMP_NUMB_BITS < 64
+#error "plaintext packing requires limbs of at least 64 bits"
+#endif
+
+/**
+ * The slots must fit in one bit less than n, so that the packed plaintext stays below n even when all slots are full.
+ * The actual bit length of n is used, since the product of two len/2-bit primes may have only len-1 bits.
+ */
+int paillier_packing_init(paillier_packing *packing, paillier_public_key *pub, unsigned int value_bits, unsigned int headroom) {
+	if(value_bits == 0 || value_bits + headroom > 64) return -1;
+	packing->value_bits = value_bits;
+	packing->headroom = headroom;
+	packing->slot_bits = value_bits + headroom;
+	packing->slots = (mpz_sizeinbase(pub->n, 2) - 1)/packing->slot_bits;
+	return packing->slots ? 0 : -1;
+}
+
+/**
+ * The values are or-ed directly into the limbs of the plaintext.
+ * A slot spans at most two limbs, since a slot has at most 64 bits.
+ */
+int paillier_pack(mpz_t plaintext, const uint64_t *values, size_t count, paillier_packing *packing) {
+	mp_size_t size, limb;
+	mp_limb_t *limbs;
+	mp_bitcnt_t offset;
+	unsigned int shift;
+	size_t i;
+
+	if(count > packing->slots) return -1;
+	if(packing->value_bits < 64) {
+		for(i = 0; i < count; i++) {
+			if(values[i] >> packing->value_bits) return -1;
+		}
+	}
+	if(count == 0) {
+		mpz_set_ui(plaintext, 0);
+		return 0;
+	}
+
+	size = BIT2LIMB(count*packing->slot_bits);
+	limbs = mpz_limbs_write(plaintext, size);
+	mpn_zero(limbs, size);
+	for(i = 0; i < count; i++) {
+		offset = i*packing->slot_bits;
+		limb = offset/GMP_NUMB_BITS;
+		shift = offset % GMP_NUMB_BITS;
+		limbs[limb] |= (mp_limb_t)values[i] << shift;
+		if(shift && shift + packing->slot_bits > GMP_NUMB_BITS) {
+			limbs[limb + 1] |= (mp_limb_t)values[i] >> (GMP_NUMB_BITS - shift);
+		}
+	}
+	mpz_limbs_finish(plaintext, size);
+	return 0;
+}
+
+/**
+ * Slots are read with mpz_getlimbn, so that missing high limbs of the plaintext read as zero.
+ */
+int paillier_unpack(uint64_t *values, size_t count, mpz_t plaintext, paillier_packing *packing) {
+	mp_size_t limb;
+	mp_bitcnt_t offset;
+	unsigned int shift;
+	uint64_t value, mask;
+	size_t i;
+
+	if(count > packing->slots) return -1;
+	mask = packing->slot_bits < 64 ? ((uint64_t)1 << packing->slot_bits) - 1 : ~(uint64_t)0;
+	for(i = 0; i < count; i++) {
+		offset = i*packing->slot_bits;
+		limb = offset/GMP_NUMB_BITS;
+		shift = offset % GMP_NUMB_BITS;
+		value = mpz_getlimbn(plaintext, limb) >> shift;
+		if(shift && shift + packing->slot_bits > GMP_NUMB_BITS) {
+			value |= (uint64_t)mpz_getlimbn(plaintext, limb + 1) << (GMP_NUMB_BITS - shift);
+		}
+		values[i] = value & mask;
+	}
+	return 0;
+}
+
+int paillier_encrypt_packed(mpz_t ciphertext, const uint64_t *values, size_t count, paillier_packing *packing, paillier_public_key *pub) {
+	int result;
+
+	DEBUG_MSG("packing values\n");
+	result = paillier_pack(ciphertext, values, count, packing);
+	if(result) return result;
+	return paillier_encrypt(ciphertext, ciphertext, pub);
+}
+
+int paillier_decrypt_packed(uint64_t *values, size_t count, mpz_t ciphertext, paillier_packing *packing, paillier_private_key *priv) {
+	mpz_t plaintext;
+	int result;
+
+	mpz_init(plaintext);
+	result = paillier_decrypt(plaintext, ciphertext, priv);
+	if(result == 0) {
+		DEBUG_MSG("unpacking values\n");
+		result = paillier_unpack(values, count, plaintext, packing);
+	}
+	mpz_clear(plaintext);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
@@ -0,0 +1,402 @@
+/**
+ * @file paillier_pool.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <pthread.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+/** Randomness pool
+ *
+ * @ingroup Paillier
+ *
+ * Ring buffer of pre-computed values r^n mod n^2, filled by background threads and protected by a mutex.
+ * If the public key has h_s, the values are h_s^alpha mod n^2 computed with the fixed-base table of the context.
+ */
+struct paillier_rand_pool {
+	paillier_public_ctx ctx;	/**< public key context, only read */
+	uint64_t fingerprint;		/**< fingerprint of the public key, written to spilled values */
+	mpz_t *slots;				/**< ring buffer of values r^n mod n^2 */
+	size_t capacity;			/**< size of the ring buffer */
+	size_t head;				/**< next slot to be filled */
+	size_t level;				/**< number of filled slots */
+	unsigned long long hits;	/**< number of encryptions served from the pool */
+	unsigned long long misses;	/**< number of encryptions that found the pool empty */
+	unsigned long long generated;	/**< number of values generated */
+	pthread_mutex_t mutex;		/**< protects the ring buffer and counters */
+	pthread_cond_t not_full;	/**< signaled when a value is consumed or the pool stops */
+	int stop;					/**< set when the pool is cleared */
+	unsigned int nthreads;		/**< number of background threads */
+	pthread_t *threads;			/**< background threads */
+};
+
+/** Store a value in the pool if there is room
+ *
+ * @ingroup Paillier
+ * @param[in,out] pool input randomness pool, locked by the caller
+ * @param[in,out] rn input value, swapped with the content of the slot
+ * @return 1 if the value was stored
+ */
+static int pool_push(paillier_rand_pool *pool, mpz_t rn) {
+	if(pool->level == pool->capacity) return 0;
+	mpz_swap(pool->slots[pool->head], rn);
+	pool->head = (pool->head + 1) % pool->capacity;
+	pool->level++;
+	return 1;
+}
+
+/** Take a value from the pool if there is one
+ *
+ * @ingroup Paillier
+ * @param[in,out] pool input randomness pool, locked by the caller
+ * @param[out] rn output value, swapped with the content of the slot
+ * @return 1 if a value was taken
+ */
+static int pool_pop(paillier_rand_pool *pool, mpz_t rn) {
+	size_t tail;
+
+	if(pool->level == 0) return 0;
+	tail = (pool->head + pool->capacity - pool->level) % pool->capacity;
+	mpz_swap(pool->slots[tail], rn);
+	pool->level--;
+	return 1;
+}
+
+/** Background thread filling the pool
+ *
+ * @ingroup Paillier
+ *
+ * Values are computed without holding the lock, and the thread sleeps while the pool is full.
+ */
+static void *pool_filler(void *args) {
+	paillier_rand_pool *pool = (paillier_rand_pool *)args;
+	mpz_t rn, r, t;
+
+	mpz_init2(rn, pool->ctx.len2);
+	mpz_init2(r, pool->ctx.len2);
+	mpz_init2(t, 2*pool->ctx.len2 + GMP_NUMB_BITS);
+	for(;;) {
+		pthread_mutex_lock(&pool->mutex);
+		while(!pool->stop && pool->level == pool->capacity) {
+			pthread_cond_wait(&pool->not_full, &pool->mutex);
+		}
+		if(pool->stop) {
+			pthread_mutex_unlock(&pool->mutex);
+			break;
+		}
+		pthread_mutex_unlock(&pool->mutex);
+
+		//the random source failed, encryptions compute their own values
+		if(gen_noise(rn, &pool->ctx, r, t)) break;
+
+		pthread_mutex_lock(&pool->mutex);
+		if(pool_push(pool, rn)) pool->generated++;
+		pthread_mutex_unlock(&pool->mutex);
+	}
+	mpz_clear(rn);
+	mpz_clear(r);
+	mpz_clear(t);
+	return NULL;
+}
+
+int paillier_rand_pool_init(paillier_rand_pool **pool_ptr, paillier_public_key *pub, size_t capacity, unsigned int nthreads) {
+	paillier_rand_pool *pool;
+	size_t i;
+
+	if(capacity == 0) return -1;
+	pool = (paillier_rand_pool *)malloc(sizeof(paillier_rand_pool));
+	if(pool == NULL) return -1;
+	pool->slots = (mpz_t *)malloc(sizeof(mpz_t)*capacity);
+	pool->threads = (pthread_t *)malloc(sizeof(pthread_t)*(nthreads ? nthreads : 1));
+	if(pool->slots == NULL || pool->threads == NULL) {
+		free(pool->slots);
+		free(pool->threads);
+		free(pool);
+		return -1;
+	}
+
+	paillier_public_ctx_init(&pool->ctx, pub);
+	for(i = 0; i < capacity; i++) {
+		mpz_init(pool->slots[i]);
+	}
+	pool->fingerprint = paillier_public_fingerprint(pub);
+	pool->capacity = capacity;
+	pool->head = 0;
+	pool->level = 0;
+	pool->hits = 0;
+	pool->misses = 0;
+	pool->generated = 0;
+	pool->stop = 0;
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->not_full, NULL);
+
+	DEBUG_MSG("starting randomness pool threads\n");
+	for(i = 0; i < nthreads; i++) {
+		if(pthread_create(&pool->threads[i], NULL, pool_filler, (void *)pool)) break;
+	}
+	pool->nthreads = i;
+
+	*pool_ptr = pool;
+	return 0;
+}
+
+void paillier_rand_pool_clear(paillier_rand_pool *pool) {
+	unsigned int i;
+	size_t j;
+
+	DEBUG_MSG("stopping randomness pool threads\n");
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop = 1;
+	pthread_cond_broadcast(&pool->not_full);
+	pthread_mutex_unlock(&pool->mutex);
+	for(i = 0; i < pool->nthreads; i++) {
+		pthread_join(pool->threads[i], NULL);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	for(j = 0; j < pool->capacity; j++) {
+		mpz_clear(pool->slots[j]);
+	}
+	pthread_mutex_destroy(&pool->mutex);
+	pthread_cond_destroy(&pool->not_full);
+	paillier_public_ctx_clear(&pool->ctx);
+	free(pool->slots);
+	free(pool->threads);
+	free(pool);
+}
+
+/**
+ * Values are computed by the calling thread, without holding the lock.
+ */
+size_t paillier_rand_pool_fill(paillier_rand_pool *pool, size_t count) {
+	mpz_t rn, r, t;
+	size_t i;
+	int stored;
+
+	mpz_init2(rn, pool->ctx.len2);
+	mpz_init2(r, pool->ctx.len2);
+	mpz_init2(t, 2*pool->ctx.len2 + GMP_NUMB_BITS);
+	for(i = 0; i < count; i++) {
+		if(gen_noise(rn, &pool->ctx, r, t)) break;
+		pthread_mutex_lock(&pool->mutex);
+		stored = pool_push(pool, rn);
+		if(stored) pool->generated++;
+		pthread_mutex_unlock(&pool->mutex);
+		if(!stored) break;
+	}
+	mpz_clear(rn);
+	mpz_clear(r);
+	mpz_clear(t);
+	return i;
+}
+
+void paillier_rand_pool_stats(paillier_rand_pool *pool, paillier_rand_pool_counters *counters) {
+	pthread_mutex_lock(&pool->mutex);
+	counters->capacity = pool->capacity;
+	counters->level = pool->level;
+	counters->hits = pool->hits;
+	counters->misses = pool->misses;
+	counters->generated = pool->generated;
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/**
+ * The first line is the fingerprint of the public key, and the values follow in hexadecimal, one per line.
+ * The values are removed from the pool.
+ */
+int paillier_rand_pool_save(FILE *fp, paillier_rand_pool *pool) {
+	mpz_t rn;
+	int printf_ret, result;
+
+	result = fprintf(fp, "key %016llx\n", (unsigned long long)pool->fingerprint);
+	if(result < 0) return result;
+
+	mpz_init(rn);
+	pthread_mutex_lock(&pool->mutex);
+	while(pool_pop(pool, rn)) {
+		printf_ret = gmp_fprintf(fp, "%Zx\n", rn);
+		if(printf_ret < 0) {
+			result = printf_ret;
+			break;
+		}
+		result += printf_ret;
+	}
+	pthread_cond_broadcast(&pool->not_full);
+	pthread_mutex_unlock(&pool->mutex);
+	mpz_clear(rn);
+	return result;
+}
+
+/**
+ * Values are read until the end of the stream, until the pool is full or until a value is not between 1 and n^2-1.
+ * Nothing is loaded if the fingerprint on the first line is not the one of the public key of the pool.
+ */
+size_t paillier_rand_pool_load(paillier_rand_pool *pool, FILE *fp) {
+	unsigned long long key;
+	mpz_t rn;
+	size_t count = 0;
+
+	if(fscanf(fp, "key %llx\n", &key) != 1 || key != pool->fingerprint) {
+		DEBUG_MSG("values spilled for another key\n");
+		return 0;
+	}
+
+	mpz_init(rn);
+	pthread_mutex_lock(&pool->mutex);
+	while(pool->level < pool->capacity && gmp_fscanf(fp, "%Zx\n", rn) == 1) {
+		if(mpz_sgn(rn) <= 0 || mpz_cmp(rn, pool->ctx.n2) >= 0) break;
+		pool_push(pool, rn);
+		count++;
+	}
+	pthread_mutex_unlock(&pool->mutex);
+	mpz_clear(rn);
+	return count;
+}
+
+/** Take values r^n mod n^2 from the pool
+ *
+ * @ingroup Paillier
+ * @param[in,out] pool input randomness pool
+ * @param[out] rn output array of count values r^n mod n^2, already initialized
+ * @param[in] count input number of values
+ * @param[in,out] t input scratch variable
+ * @return 0 if no error, -1 if the random source failed
+ *
+ * The pool is locked once for all values. Values missing from the pool are computed on the spot and counted as misses.
+ */
+static int pool_take(paillier_rand_pool *pool, mpz_t *rn, size_t count, mpz_t t) {
+	mpz_t r;
+	size_t i, hits;
+	int result = 0;
+
+	DEBUG_MSG("taking r^n mod n^2 from pool\n");
+	pthread_mutex_lock(&pool->mutex);
+	for(hits = 0; hits < count && pool_pop(pool, rn[hits]); hits++);
+	pool->hits += hits;
+	pool->misses += count - hits;
+	if(hits == 1) pthread_cond_signal(&pool->not_full);
+	else if(hits > 1) pthread_cond_broadcast(&pool->not_full);
+	pthread_mutex_unlock(&pool->mutex);
+
+	if(hits < count) {
+		DEBUG_MSG("pool empty, computing r^n mod n^2\n");
+		mpz_init2(r, pool->ctx.len2);
+		for(i = hits; i < count && result == 0; i++) {
+			result = gen_noise(rn[i], &pool->ctx, r, t);
+		}
+		mpz_clear(r);
+	}
+	return result;
+}
+
+/**
+ * The function calculates c=(1+m*n)*(r^n mod n^2) mod n^2 with r^n mod n^2 taken from the pool.
+ * If the pool is empty, r^n mod n^2 is computed on the spot and the miss is counted.
+ */
+int paillier_encrypt_pool(mpz_t ciphertext, mpz_t plaintext, paillier_rand_pool *pool) {
+	mpz_t rn, t;
+	int result = 0;
+
+	STATS_START(start);
+	mpz_init2(rn, pool->ctx.len2);
+	mpz_init2(t, 2*pool->ctx.len2 + GMP_NUMB_BITS);
+
+	result = pool_take(pool, &rn, 1, t);
+	if(result == 0) {
+		DEBUG_MSG("computing ciphertext\n");
+		//compute (1+m*n)
+		plaintext_factor(t, plaintext, &pool->ctx);
+
+		//multiply with r^n mod n^2
+		mpz_mul(t, t, rn);
+		mpz_mod(ciphertext, t, pool->ctx.n2);
+		STATS_STOP(PAILLIER_STAT_ENCRYPT, start);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	mpz_clear(rn);
+	mpz_clear(t);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
+
+/**
+ * The function calculates c*(r^n mod n^2) mod n^2 with r^n mod n^2 taken from the pool.
+ * If the pool is empty, r^n mod n^2 is computed on the spot and the miss is counted.
+ */
+int paillier_rerandomize_pool(mpz_t output, mpz_t ciphertext, paillier_rand_pool *pool) {
+	mpz_t rn, t;
+	int result;
+
+	mpz_init2(rn, pool->ctx.len2);
+	mpz_init2(t, 2*pool->ctx.len2 + GMP_NUMB_BITS);
+
+	result = pool_take(pool, &rn, 1, t);
+	if(result == 0) {
+		//multiply with r^n mod n^2
+		mpz_mul(t, ciphertext, rn);
+		mpz_mod(output, t, pool->ctx.n2);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	mpz_clear(rn);
+	mpz_clear(t);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
+
+/**
+ * All values are taken from the pool with a single lock acquisition, and the multiplications are done without the lock.
+ */
+int paillier_rerandomize_pool_batch(mpz_t *outputs, mpz_t *ciphertexts, size_t count, paillier_rand_pool *pool) {
+	mpz_t *rn, t;
+	size_t i;
+	int result;
+
+	if(count == 0) return 0;
+	rn = (mpz_t *)malloc(sizeof(mpz_t)*count);
+	if(rn == NULL) return -1;
+	for(i = 0; i < count; i++) {
+		mpz_init(rn[i]);
+	}
+	mpz_init2(t, 2*pool->ctx.len2 + GMP_NUMB_BITS);
+
+	result = pool_take(pool, rn, count, t);
+
+	DEBUG_MSG("multiplying with r^n mod n^2\n");
+	for(i = 0; i < count && result == 0; i++) {
+		mpz_mul(t, ciphertexts[i], rn[i]);
+		mpz_mod(outputs[i], t, pool->ctx.n2);
+	}
+
+	DEBUG_MSG("freeing memory\n");
+	for(i = 0; i < count; i++) {
+		mpz_clear(rn[i]);
+	}
+	free(rn);
+	mpz_clear(t);
+	DEBUG_MSG("exiting\n");
+	return result;
+}
@@ -0,0 +1,647 @@
+/**
+ * @file paillier_server.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+//for accept4
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include "../include/paillier.h"
+#include "tools.h"
+#include "thread_pool.h"
+
+/** Maximum payload of a request, in bytes
+ *
+ * @ingroup Paillier
+ */
+#define SERVER_MAX_PAYLOAD (64 << 20)
+
+/** Maximum number of bytes buffered per connection, before the socket is no longer read
+ *
+ * @ingroup Paillier
+ */
+#define SERVER_MAX_BUFFERED (SERVER_MAX_PAYLOAD + PAILLIER_SERVER_HEADER_SIZE)
+
+/** Maximum number of requests of a connection processed at the same time, before the socket is no longer read
+ *
+ * @ingroup Paillier
+ */
+#define SERVER_MAX_PENDING 64
+
+/** Maximum number of events handled per call to epoll_wait
+ *
+ * @ingroup Paillier
+ */
+#define SERVER_EVENTS 64
+
+/** Client connection
+ *
+ * @ingroup Paillier
+ *
+ * The event loop owns the input buffer. Workers append responses to the output buffer under the mutex,
+ * and the event loop writes them to the socket. The socket is not polled for reading while the buffers
+ * or the number of pending requests are at their limits, so that a client cannot queue unbounded work.
+ */
+typedef struct server_conn {
+	int fd;						/**< socket, -1 once closed */
+	unsigned char *in;			/**< received bytes not parsed yet */
+	size_t in_len;				/**< number of bytes in the input buffer */
+	size_t in_cap;				/**< capacity of the input buffer */
+	unsigned char *out;			/**< responses not sent yet */
+	size_t out_len;				/**< number of bytes in the output buffer */
+	size_t out_cap;				/**< capacity of the output buffer */
+	int pending;				/**< number of requests being processed */
+	int eof;					/**< set once the peer has shut down its side of the connection */
+	uint32_t events;			/**< events the socket is polled for */
+	pthread_mutex_t mutex;		/**< protects the output buffer and pending */
+	struct server_conn *next;	/**< next connection of the server */
+} server_conn;
+
+/** Server state
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	paillier_public_key *pub;	/**< resident public key */
+	paillier_private_key *priv;	/**< resident private key, NULL if decryption is disabled */
+	paillier_public_ctx ctx;	/**< resident public key context, only read by the workers */
+	mpz_t n2;					/**< modulus n^2 */
+	int epoll_fd;				/**< event loop */
+	int wake_fd;				/**< eventfd written by workers when a response is ready */
+	server_conn *conns;			/**< list of connections */
+	task_group group;			/**< requests being processed */
+} server_state;
+
+/** Request dispatched to a worker
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	server_state *server;		/**< server */
+	server_conn *conn;			/**< connection of the request */
+	unsigned char header[PAILLIER_SERVER_HEADER_SIZE];	/**< header of the request */
+	unsigned char *payload;		/**< payload of the request */
+	size_t payload_len;			/**< size of the payload */
+} server_job;
+
+/** Write an unsigned 32-bit integer in little-endian order
+ *
+ * @ingroup Paillier
+ */
+static void put_u32(unsigned char *dest, uint32_t value) {
+	dest[0] = (unsigned char)value;
+	dest[1] = (unsigned char)(value >> 8);
+	dest[2] = (unsigned char)(value >> 16);
+	dest[3] = (unsigned char)(value >> 24);
+}
+
+/** Read an unsigned 32-bit integer in little-endian order
+ *
+ * @ingroup Paillier
+ */
+static uint32_t get_u32(const unsigned char *src) {
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/** Make room in a buffer
+ *
+ * @ingroup Paillier
+ * @param[in,out] buffer input buffer, reallocated if necessary
+ * @param[in,out] capacity input capacity of the buffer
+ * @param[in] needed input number of bytes the buffer must hold
+ */
+static void buffer_reserve(unsigned char **buffer, size_t *capacity, size_t needed) {
+	size_t cap = *capacity ? *capacity : 4096;
+
+	if(needed <= *capacity) return;
+	while(cap < needed) cap *= 2;
+	*buffer = (unsigned char *)realloc(*buffer, cap);
+	if(*buffer == NULL) {
+		fputs("cannot allocate server buffer!\n", stderr);
+		exit(1);
+	}
+	*capacity = cap;
+}
+
+/** Parse the operands of a request
+ *
+ * @ingroup Paillier
+ * @param[out] values output array of count integers, already initialized
+ * @param[in] count input number of operands
+ * @param[in] payload input payload, each operand being a 32-bit length followed by little-endian bytes
+ * @param[in] len input size of the payload
+ * @return 0 if no error, -1 if the payload is malformed
+ */
+static int parse_operands(mpz_t *values, size_t count, const unsigned char *payload, size_t len) {
+	size_t i, pos = 0, size;
+
+	for(i = 0; i < count; i++) {
+		if(len - pos < 4) return -1;
+		size = get_u32(payload + pos);
+		pos += 4;
+		if(len - pos < size) return -1;
+		mpz_import(values[i], size, -1, 1, 0, 0, payload + pos);
+		pos += size;
+	}
+	return pos == len ? 0 : -1;
+}
+
+/** Process a request and queue its response
+ *
+ * @ingroup Paillier
+ * @param[in,out] args pointer to a server_job, freed
+ *
+ * Intended to be run as a task of the thread pool.
+ */
+static void do_request(void *args) {
+	server_job *job = (server_job *)args;
+	server_state *server = job->server;
+	server_conn *conn = job->conn;
+	unsigned int op = job->header[4];
+	size_t count = get_u32(job->header + 8), operands, i, size, pos;
+	unsigned char response[PAILLIER_SERVER_HEADER_SIZE];
+	unsigned char *payload = NULL;
+	size_t payload_len = 0, payload_cap = 0;
+	uint64_t wake = 1;
+	mpz_t *in = NULL, *out = NULL;
+	int status = PAILLIER_SERVER_OK;
+
+	//number of operands of each result
+	operands = (op == PAILLIER_SERVER_ADD || op == PAILLIER_SERVER_MULTC) ? 2 : 1;
+	//each operand takes at least 4 bytes, which bounds the memory allocated for a request
+	if(op < PAILLIER_SERVER_ENCRYPT || op > PAILLIER_SERVER_MULTC || (op == PAILLIER_SERVER_DECRYPT && server->priv == NULL)) {
+		status = PAILLIER_SERVER_UNSUPPORTED;
+		count = 0;
+	}
+	else if(count > job->payload_len/(4*operands)) {
+		status = PAILLIER_SERVER_BAD_REQUEST;
+		count = 0;
+	}
+
+	if(status == PAILLIER_SERVER_OK) {
+		in = (mpz_t *)malloc(sizeof(mpz_t)*(operands*count + 1));
+		out = (mpz_t *)malloc(sizeof(mpz_t)*(count + 1));
+		if(in == NULL || out == NULL) {
+			free(in);
+			free(out);
+			in = out = NULL;
+			status = PAILLIER_SERVER_FAILED;
+			count = 0;
+		}
+		for(i = 0; i < operands*count; i++) mpz_init(in[i]);
+		for(i = 0; i < count; i++) mpz_init(out[i]);
+
+		if(status == PAILLIER_SERVER_OK && parse_operands(in, operands*count, job->payload, job->payload_len)) {
+			status = PAILLIER_SERVER_BAD_REQUEST;
+		}
+		//plaintexts must be less than n and ciphertexts less than n^2
+		//constants are reduced modulo n, which leaves the plaintext of the product unchanged and bounds the exponentiation
+		for(i = 0; status == PAILLIER_SERVER_OK && i < operands*count; i++) {
+			if(op == PAILLIER_SERVER_ENCRYPT) {
+				if(mpz_cmp(in[i], server->pub->n) >= 0) status = PAILLIER_SERVER_BAD_REQUEST;
+			}
+			else if(op != PAILLIER_SERVER_MULTC || i % 2 == 0) {
+				if(mpz_cmp(in[i], server->n2) >= 0) status = PAILLIER_SERVER_BAD_REQUEST;
+			}
+			else if(mpz_cmp(in[i], server->pub->n) >= 0) {
+				mpz_mod(in[i], in[i], server->pub->n);
+			}
+		}
+
+		if(status == PAILLIER_SERVER_OK) {
+			switch(op) {
+			case PAILLIER_SERVER_ENCRYPT:
+				if(paillier_encrypt_batch_ctx(out, in, count, &server->ctx)) status = PAILLIER_SERVER_FAILED;
+				break;
+			case PAILLIER_SERVER_DECRYPT:
+				if(paillier_decrypt_batch(out, in, count, server->priv)) status = PAILLIER_SERVER_FAILED;
+				break;
+			case PAILLIER_SERVER_ADD:
+				for(i = 0; i < count; i++) {
+					mpz_mul(out[i], in[2*i], in[2*i + 1]);
+					mpz_mod(out[i], out[i], server->n2);
+				}
+				break;
+			case PAILLIER_SERVER_MULTC:
+				for(i = 0; i < count; i++) {
+					mpz_powm(out[i], in[2*i], in[2*i + 1], server->n2);
+				}
+				break;
+			}
+
+			DEBUG_MSG("serializing results\n");
+			for(i = 0; status == PAILLIER_SERVER_OK && i < count; i++) {
+				STATS_START(start);
+				size = mpz_sgn(out[i]) ? (mpz_sizeinbase(out[i], 2) + 7)/8 : 0;
+				pos = payload_len;
+				payload_len += 4 + size;
+				buffer_reserve(&payload, &payload_cap, payload_len);
+				put_u32(payload + pos, size);
+				mpz_export(payload + pos + 4, NULL, -1, 1, 0, 0, out[i]);
+				STATS_STOP(PAILLIER_STAT_SERIALIZE, start);
+			}
+		}
+		else {
+			payload_len = 0;
+		}
+		for(i = 0; i < operands*count; i++) mpz_clear(in[i]);
+		for(i = 0; i < count; i++) mpz_clear(out[i]);
+		free(in);
+		free(out);
+	}
+
+	memset(response, 0, sizeof(response));
+	memcpy(response, job->header, 4);
+	response[4] = (unsigned char)status;
+	put_u32(response + 8, status == PAILLIER_SERVER_OK ? count : 0);
+	put_u32(response + 12, payload_len);
+
+	pthread_mutex_lock(&conn->mutex);
+	if(conn->fd >= 0) {
+		buffer_reserve(&conn->out, &conn->out_cap, conn->out_len + sizeof(response) + payload_len);
+		memcpy(conn->out + conn->out_len, response, sizeof(response));
+		if(payload_len) memcpy(conn->out + conn->out_len + sizeof(response), payload, payload_len);
+		conn->out_len += sizeof(response) + payload_len;
+	}
+	conn->pending--;
+	pthread_mutex_unlock(&conn->mutex);
+	if(write(server->wake_fd, &wake, sizeof(wake)) < 0) {
+		fputs("cannot wake server!\n", stderr);
+	}
+
+	free(payload);
+	free(job->payload);
+	free(job);
+}
+
+/** Close a connection
+ *
+ * @ingroup Paillier
+ *
+ * The connection is freed later by flush_all, once no request is pending.
+ * Only the event loop closes connections, so that a connection is never freed while an event of the same
+ * call to epoll_wait still refers to it.
+ */
+static void conn_close(server_state *server, server_conn *conn) {
+	pthread_mutex_lock(&conn->mutex);
+	if(conn->fd >= 0) {
+		epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+		close(conn->fd);
+		conn->fd = -1;
+	}
+	pthread_mutex_unlock(&conn->mutex);
+}
+
+/** Update the events a connection is polled for
+ *
+ * @ingroup Paillier
+ *
+ * Must be called with the mutex of the connection held.
+ */
+static void conn_update(server_state *server, server_conn *conn) {
+	struct epoll_event ev;
+	uint32_t events = 0;
+
+	if(conn->fd < 0) return;
+	if(!conn->eof && conn->in_len < SERVER_MAX_BUFFERED && conn->out_len < SERVER_MAX_BUFFERED
+			&& conn->pending < SERVER_MAX_PENDING) events |= EPOLLIN;
+	if(conn->out_len > 0) events |= EPOLLOUT;
+	if(events != conn->events) {
+		conn->events = events;
+		ev.events = events;
+		ev.data.ptr = conn;
+		epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &ev);
+	}
+}
+
+/** Send buffered responses of a connection
+ *
+ * @ingroup Paillier
+ *
+ * The socket is polled for writing while responses remain in the buffer.
+ * Once the peer has shut down its side, the connection is closed after the last response.
+ */
+static void conn_flush(server_state *server, server_conn *conn) {
+	ssize_t ret;
+	size_t sent = 0;
+	int done;
+
+	pthread_mutex_lock(&conn->mutex);
+	while(conn->fd >= 0 && sent < conn->out_len) {
+		ret = send(conn->fd, conn->out + sent, conn->out_len - sent, MSG_NOSIGNAL);
+		if(ret < 0) {
+			if(errno == EINTR) continue;
+			if(errno != EAGAIN && errno != EWOULDBLOCK) {
+				pthread_mutex_unlock(&conn->mutex);
+				conn_close(server, conn);
+				return;
+			}
+			break;
+		}
+		sent += ret;
+	}
+	if(sent > 0) {
+		memmove(conn->out, conn->out + sent, conn->out_len - sent);
+		conn->out_len -= sent;
+	}
+	conn_update(server, conn);
+	done = conn->fd >= 0 && conn->eof && conn->pending == 0 && conn->out_len == 0;
+	pthread_mutex_unlock(&conn->mutex);
+	if(done) conn_close(server, conn);
+}
+
+/** Dispatch the complete requests of the input buffer to the thread pool
+ *
+ * @ingroup Paillier
+ *
+ * At most SERVER_MAX_PENDING requests of the connection are processed at the same time,
+ * the others stay in the input buffer until a response is queued.
+ */
+static void conn_dispatch(server_state *server, server_conn *conn) {
+	server_job *job;
+	size_t pos = 0, payload_len;
+	int full;
+
+	while(conn->fd >= 0 && conn->in_len - pos >= PAILLIER_SERVER_HEADER_SIZE) {
+		payload_len = get_u32(conn->in + pos + 12);
+		if(payload_len > SERVER_MAX_PAYLOAD) {
+			fputs("request too large, closing connection!\n", stderr);
+			conn_close(server, conn);
+			return;
+		}
+		if(conn->in_len - pos < PAILLIER_SERVER_HEADER_SIZE + payload_len) break;
+
+		pthread_mutex_lock(&conn->mutex);
+		full = conn->pending >= SERVER_MAX_PENDING;
+		if(!full) conn->pending++;
+		pthread_mutex_unlock(&conn->mutex);
+		if(full) break;
+
+		job = (server_job *)malloc(sizeof(server_job));
+		if(job == NULL || (job->payload = (unsigned char *)malloc(payload_len + 1)) == NULL) {
+			fputs("cannot allocate request!\n", stderr);
+			exit(1);
+		}
+		job->server = server;
+		job->conn = conn;
+		memcpy(job->header, conn->in + pos, PAILLIER_SERVER_HEADER_SIZE);
+		memcpy(job->payload, conn->in + pos + PAILLIER_SERVER_HEADER_SIZE, payload_len);
+		job->payload_len = payload_len;
+		pos += PAILLIER_SERVER_HEADER_SIZE + payload_len;
+		thread_pool_submit(&server->group, do_request, (void *)job);
+	}
+	if(pos > 0) {
+		memmove(conn->in, conn->in + pos, conn->in_len - pos);
+		conn->in_len -= pos;
+	}
+}
+
+/** Send buffered responses of all connections and free closed connections
+ *
+ * @ingroup Paillier
+ *
+ * Requests left in the input buffers are dispatched first, since responses queued by the workers make room for them.
+ * Must not be called while events of a call to epoll_wait remain to be handled.
+ */
+static void flush_all(server_state *server) {
+	server_conn **link = &server->conns, *conn;
+	int done;
+
+	while((conn = *link) != NULL) {
+		conn_dispatch(server, conn);
+		conn_flush(server, conn);
+		pthread_mutex_lock(&conn->mutex);
+		done = conn->fd < 0 && conn->pending == 0;
+		pthread_mutex_unlock(&conn->mutex);
+		if(done) {
+			*link = conn->next;
+			pthread_mutex_destroy(&conn->mutex);
+			free(conn->in);
+			free(conn->out);
+			free(conn);
+		}
+		else {
+			link = &conn->next;
+		}
+	}
+}
+
+/** Read from a connection and dispatch complete requests to the thread pool
+ *
+ * @ingroup Paillier
+ *
+ * When the peer shuts down its side, the requests already received are still processed and answered.
+ */
+static void conn_read(server_state *server, server_conn *conn) {
+	size_t room;
+	ssize_t ret;
+
+	while(!conn->eof && conn->in_len < SERVER_MAX_BUFFERED) {
+		buffer_reserve(&conn->in, &conn->in_cap, conn->in_len + 65536);
+		room = conn->in_cap - conn->in_len;
+		if(room > SERVER_MAX_BUFFERED - conn->in_len) room = SERVER_MAX_BUFFERED - conn->in_len;
+		ret = recv(conn->fd, conn->in + conn->in_len, room, 0);
+		if(ret < 0 && errno == EINTR) continue;
+		if(ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+		if(ret < 0) {
+			conn_close(server, conn);
+			return;
+		}
+		if(ret == 0) {
+			conn->eof = 1;
+			break;
+		}
+		conn->in_len += ret;
+	}
+
+	conn_dispatch(server, conn);
+	conn_flush(server, conn);
+}
+
+/** Remove a stale socket file
+ *
+ * @ingroup Paillier
+ * @param[in] path input path of the socket
+ *
+ * Nothing is removed if the path is not a socket.
+ */
+static void unlink_socket(const char *path) {
+	struct stat st;
+
+	if(lstat(path, &st) == 0 && S_ISSOCK(st.st_mode)) unlink(path);
+}
+
+/** Accept new connections
+ *
+ * @ingroup Paillier
+ */
+static void server_accept(server_state *server, int listen_fd) {
+	struct epoll_event ev;
+	server_conn *conn;
+	int fd;
+
+	while((fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+		conn = (server_conn *)calloc(1, sizeof(server_conn));
+		if(conn == NULL) {
+			fputs("cannot allocate connection!\n", stderr);
+			exit(1);
+		}
+		conn->fd = fd;
+		conn->events = EPOLLIN;
+		pthread_mutex_init(&conn->mutex, NULL);
+		conn->next = server->conns;
+		server->conns = conn;
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &ev);
+	}
+}
+
+/**
+ * The event loop runs in the calling thread and the requests are processed on the thread pool.
+ * SIGINT, SIGTERM and SIGUSR1 are blocked in the calling thread and received through a signalfd.
+ */
+int paillier_serve(const char *socket_path, paillier_public_key *pub, paillier_private_key *priv) {
+	server_state server;
+	struct sockaddr_un addr;
+	struct epoll_event ev, events[SERVER_EVENTS];
+	struct signalfd_siginfo siginfo;
+	sigset_t signals;
+	server_conn *conn;
+	uint64_t wake;
+	int listen_fd, signal_fd, i, nevents, stop = 0;
+
+	if(strlen(socket_path) >= sizeof(addr.sun_path)) {
+		fputs("socket path too long!\n", stderr);
+		return -1;
+	}
+
+	DEBUG_MSG("creating socket\n");
+	listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if(listen_fd < 0) return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socket_path);
+	unlink_socket(socket_path);
+	if(bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) || listen(listen_fd, SOMAXCONN)) {
+		close(listen_fd);
+		return -1;
+	}
+
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	signal_fd = signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+
+	DEBUG_MSG("pre-computing public key context\n");
+	server.pub = pub;
+	server.priv = priv;
+	server.conns = NULL;
+	paillier_public_ctx_init(&server.ctx, pub);
+	mpz_init(server.n2);
+	mpz_mul(server.n2, pub->n, pub->n);
+	task_group_init(&server.group);
+	//start the workers before the first request
+	thread_pool_size();
+
+	server.epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	server.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+	if(server.epoll_fd < 0 || server.wake_fd < 0 || signal_fd < 0) {
+		fputs("cannot create event loop!\n", stderr);
+		exit(1);
+	}
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listen_fd;
+	epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, listen_fd, &ev);
+	ev.data.ptr = &server.wake_fd;
+	epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, server.wake_fd, &ev);
+	ev.data.ptr = &signal_fd;
+	epoll_ctl(server.epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev);
+
+	DEBUG_MSG("entering event loop\n");
+	while(!stop) {
+		nevents = epoll_wait(server.epoll_fd, events, SERVER_EVENTS, -1);
+		if(nevents < 0 && errno == EINTR) continue;
+		if(nevents < 0) break;
+		for(i = 0; i < nevents; i++) {
+			if(events[i].data.ptr == &listen_fd) {
+				server_accept(&server, listen_fd);
+			}
+			else if(events[i].data.ptr == &server.wake_fd) {
+				//the responses are sent by flush_all after the loop, which may free connections
+				if(read(server.wake_fd, &wake, sizeof(wake)) < 0 && errno != EAGAIN) break;
+			}
+			else if(events[i].data.ptr == &signal_fd) {
+				//consume the signal so that it is not delivered when unblocked
+				if(read(signal_fd, &siginfo, sizeof(siginfo)) != sizeof(siginfo)) continue;
+				if(siginfo.ssi_signo == SIGUSR1) paillier_stats_out_str(stderr);
+				else stop = 1;
+			}
+			else {
+				conn = (server_conn *)events[i].data.ptr;
+				if(conn->fd < 0) continue;
+				if(events[i].events & (EPOLLERR | EPOLLHUP) && !(events[i].events & EPOLLIN)) {
+					conn_close(&server, conn);
+					continue;
+				}
+				if(events[i].events & EPOLLIN) conn_read(&server, conn);
+				if(events[i].events & EPOLLOUT) conn_flush(&server, conn);
+			}
+		}
+		//responses are sent, and closed connections freed once their requests complete, after all events are handled
+		flush_all(&server);
+	}
+
+	DEBUG_MSG("waiting for pending requests\n");
+	close(listen_fd);
+	unlink_socket(socket_path);
+	task_group_wait(&server.group);
+	for(conn = server.conns; conn != NULL; conn = conn->next) {
+		conn_flush(&server, conn);
+		conn_close(&server, conn);
+	}
+	flush_all(&server);
+
+	DEBUG_MSG("freeing memory\n");
+	close(server.epoll_fd);
+	close(server.wake_fd);
+	close(signal_fd);
+	pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+	paillier_public_ctx_clear(&server.ctx);
+	mpz_clear(server.n2);
+	return 0;
+}
@@ -0,0 +1,217 @@
+/**
+ * @file paillier_stats.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "../include/paillier.h"
+#include "tools.h"
+
+/** Names of the statistics probes
+ *
+ * @ingroup Paillier
+ */
+static const char *stats_names[PAILLIER_STAT_COUNT] = {
+	"encrypt", "decrypt", "crt_p", "crt_q", "random", "recombine", "serialize"
+};
+
+const char *paillier_stats_name(unsigned int probe) {
+	return probe < PAILLIER_STAT_COUNT ? stats_names[probe] : NULL;
+}
+
+#ifdef PAILLIER_STATS
+#if defined(__x86_64__) || defined(__i386__)
+#define STATS_UNIT "cycles"
+#else
+#define STATS_UNIT "ns"
+#endif
+
+/** Counters of a thread
+ *
+ * @ingroup Paillier
+ *
+ * Only the owning thread writes the counters, with relaxed atomic loads and stores that compile to plain moves,
+ * so that recording an operation does not need any lock or read-modify-write instruction.
+ * Blocks are never freed, so that the operations of terminated threads are still counted.
+ */
+typedef struct stats_block {
+	atomic_uint generation;		/**< value of stats_generation when the counters were last cleared */
+	atomic_ullong count[PAILLIER_STAT_COUNT];	/**< number of operations per probe */
+	atomic_ullong ticks[PAILLIER_STAT_COUNT];	/**< total duration per probe */
+	atomic_ullong max[PAILLIER_STAT_COUNT];		/**< longest duration per probe */
+	atomic_ullong histogram[PAILLIER_STAT_COUNT][PAILLIER_STAT_BUCKETS];	/**< durations per probe */
+	struct stats_block *next;	/**< next block of the list of all threads */
+} stats_block;
+
+static __thread stats_block *thread_block = NULL;
+static stats_block *_Atomic stats_blocks = NULL;
+static atomic_uint stats_generation = 0;
+
+/** Increment a counter owned by the calling thread
+ *
+ * @ingroup Paillier
+ */
+static inline void stats_add(atomic_ullong *counter, unsigned long long value) {
+	atomic_store_explicit(counter, atomic_load_explicit(counter, memory_order_relaxed) + value, memory_order_relaxed);
+}
+
+/** Clear the counters of a block owned by the calling thread
+ *
+ * @ingroup Paillier
+ */
+static void stats_clear(stats_block *block, unsigned int generation) {
+	unsigned int i, j;
+
+	for(i = 0; i < PAILLIER_STAT_COUNT; i++) {
+		atomic_store_explicit(&block->count[i], 0, memory_order_relaxed);
+		atomic_store_explicit(&block->ticks[i], 0, memory_order_relaxed);
+		atomic_store_explicit(&block->max[i], 0, memory_order_relaxed);
+		for(j = 0; j < PAILLIER_STAT_BUCKETS; j++) {
+			atomic_store_explicit(&block->histogram[i][j], 0, memory_order_relaxed);
+		}
+	}
+	atomic_store_explicit(&block->generation, generation, memory_order_release);
+}
+
+/** Allocate the block of the calling thread and add it to the list
+ *
+ * @ingroup Paillier
+ */
+static stats_block *stats_register(void) {
+	stats_block *block;
+
+	block = (stats_block *)malloc(sizeof(stats_block));
+	if(block == NULL) {
+		fputs("cannot allocate statistics!\n", stderr);
+		exit(1);
+	}
+	stats_clear(block, atomic_load(&stats_generation));
+	block->next = atomic_load_explicit(&stats_blocks, memory_order_relaxed);
+	while(!atomic_compare_exchange_weak_explicit(&stats_blocks, &block->next, block,
+			memory_order_release, memory_order_relaxed));
+	thread_block = block;
+	return block;
+}
+
+void stats_record(unsigned int probe, uint64_t ticks) {
+	stats_block *block = thread_block;
+	unsigned int generation = atomic_load_explicit(&stats_generation, memory_order_relaxed);
+	unsigned int bucket;
+
+	if(block == NULL) block = stats_register();
+	if(atomic_load_explicit(&block->generation, memory_order_relaxed) != generation) {
+		stats_clear(block, generation);
+	}
+
+	bucket = ticks ? 63 - __builtin_clzll(ticks) : 0;
+	if(bucket >= PAILLIER_STAT_BUCKETS) bucket = PAILLIER_STAT_BUCKETS - 1;
+	stats_add(&block->count[probe], 1);
+	stats_add(&block->ticks[probe], ticks);
+	stats_add(&block->histogram[probe][bucket], 1);
+	if(ticks > atomic_load_explicit(&block->max[probe], memory_order_relaxed)) {
+		atomic_store_explicit(&block->max[probe], ticks, memory_order_relaxed);
+	}
+}
+#endif
+
+/**
+ * Blocks that were not updated since the last reset are skipped, since their counters are only cleared lazily.
+ */
+int paillier_stats_snapshot(paillier_stat *stats) {
+#ifdef PAILLIER_STATS
+	stats_block *block;
+	unsigned int generation = atomic_load(&stats_generation), i, j;
+	unsigned long long max;
+#endif
+
+	memset(stats, 0, sizeof(paillier_stat)*PAILLIER_STAT_COUNT);
+#ifdef PAILLIER_STATS
+	for(block = atomic_load_explicit(&stats_blocks, memory_order_acquire); block != NULL; block = block->next) {
+		if(atomic_load_explicit(&block->generation, memory_order_acquire) != generation) continue;
+		for(i = 0; i < PAILLIER_STAT_COUNT; i++) {
+			stats[i].count += atomic_load_explicit(&block->count[i], memory_order_relaxed);
+			stats[i].ticks += atomic_load_explicit(&block->ticks[i], memory_order_relaxed);
+			max = atomic_load_explicit(&block->max[i], memory_order_relaxed);
+			if(max > stats[i].max) stats[i].max = max;
+			for(j = 0; j < PAILLIER_STAT_BUCKETS; j++) {
+				stats[i].histogram[j] += atomic_load_explicit(&block->histogram[i][j], memory_order_relaxed);
+			}
+		}
+	}
+	return 0;
+#else
+	return -1;
+#endif
+}
+
+void paillier_stats_reset(void) {
+#ifdef PAILLIER_STATS
+	atomic_fetch_add(&stats_generation, 1);
+#endif
+}
+
+#ifdef PAILLIER_STATS
+/** Upper bound of a percentile of a histogram
+ *
+ * @ingroup Paillier
+ * @return upper bound of the bucket holding the operation of rank p*count, or the maximal duration if smaller
+ */
+static unsigned long long stats_percentile(paillier_stat *stat, double p) {
+	unsigned long long rank = (unsigned long long)(p*stat->count + 0.999999), seen = 0, bound;
+	unsigned int i;
+
+	if(rank == 0) rank = 1;
+	for(i = 0; i < PAILLIER_STAT_BUCKETS - 1; i++) {
+		seen += stat->histogram[i];
+		if(seen >= rank) break;
+	}
+	bound = ((unsigned long long)2 << i) - 1;
+	return bound < stat->max ? bound : stat->max;
+}
+#endif
+
+int paillier_stats_out_str(FILE *fp) {
+#ifdef PAILLIER_STATS
+	paillier_stat stats[PAILLIER_STAT_COUNT];
+	unsigned int i;
+
+	paillier_stats_snapshot(stats);
+	fprintf(fp, "%-10s %12s %14s %14s %14s %14s %14s  (%s)\n",
+			"probe", "count", "mean", "p50", "p90", "p99", "max", STATS_UNIT);
+	for(i = 0; i < PAILLIER_STAT_COUNT; i++) {
+		fprintf(fp, "%-10s %12llu %14llu %14llu %14llu %14llu %14llu\n", stats_names[i], stats[i].count,
+				stats[i].count ? stats[i].ticks/stats[i].count : 0,
+				stats[i].count ? stats_percentile(&stats[i], 0.5) : 0,
+				stats[i].count ? stats_percentile(&stats[i], 0.9) : 0,
+				stats[i].count ? stats_percentile(&stats[i], 0.99) : 0,
+				stats[i].max);
+	}
+	return 0;
+#else
+	fputs("statistics not compiled in, build with PAILLIER_STATS\n", fp);
+	return -1;
+#endif
+}
@@ -0,0 +1,312 @@
+/**
+ * @file paillier_stream.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include "../include/paillier.h"
+#include "tools.h"
+#include "thread_pool.h"
+
+/** Default number of values per batch of a stream
+ *
+ * @ingroup Paillier
+ */
+#define STREAM_WINDOW 256
+
+/** Batch of values of a stream
+ *
+ * @ingroup Paillier
+ */
+typedef struct stream_batch stream_batch;
+
+/** Operation applied to a batch of a stream
+ *
+ * @ingroup Paillier
+ */
+typedef int (*stream_function)(stream_batch *batch);
+
+struct stream_batch {
+	mpz_t *inputs;			/**< values parsed from the input stream */
+	mpz_t *outputs;			/**< results to be written to the output stream */
+	size_t count;			/**< number of values in the batch */
+	stream_function run;	/**< operation */
+	void *key;				/**< key material of the operation */
+	int result;				/**< return value of the operation */
+};
+
+/** State of a homomorphic sum over a stream
+ *
+ * @ingroup Paillier
+ */
+typedef struct {
+	paillier_public_key *pub;	/**< public key */
+	mpz_t n2;					/**< modulus n^2 */
+	mpz_t sum;					/**< product of the ciphertexts of the previous batches */
+	mpz_t partial;				/**< product of the ciphertexts of the current batch */
+} stream_sum;
+
+/** Run the operation of a batch, as a task of the thread pool
+ *
+ * @ingroup Paillier
+ */
+static void do_stream_batch(void *args) {
+	stream_batch *batch = (stream_batch *)args;
+
+	batch->result = batch->run(batch);
+}
+
+/** Encrypt a batch with the pre-computed public key context
+ *
+ * @ingroup Paillier
+ */
+static int stream_encrypt(stream_batch *batch) {
+	return paillier_encrypt_batch_ctx(batch->outputs, batch->inputs, batch->count, (paillier_public_ctx *)batch->key);
+}
+
+/** Decrypt a batch with the private key
+ *
+ * @ingroup Paillier
+ */
+static int stream_decrypt(stream_batch *batch) {
+	return paillier_decrypt_batch(batch->outputs, batch->inputs, batch->count, (paillier_private_key *)batch->key);
+}
+
+/** Multiply the ciphertexts of a batch into the running sum
+ *
+ * @ingroup Paillier
+ *
+ * Only one batch is processed at a time, so that the running product can be updated without lock.
+ */
+static int stream_add(stream_batch *batch) {
+	stream_sum *state = (stream_sum *)batch->key;
+
+	if(paillier_homomorphic_sum(state->partial, batch->inputs, batch->count, state->pub)) return -1;
+	mpz_mul(state->sum, state->sum, state->partial);
+	mpz_mod(state->sum, state->sum, state->n2);
+	return 0;
+}
+
+/** Parse a batch of hexadecimal values, one per line
+ *
+ * @ingroup Paillier
+ * @param[out] values output array of values, already initialized
+ * @param[in] max input maximum number of values
+ * @param[in] in input stream
+ * @param[in,out] line input line buffer for getline
+ * @param[in,out] capacity input size of the line buffer
+ * @param[in] bound input bound on the values, NULL if the values are not bounded
+ * @return number of values, less than max at the end of the stream,
+ * or -1 if a line is not a hexadecimal number or a value is not less than the bound
+ *
+ * Empty lines are skipped.
+ */
+static long read_batch(mpz_t *values, size_t max, FILE *in, char **line, size_t *capacity, mpz_srcptr bound) {
+	ssize_t length;
+	size_t count = 0;
+
+	while(count < max && (length = getline(line, capacity, in)) >= 0) {
+		while(length > 0 && isspace((unsigned char)(*line)[length - 1])) {
+			(*line)[--length] = '\0';
+		}
+		if(length == 0) continue;
+		if(mpz_set_str(values[count], *line, 16) || mpz_sgn(values[count]) < 0) {
+			fputs("invalid hexadecimal value in stream!\n", stderr);
+			return -1;
+		}
+		if(bound != NULL && mpz_cmp(values[count], bound) >= 0) {
+			fputs("value out of range in stream!\n", stderr);
+			return -1;
+		}
+		count++;
+	}
+	return count;
+}
+
+/** Allocate and initialize an array of integers
+ *
+ * @ingroup Paillier
+ */
+static mpz_t *values_init(size_t count) {
+	mpz_t *values;
+	size_t i;
+
+	values = (mpz_t *)malloc(sizeof(mpz_t)*count);
+	if(values == NULL) {
+		fputs("cannot allocate stream buffers!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < count; i++) {
+		mpz_init(values[i]);
+	}
+	return values;
+}
+
+/** Free an array of integers
+ *
+ * @ingroup Paillier
+ */
+static void values_clear(mpz_t *values, size_t count) {
+	size_t i;
+
+	for(i = 0; i < count; i++) {
+		mpz_clear(values[i]);
+	}
+	free(values);
+}
+
+/** Process a stream by batches
+ *
+ * @ingroup Paillier
+ * @param[out] out output stream, NULL if the operation has no per-value output
+ * @param[in] in input stream
+ * @param[in] run input operation
+ * @param[in] key input key material of the operation
+ * @param[in] window input number of values per batch
+ * @param[in] bound input bound on the input values
+ * @return 0 if no error
+ *
+ * Two batches are in flight: while one batch is processed on the thread pool,
+ * the calling thread writes the results of the previous batch and parses the next one.
+ */
+static int run_stream(FILE *out, FILE *in, stream_function run, void *key, size_t window, mpz_srcptr bound) {
+	stream_batch batches[2];
+	task_group group;
+	char *line = NULL;
+	size_t capacity = 0, i;
+	long count;
+	int current = 0, running = 0, result = 0;
+
+	if(window == 0) window = STREAM_WINDOW;
+	for(i = 0; i < 2; i++) {
+		batches[i].inputs = values_init(window);
+		batches[i].outputs = values_init(out != NULL ? window : 0);
+		batches[i].count = 0;
+		batches[i].run = run;
+		batches[i].key = key;
+	}
+
+	for(;;) {
+		//parse the next batch while the current one is processed
+		count = read_batch(batches[1 - current].inputs, window, in, &line, &capacity, bound);
+
+		if(running) {
+			task_group_wait(&group);
+			running = 0;
+			if(batches[current].result) {
+				result = -1;
+				break;
+			}
+		}
+		if(count < 0) {
+			result = -1;
+			break;
+		}
+
+		//start the next batch
+		if(count > 0) {
+			batches[1 - current].count = count;
+			task_group_init(&group);
+			thread_pool_submit(&group, do_stream_batch, (void *)&batches[1 - current]);
+			running = 1;
+		}
+
+		//write the results of the previous batch while the next one is processed
+		if(out != NULL) {
+			for(i = 0; i < batches[current].count; i++) {
+				STATS_START(start);
+				if(gmp_fprintf(out, "%Zx\n", batches[current].outputs[i]) < 0) result = -1;
+				STATS_STOP(PAILLIER_STAT_SERIALIZE, start);
+			}
+			fflush(out);
+		}
+		batches[current].count = 0;
+		current = 1 - current;
+		if(count == 0 || result) break;
+	}
+	if(running) {
+		task_group_wait(&group);
+		if(batches[current].result) result = -1;
+	}
+
+	free(line);
+	for(i = 0; i < 2; i++) {
+		values_clear(batches[i].inputs, window);
+		values_clear(batches[i].outputs, out != NULL ? window : 0);
+	}
+	return result;
+}
+
+/**
+ * The public key context is computed once for the whole stream.
+ * The plaintexts are checked against n when they are parsed, since the batch encryption does not check them.
+ */
+int paillier_encrypt_stream(FILE *ciphertexts, FILE *plaintexts, paillier_public_key *pub, size_t window) {
+	paillier_public_ctx ctx;
+	int result;
+
+	paillier_public_ctx_init(&ctx, pub);
+	result = run_stream(ciphertexts, plaintexts, stream_encrypt, (void *)&ctx, window, pub->n);
+	paillier_public_ctx_clear(&ctx);
+	return result;
+}
+
+/**
+ * The ciphertexts are checked against n^2 when they are parsed.
+ */
+int paillier_decrypt_stream(FILE *plaintexts, FILE *ciphertexts, paillier_private_key *priv, size_t window) {
+	mpz_t n2;
+	int result;
+
+	mpz_init(n2);
+	mpz_mul(n2, priv->n, priv->n);
+	result = run_stream(plaintexts, ciphertexts, stream_decrypt, (void *)priv, window, n2);
+	mpz_clear(n2);
+	return result;
+}
+
+/**
+ * Each batch is multiplied with paillier_homomorphic_sum and folded into a running product.
+ * The ciphertexts are checked against n^2 when they are parsed.
+ */
+int paillier_sum_stream(FILE *ciphertext, FILE *ciphertexts, paillier_public_key *pub, size_t window) {
+	stream_sum state;
+	int result;
+
+	state.pub = pub;
+	mpz_init(state.n2);
+	mpz_init_set_ui(state.sum, 1);
+	mpz_init(state.partial);
+	mpz_mul(state.n2, pub->n, pub->n);
+
+	result = run_stream(NULL, ciphertexts, stream_add, (void *)&state, window, state.n2);
+	if(result == 0 && gmp_fprintf(ciphertext, "%Zx\n", state.sum) < 0) result = -1;
+
+	mpz_clear(state.n2);
+	mpz_clear(state.sum);
+	mpz_clear(state.partial);
+	return result;
+}
@@ -0,0 +1,323 @@
+/**
+ * @file random.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <sys/random.h>
+#include "../include/paillier.h"
+#include "random.h"
+#include "tools.h"
+
+/** Size of the buffer of the ChaCha20 generator, in bytes
+ *
+ * @ingroup Random
+ */
+#define RANDOM_BUFFER_SIZE 4096
+
+/** Left rotation of a 32-bit word
+ *
+ * @ingroup Random
+ */
+#define ROTL32(v, n) (((v) << (n)) | ((v) >> (32 - (n))))
+
+/** ChaCha20 quarter round
+ *
+ * @ingroup Random
+ */
+#define QUARTERROUND(a, b, c, d) \
+	a += b; d ^= a; d = ROTL32(d, 16); \
+	c += d; b ^= c; b = ROTL32(b, 12); \
+	a += b; d ^= a; d = ROTL32(d, 8); \
+	c += d; b ^= c; b = ROTL32(b, 7)
+
+/** State of the ChaCha20 generator of a thread
+ *
+ * @ingroup Random
+ */
+typedef struct {
+	uint32_t input[16];		/**< ChaCha20 input block: constants, key, counter and nonce */
+	unsigned char buffer[RANDOM_BUFFER_SIZE]; /**< generated bytes */
+	size_t available;		/**< number of unused bytes at the end of the buffer */
+	unsigned long generation; /**< value of fork_generation when the generator was seeded */
+	int seeded;				/**< set once the generator is seeded */
+} chacha20_state;
+
+static __thread chacha20_state thread_state;
+static atomic_ulong fork_generation = 1;
+static pthread_once_t atfork_once = PTHREAD_ONCE_INIT;
+
+static chacha20_state keygen_state;
+static pthread_mutex_t keygen_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static _Atomic(paillier_random_function) random_source = NULL;
+static void *_Atomic random_source_state = NULL;
+static atomic_uint random_source_seq = 0;
+static pthread_mutex_t random_source_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * The source and its state are published with a sequence lock: the sequence number is odd while they are being written,
+ * so that readers never see the function of one source with the state of another.
+ */
+void paillier_set_random_source(paillier_random_function source, void *state) {
+	unsigned int seq;
+
+	pthread_mutex_lock(&random_source_mutex);
+	seq = atomic_load_explicit(&random_source_seq, memory_order_relaxed);
+	atomic_store_explicit(&random_source_seq, seq + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&random_source, source, memory_order_relaxed);
+	atomic_store_explicit(&random_source_state, state, memory_order_relaxed);
+	atomic_store_explicit(&random_source_seq, seq + 2, memory_order_release);
+	pthread_mutex_unlock(&random_source_mutex);
+}
+
+/** Read the current random source
+ *
+ * @ingroup Random
+ * @param[out] state output state of the random source
+ * @return random source, NULL for the default source
+ */
+static paillier_random_function get_random_source(void **state) {
+	paillier_random_function source;
+	unsigned int seq;
+
+	do {
+		seq = atomic_load_explicit(&random_source_seq, memory_order_acquire);
+		source = atomic_load_explicit(&random_source, memory_order_relaxed);
+		*state = atomic_load_explicit(&random_source_state, memory_order_relaxed);
+		atomic_thread_fence(memory_order_acquire);
+	} while((seq & 1) || seq != atomic_load_explicit(&random_source_seq, memory_order_relaxed));
+	return source;
+}
+
+/**
+ * The data is read with the getrandom() system call, which does not block once the kernel entropy pool is initialized.
+ */
+int random_seed(void *buffer, size_t len) {
+	unsigned char *bytes = (unsigned char *)buffer;
+	FILE *dev_urandom;
+	ssize_t ret;
+	size_t byte_read = 0;
+
+	while(byte_read < len) {
+		ret = getrandom(bytes + byte_read, len - byte_read, 0);
+		if(ret < 0) {
+			if(errno == EINTR) continue;
+			break;
+		}
+		byte_read += ret;
+	}
+	if(byte_read == len) return 0;
+
+	//getrandom() not available, fall back to /dev/urandom
+	dev_urandom = fopen("/dev/urandom", "r");
+	if(dev_urandom == NULL) {
+		fprintf(stderr, "cannot open random number device!\n");
+		exit(1);
+	}
+	while(byte_read < len) {
+		byte_read += fread(bytes + byte_read, sizeof(char), len - byte_read, dev_urandom);
+	}
+	fclose(dev_urandom);
+	return 0;
+}
+
+/** Called in the child process after fork
+ *
+ * @ingroup Random
+ *
+ * Forces all generators to be seeded again, so that parent and child do not produce the same numbers.
+ */
+static void random_atfork_child(void) {
+	atomic_fetch_add(&fork_generation, 1);
+}
+
+/** Register the fork handler
+ *
+ * @ingroup Random
+ */
+static void random_register_atfork(void) {
+	pthread_atfork(NULL, NULL, random_atfork_child);
+}
+
+/** Compute a ChaCha20 block
+ *
+ * @ingroup Random
+ * @param[out] output output 64-byte block
+ * @param[in] input input block with constants, key, counter and nonce
+ */
+static void chacha20_block(unsigned char output[64], const uint32_t input[16]) {
+	uint32_t x[16];
+	int i;
+
+	memcpy(x, input, sizeof(x));
+	for(i = 0; i < 10; i++) {
+		QUARTERROUND(x[0], x[4], x[8], x[12]);
+		QUARTERROUND(x[1], x[5], x[9], x[13]);
+		QUARTERROUND(x[2], x[6], x[10], x[14]);
+		QUARTERROUND(x[3], x[7], x[11], x[15]);
+		QUARTERROUND(x[0], x[5], x[10], x[15]);
+		QUARTERROUND(x[1], x[6], x[11], x[12]);
+		QUARTERROUND(x[2], x[7], x[8], x[13]);
+		QUARTERROUND(x[3], x[4], x[9], x[14]);
+	}
+	for(i = 0; i < 16; i++) {
+		x[i] += input[i];
+		output[4*i] = (unsigned char)x[i];
+		output[4*i + 1] = (unsigned char)(x[i] >> 8);
+		output[4*i + 2] = (unsigned char)(x[i] >> 16);
+		output[4*i + 3] = (unsigned char)(x[i] >> 24);
+	}
+}
+
+/** Set the ChaCha20 key and reset the counter
+ *
+ * @ingroup Random
+ * @param[in,out] state input generator state
+ * @param[in] key input 32-byte key
+ */
+static void chacha20_set_key(chacha20_state *state, const unsigned char key[32]) {
+	int i;
+
+	//"expand 32-byte k"
+	state->input[0] = 0x61707865;
+	state->input[1] = 0x3320646e;
+	state->input[2] = 0x79622d32;
+	state->input[3] = 0x6b206574;
+	for(i = 0; i < 8; i++) {
+		state->input[4 + i] = (uint32_t)key[4*i] | ((uint32_t)key[4*i + 1] << 8)
+				| ((uint32_t)key[4*i + 2] << 16) | ((uint32_t)key[4*i + 3] << 24);
+	}
+	for(i = 12; i < 16; i++) {
+		state->input[i] = 0;
+	}
+}
+
+/** Refill the buffer of the generator
+ *
+ * @ingroup Random
+ * @param[in,out] state input generator state
+ *
+ * The first 32 bytes of the new buffer replace the key and are erased,
+ * so that the bytes already handed out cannot be recovered from the state.
+ */
+static void chacha20_refill(chacha20_state *state) {
+	size_t i;
+
+	for(i = 0; i < RANDOM_BUFFER_SIZE; i += 64) {
+		chacha20_block(state->buffer + i, state->input);
+		//64-bit block counter
+		if(++state->input[12] == 0) state->input[13]++;
+	}
+	chacha20_set_key(state, state->buffer);
+	memset(state->buffer, 0, 32);
+	state->available = RANDOM_BUFFER_SIZE - 32;
+}
+
+/** Seed the generator of the calling thread
+ *
+ * @ingroup Random
+ * @param[in,out] state input generator state
+ */
+static void chacha20_seed(chacha20_state *state) {
+	unsigned char key[32];
+
+	pthread_once(&atfork_once, random_register_atfork);
+	random_seed(key, sizeof(key));
+	chacha20_set_key(state, key);
+	memset(key, 0, sizeof(key));
+	state->generation = atomic_load(&fork_generation);
+	state->seeded = 1;
+	chacha20_refill(state);
+}
+
+/** Copy bytes from a generator, refilling its buffer as needed
+ *
+ * @ingroup Random
+ * @param[in,out] state input generator state, seeded
+ * @param[out] bytes output random bytes
+ * @param[in] len input number of bytes
+ */
+static void chacha20_output(chacha20_state *state, unsigned char *bytes, size_t len) {
+	size_t chunk;
+
+	while(len > 0) {
+		if(state->available == 0) {
+			chacha20_refill(state);
+		}
+		chunk = len < state->available ? len : state->available;
+		memcpy(bytes, state->buffer + RANDOM_BUFFER_SIZE - state->available, chunk);
+		memset(state->buffer + RANDOM_BUFFER_SIZE - state->available, 0, chunk);
+		state->available -= chunk;
+		bytes += chunk;
+		len -= chunk;
+	}
+}
+
+/**
+ * The generator of the calling thread only makes a system call when it is seeded,
+ * that is on first use in the thread and after a fork.
+ * Bytes are erased from the buffer once handed out.
+ */
+int random_bytes(void *buffer, size_t len) {
+	chacha20_state *state = &thread_state;
+	paillier_random_function source;
+	void *source_state;
+	int result = 0;
+	STATS_START(start);
+
+	source = get_random_source(&source_state);
+	if(source != NULL) {
+		result = source(source_state, buffer, len) ? -1 : 0;
+	}
+	else {
+		if(!state->seeded || state->generation != atomic_load_explicit(&fork_generation, memory_order_relaxed)) {
+			chacha20_seed(state);
+		}
+		chacha20_output(state, (unsigned char *)buffer, len);
+	}
+	STATS_STOP(PAILLIER_STAT_RANDOM, start);
+	return result;
+}
+
+/**
+ * The key generation generator is shared by all threads and protected by a mutex.
+ * It is seeded with getrandom() on first use and after a fork, so that key generation never blocks on /dev/random
+ * and makes a single system call for any number of keys.
+ */
+int random_keygen_bytes(void *buffer, size_t len) {
+	pthread_mutex_lock(&keygen_mutex);
+	if(!keygen_state.seeded || keygen_state.generation != atomic_load(&fork_generation)) {
+		chacha20_seed(&keygen_state);
+	}
+	chacha20_output(&keygen_state, (unsigned char *)buffer, len);
+	pthread_mutex_unlock(&keygen_mutex);
+	return 0;
+}
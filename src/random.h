@@ -0,0 +1,73 @@
+/**
+ * @file random.h
+ *
+ * @date 		Created on: Oct 16, 2026
+ * @author 		Paillier-GMP contributors
+ * @copyright 	Paillier-GMP contributors, 2026
+ * @defgroup	Random Random number generation for Paillier-GMP
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef RANDOM_H_
+#define RANDOM_H_
+
+#include <stddef.h>
+
+/** Get random bytes from the current random source
+ *
+ * @ingroup Random
+ * @param[out] buffer output random bytes
+ * @param[in] len input number of bytes
+ * @return 0 if no error, -1 if the random source set with paillier_set_random_source failed
+ *
+ * Unless another source was set with paillier_set_random_source, the bytes come from a ChaCha20 generator
+ * owned by the calling thread, seeded with getrandom() and refilled by large blocks.
+ */
+int random_bytes(
+		void *buffer,
+		size_t len);
+
+/** Get random bytes for key generation
+ *
+ * @ingroup Random
+ * @param[out] buffer output random bytes
+ * @param[in] len input number of bytes
+ * @return 0 if no error
+ *
+ * The bytes come from a single ChaCha20 generator shared by all threads, seeded once with getrandom().
+ * It ignores the random source set with paillier_set_random_source.
+ */
+int random_keygen_bytes(
+		void *buffer,
+		size_t len);
+
+/** Get bytes from the entropy source of the operating system
+ *
+ * @ingroup Random
+ * @param[out] buffer output random bytes
+ * @param[in] len input number of bytes
+ * @return 0 if no error
+ *
+ * Uses getrandom(), or /dev/urandom if the system call is not available.
+ */
+int random_seed(
+		void *buffer,
+		size_t len);
+
+#endif /* RANDOM_H_ */
@@ -0,0 +1,327 @@
+/**
+ * @file thread_pool.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <semaphore.h>
+#include <errno.h>
+#include <unistd.h>
+#include "../include/paillier.h"
+#include "thread_pool.h"
+#include "tools.h"
+
+#ifdef PAILLIER_THREAD
+/** Capacity of the task queue, must be a power of two
+ *
+ * @ingroup ThreadPool
+ */
+#define QUEUE_SIZE 4096
+
+/** Slot of the task queue
+ *
+ * @ingroup ThreadPool
+ */
+typedef struct {
+	atomic_size_t sequence;	/**< sequence number telling whether the slot is free or holds a task */
+	task_function run;		/**< task function */
+	void *arg;				/**< argument of the task function */
+	task_group *group;		/**< group of the task */
+} queue_slot;
+
+/** Thread pool
+ *
+ * @ingroup ThreadPool
+ *
+ * The task queue is a bounded multi-producer multi-consumer ring buffer where producers and consumers
+ * reserve slots with compare-and-swap operations on the enqueue and dequeue positions, without locks.
+ * Idle workers sleep on a semaphore posted once per submitted task.
+ */
+typedef struct {
+	queue_slot slots[QUEUE_SIZE];	/**< ring buffer of tasks */
+	atomic_size_t enqueue_pos;		/**< next position to be written */
+	atomic_size_t dequeue_pos;		/**< next position to be read */
+	sem_t work;						/**< posted when a task is submitted */
+	atomic_int stop;				/**< set when the pool shuts down */
+	unsigned int size;				/**< number of worker threads */
+	pthread_t *threads;				/**< worker threads */
+} thread_pool;
+
+static thread_pool *_Atomic pool = NULL;
+static pthread_mutex_t pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+/** Enqueue a task
+ *
+ * @ingroup ThreadPool
+ * @return 1 if the task was enqueued, 0 if the queue is full
+ */
+static int queue_push(thread_pool *tp, task_function run, void *arg, task_group *group) {
+	queue_slot *slot;
+	size_t pos, seq;
+
+	pos = atomic_load_explicit(&tp->enqueue_pos, memory_order_relaxed);
+	for(;;) {
+		slot = &tp->slots[pos & (QUEUE_SIZE - 1)];
+		seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if(seq == pos) {
+			if(atomic_compare_exchange_weak_explicit(&tp->enqueue_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if((long)(seq - pos) < 0) {
+			return 0;
+		}
+		else {
+			pos = atomic_load_explicit(&tp->enqueue_pos, memory_order_relaxed);
+		}
+	}
+	slot->run = run;
+	slot->arg = arg;
+	slot->group = group;
+	atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+	return 1;
+}
+
+/** Dequeue a task
+ *
+ * @ingroup ThreadPool
+ * @return 1 if a task was dequeued, 0 if the queue is empty
+ */
+static int queue_pop(thread_pool *tp, task_function *run, void **arg, task_group **group) {
+	queue_slot *slot;
+	size_t pos, seq;
+
+	pos = atomic_load_explicit(&tp->dequeue_pos, memory_order_relaxed);
+	for(;;) {
+		slot = &tp->slots[pos & (QUEUE_SIZE - 1)];
+		seq = atomic_load_explicit(&slot->sequence, memory_order_acquire);
+		if(seq == pos + 1) {
+			if(atomic_compare_exchange_weak_explicit(&tp->dequeue_pos, &pos, pos + 1,
+					memory_order_relaxed, memory_order_relaxed))
+				break;
+		}
+		else if((long)(seq - (pos + 1)) < 0) {
+			return 0;
+		}
+		else {
+			pos = atomic_load_explicit(&tp->dequeue_pos, memory_order_relaxed);
+		}
+	}
+	*run = slot->run;
+	*arg = slot->arg;
+	*group = slot->group;
+	atomic_store_explicit(&slot->sequence, pos + QUEUE_SIZE, memory_order_release);
+	return 1;
+}
+
+/** Run a task and signal its group if it is the last one
+ *
+ * @ingroup ThreadPool
+ */
+static void run_task(task_function run, void *arg, task_group *group) {
+	run(arg);
+	if(atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel) == 1) {
+		sem_post(&group->done);
+	}
+}
+
+/** Worker thread
+ *
+ * @ingroup ThreadPool
+ */
+static void *worker(void *args) {
+	thread_pool *tp = (thread_pool *)args;
+	task_function run;
+	void *arg;
+	task_group *group;
+
+	for(;;) {
+		if(queue_pop(tp, &run, &arg, &group)) {
+			run_task(run, arg, group);
+		}
+		else if(atomic_load(&tp->stop)) {
+			break;
+		}
+		else {
+			sem_wait(&tp->work);
+		}
+	}
+	return NULL;
+}
+#endif
+
+/**
+ * The threads are only created if the library is compiled with PAILLIER_THREAD.
+ * If the pool is already running, it is left unchanged.
+ */
+int paillier_thread_pool_init(unsigned int nthreads) {
+#ifdef PAILLIER_THREAD
+	thread_pool *tp;
+	unsigned int i;
+	long ncpu;
+
+	pthread_mutex_lock(&pool_mutex);
+	if(atomic_load_explicit(&pool, memory_order_acquire) != NULL) {
+		pthread_mutex_unlock(&pool_mutex);
+		return 0;
+	}
+
+	if(nthreads == 0) {
+		ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+		nthreads = ncpu > 1 ? (unsigned int)ncpu : 1;
+	}
+
+	DEBUG_MSG("starting thread pool\n");
+	tp = (thread_pool *)malloc(sizeof(thread_pool));
+	if(tp == NULL || (tp->threads = (pthread_t *)malloc(sizeof(pthread_t)*nthreads)) == NULL) {
+		fputs("cannot allocate thread pool!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < QUEUE_SIZE; i++) {
+		atomic_init(&tp->slots[i].sequence, i);
+	}
+	atomic_init(&tp->enqueue_pos, 0);
+	atomic_init(&tp->dequeue_pos, 0);
+	atomic_init(&tp->stop, 0);
+	sem_init(&tp->work, 0, 0);
+
+	for(i = 0; i < nthreads; i++) {
+		if(pthread_create(&tp->threads[i], NULL, worker, (void *)tp)) break;
+	}
+	tp->size = i;
+	if(tp->size == 0) {
+		fputs("cannot create worker threads!\n", stderr);
+		exit(1);
+	}
+
+	atomic_store_explicit(&pool, tp, memory_order_release);
+	pthread_mutex_unlock(&pool_mutex);
+#endif
+	return 0;
+}
+
+/**
+ * Queued tasks are completed before the workers exit.
+ * No task may be submitted while the pool is shutting down.
+ */
+void paillier_thread_pool_shutdown(void) {
+#ifdef PAILLIER_THREAD
+	thread_pool *tp;
+	unsigned int i;
+
+	pthread_mutex_lock(&pool_mutex);
+	tp = atomic_load(&pool);
+	if(tp == NULL) {
+		pthread_mutex_unlock(&pool_mutex);
+		return;
+	}
+
+	DEBUG_MSG("stopping thread pool\n");
+	atomic_store(&tp->stop, 1);
+	for(i = 0; i < tp->size; i++) {
+		sem_post(&tp->work);
+	}
+	for(i = 0; i < tp->size; i++) {
+		pthread_join(tp->threads[i], NULL);
+	}
+	atomic_store_explicit(&pool, NULL, memory_order_release);
+	pthread_mutex_unlock(&pool_mutex);
+
+	sem_destroy(&tp->work);
+	free(tp->threads);
+	free(tp);
+#endif
+}
+
+#ifdef PAILLIER_THREAD
+/** Get the running pool, and start it with the default number of threads if necessary
+ *
+ * @ingroup ThreadPool
+ */
+static thread_pool *get_pool(void) {
+	thread_pool *tp;
+
+	tp = atomic_load_explicit(&pool, memory_order_acquire);
+	if(tp == NULL) {
+		paillier_thread_pool_init(0);
+		tp = atomic_load_explicit(&pool, memory_order_acquire);
+	}
+	return tp;
+}
+#endif
+
+unsigned int thread_pool_size(void) {
+#ifdef PAILLIER_THREAD
+	return get_pool()->size;
+#else
+	return 1;
+#endif
+}
+
+void task_group_init(task_group *group) {
+	atomic_init(&group->pending, 1);
+	sem_init(&group->done, 0, 0);
+}
+
+/**
+ * The group counter starts at one, so that it cannot reach zero before all tasks have been submitted.
+ * That extra count is released here; whoever brings the counter to zero posts the semaphore exactly once.
+ */
+void task_group_wait(task_group *group) {
+#ifdef PAILLIER_THREAD
+	thread_pool *tp = get_pool();
+	task_function run;
+	void *arg;
+	task_group *other;
+
+	if(atomic_fetch_sub_explicit(&group->pending, 1, memory_order_acq_rel) != 1) {
+		//help running queued tasks rather than sleeping
+		while(atomic_load_explicit(&group->pending, memory_order_acquire) > 0
+				&& queue_pop(tp, &run, &arg, &other)) {
+			run_task(run, arg, other);
+		}
+		while(sem_wait(&group->done) && errno == EINTR);
+	}
+#endif
+	sem_destroy(&group->done);
+}
+
+void thread_pool_submit(task_group *group, task_function run, void *arg) {
+#ifdef PAILLIER_THREAD
+	thread_pool *tp = get_pool();
+
+	atomic_fetch_add_explicit(&group->pending, 1, memory_order_relaxed);
+	if(queue_push(tp, run, arg, group)) {
+		sem_post(&tp->work);
+	}
+	else {
+		//queue full, run the task in the calling thread
+		run_task(run, arg, group);
+	}
+#else
+	run(arg);
+#endif
+}
@@ -0,0 +1,89 @@
+/**
+ * @file thread_pool.h
+ *
+ * @date 		Created on: Oct 16, 2026
+ * @author 		Paillier-GMP contributors
+ * @copyright 	Paillier-GMP contributors, 2026
+ * @defgroup	ThreadPool Thread pool for Paillier-GMP
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#ifndef THREAD_POOL_H_
+#define THREAD_POOL_H_
+
+#include <stdatomic.h>
+#include <semaphore.h>
+
+/** Task group
+ *
+ * @ingroup ThreadPool
+ *
+ * Tasks are submitted to the pool as members of a group, and the submitter waits for the completion of the whole group.
+ */
+typedef struct {
+	atomic_int pending;	/**< number of tasks not completed yet, plus one until task_group_wait is called */
+	sem_t done;			/**< posted when the last task completes */
+} task_group;
+
+/** Task function
+ *
+ * @ingroup ThreadPool
+ */
+typedef void (*task_function)(void *arg);
+
+/** Initialize a task group
+ *
+ * @ingroup ThreadPool
+ * @param[out] group output task group
+ */
+void task_group_init(task_group *group);
+
+/** Wait for the completion of all tasks in a group and free the group
+ *
+ * @ingroup ThreadPool
+ * @param[in,out] group input task group
+ *
+ * While tasks are pending, the calling thread runs queued tasks itself instead of sleeping,
+ * so that waiting from inside a task cannot deadlock the pool.
+ */
+void task_group_wait(task_group *group);
+
+/** Submit a task to the thread pool
+ *
+ * @ingroup ThreadPool
+ * @param[in,out] group input task group of the task
+ * @param[in] run input task function
+ * @param[in] arg input argument of the task function, owned by the caller until the group completes
+ *
+ * The pool is started with the default number of threads if necessary.
+ * If the task queue is full, or if the library is compiled without PAILLIER_THREAD, the task is run by the calling thread.
+ */
+void thread_pool_submit(
+		task_group *group,
+		task_function run,
+		void *arg);
+
+/** Number of worker threads in the pool
+ *
+ * @ingroup ThreadPool
+ * @return number of worker threads, starting the pool if necessary
+ */
+unsigned int thread_pool_size(void);
+
+#endif /* THREAD_POOL_H_ */
@@ -25,101 +25,326 @@
 
 #include <stdlib.h>
 #include <stdio.h>
-#include <gmp.h>
+#include <string.h>
+#include <stdatomic.h>
 #include <pthread.h>
+#include <gmp.h>
 #include "tools.h"
+#include "thread_pool.h"
+#include "random.h"
 
 /**
- * Generate a random number using /dev/urandom.
- * Random number generation does not block.
+ * Generate a random number with the random source of the library, by default a buffered ChaCha20 generator per thread.
+ * The random bytes are written directly to the limbs of rnd: random number generation does not block,
+ * and in steady state it neither makes system calls nor allocates memory.
  */
 int gen_pseudorandom(mpz_t rnd, mp_bitcnt_t len) {
-	FILE *dev_urandom;
-	int byte_count, byte_read;
-	char * seed;
-
-	byte_count = BIT2BYTE(len);
+	mp_size_t limb_count;
+	mp_limb_t *limbs;
 
-	dev_urandom = fopen("/dev/urandom", "r");
-	if(dev_urandom == NULL) {
-		fprintf(stderr, "cannot open random number device!\n");
-		exit(1);
+	limb_count = (len + GMP_NUMB_BITS - 1)/GMP_NUMB_BITS;
+	if(limb_count == 0) {
+		mpz_set_ui(rnd, 0);
+		return 0;
 	}
 
-	seed = (char *)malloc(sizeof(char)*byte_count);
-
-	byte_read = 0;
-	//generate the bytes with /dev/urandom
-	while(byte_read < byte_count) {
-		byte_read += fread(seed, sizeof(char), byte_count, dev_urandom);
+	limbs = mpz_limbs_write(rnd, limb_count);
+	if(random_bytes(limbs, limb_count*sizeof(mp_limb_t))) {
+		mpz_limbs_finish(rnd, 0);
+		return -1;
 	}
-	fclose(dev_urandom);
 
-	mpz_import(rnd, byte_count, 1, sizeof(seed[0]), 0, 0, seed);
-	free(seed);
+	//clear the bits above len
+	if(len % GMP_NUMB_BITS) {
+		limbs[limb_count - 1] &= ((mp_limb_t)1 << (len % GMP_NUMB_BITS)) - 1;
+	}
+	mpz_limbs_finish(rnd, limb_count);
 	return 0;
 }
 
 /**
- * Generate a random number using /dev/random for the first 128 bits and then /dev/urandom.
- * This guarantees that there is enough entropy in the pool and that it is safe to use /dev/urandom.
- * Since /dev/random is used, if entropy is insufficient the program will block.
- * In that case, it is necessary to feed /dev/random with entropy, for example by moving the mouse.
+ * Generate a random number with the key generation generator of the library, seeded once with getrandom().
+ * Unlike the previous reads of /dev/random, this does not block on headless servers once the kernel entropy pool is initialized.
  */
 int gen_random(mpz_t rnd, mp_bitcnt_t len) {
-	FILE *dev_random, *dev_urandom;
-	int byte_count, byte_read;
-	char * seed;
+	mp_size_t limb_count;
+	mp_limb_t *limbs;
 
-	byte_count = BIT2BYTE(len);
+	limb_count = BIT2LIMB(len);
+	if(limb_count == 0) {
+		mpz_set_ui(rnd, 0);
+		return 0;
+	}
 
-	dev_random = fopen("/dev/random", "r");
-	if(dev_random == NULL) {
-		fprintf(stderr, "cannot open random number device!\n");
-		exit(1);
+	limbs = mpz_limbs_write(rnd, limb_count);
+	random_keygen_bytes(limbs, limb_count*sizeof(mp_limb_t));
+
+	//clear the bits above len
+	if(len % GMP_NUMB_BITS) {
+		limbs[limb_count - 1] &= ((mp_limb_t)1 << (len % GMP_NUMB_BITS)) - 1;
 	}
-	dev_urandom = fopen("/dev/urandom", "r");
-	if(dev_urandom == NULL) {
-		fprintf(stderr, "cannot open random number device!\n");
+	mpz_limbs_finish(rnd, limb_count);
+	return 0;
+}
+
+/** Bound of the small primes used for sieving prime candidates
+ *
+ * @ingroup Tools
+ */
+#define SIEVE_PRIME_LIMIT 65536
+
+/** Minimum bit length of sieved prime candidates, shorter primes are generated with mpz_nextprime
+ *
+ * @ingroup Tools
+ */
+#define SIEVE_MIN_BITS 64
+
+/** Number of Miller-Rabin rounds for prime candidates
+ *
+ * @ingroup Tools
+ */
+#define PRIME_REPS 25
+
+static unsigned int sieve_primes[6542];
+static unsigned int sieve_prime_count;
+static pthread_once_t sieve_once = PTHREAD_ONCE_INIT;
+
+/** Fill the table of odd primes below SIEVE_PRIME_LIMIT with the sieve of Eratosthenes
+ *
+ * @ingroup Tools
+ */
+static void sieve_init(void) {
+	unsigned char *composite;
+	unsigned int i, j;
+
+	composite = (unsigned char *)calloc(SIEVE_PRIME_LIMIT, sizeof(unsigned char));
+	if(composite == NULL) {
+		fputs("cannot allocate sieve!\n", stderr);
 		exit(1);
 	}
+	for(i = 3; i < SIEVE_PRIME_LIMIT; i += 2) {
+		if(composite[i]) continue;
+		sieve_primes[sieve_prime_count++] = i;
+		for(j = i*i; j < SIEVE_PRIME_LIMIT; j += 2*i) {
+			composite[j] = 1;
+		}
+	}
+	free(composite);
+}
 
-	seed = (char *)malloc(sizeof(char)*byte_count);
+/** Shared state of the probable-prime tests of a sieve window
+ *
+ * @ingroup Tools
+ */
+typedef struct {
+	mpz_srcptr base;		/**< first candidate of the window, odd */
+	unsigned int *offsets;	/**< candidates base+2*offset surviving the sieve, in increasing order */
+	size_t count;			/**< number of surviving candidates */
+	size_t stride;			/**< number of tasks, task i tests candidates i, i+stride, ... */
+	atomic_size_t found;	/**< smallest index of a prime found so far, count if none */
+} prime_search;
+
+/** Arguments of a probable-prime test task
+ *
+ * @ingroup Tools
+ */
+typedef struct {
+	prime_search *search;	/**< shared state */
+	size_t first;			/**< index of the first candidate tested by the task */
+} prime_task_args;
 
-	byte_read = 0;
-	//generate the first 16 bytes with /dev/random
-	while(byte_read  < 16 && byte_read < byte_count) {
-		byte_read += fread(seed, sizeof(char), byte_count, dev_random);
+/** Probable-prime tests of every stride-th surviving candidate
+ *
+ * @ingroup Tools
+ *
+ * The task stops as soon as a prime with a smaller index is known, so that the result is the first prime of the window
+ * regardless of the number of threads.
+ */
+static void do_prime_tests(void *args) {
+	prime_task_args *task = (prime_task_args *)args;
+	prime_search *search = task->search;
+	size_t i, found;
+	mpz_t candidate;
+
+	mpz_init2(candidate, mpz_sizeinbase(search->base, 2) + GMP_NUMB_BITS);
+	for(i = task->first; i < search->count; i += search->stride) {
+		found = atomic_load_explicit(&search->found, memory_order_relaxed);
+		if(found < i) break;
+		mpz_add_ui(candidate, search->base, 2*(unsigned long)search->offsets[i]);
+		if(mpz_probab_prime_p(candidate, PRIME_REPS)) {
+			while(i < found && !atomic_compare_exchange_weak(&search->found, &found, i));
+			break;
+		}
+	}
+	mpz_clear(candidate);
+}
+
+/** Search a random prime number
+ *
+ * @ingroup Tools
+ * @param[out] prime output prime number
+ * @param[in] len input bit length of the prime number
+ * @param[in] ntasks input number of tasks testing candidates in parallel
+ *
+ * The search scans windows of odd candidates starting from a random number with the most significant bit set.
+ * In each window, multiples of the odd primes below SIEVE_PRIME_LIMIT are crossed out using the residues of the first candidate,
+ * which are updated incrementally from one window to the next.
+ * The remaining candidates are tested with mpz_probab_prime_p by tasks of the thread pool, and the first probable prime of the window is returned.
+ * Randomness comes from the key generation generator.
+ * @see gen_random
+ */
+static int search_prime(mpz_t prime, mp_bitcnt_t len, size_t ntasks) {
+	prime_search search;
+	prime_task_args *tasks;
+	unsigned int *residues;
+	unsigned char *composite;
+	unsigned int i, p, k, window;
+	size_t j;
+	mpz_t base;
+#ifdef PAILLIER_THREAD
+	task_group group;
+#endif
+
+	mpz_init(base);
+	gen_random(base, len);
+
+	//set most significant bit to 1
+	mpz_setbit(base, len-1);
+
+	if(len < SIEVE_MIN_BITS) {
+		mpz_nextprime(prime, base);
+		mpz_clear(base);
+		return 0;
 	}
-	fclose(dev_random);
-	//generate the remaining bytes with /dev/urandom
-	while(byte_read < byte_count) {
-		byte_read += fread(seed, sizeof(char), byte_count, dev_urandom);
+
+	//start from an odd candidate
+	mpz_setbit(base, 0);
+	pthread_once(&sieve_once, sieve_init);
+
+	//window large enough to contain several primes: about len*ln(2)/2 odd candidates per prime
+	window = 8*len;
+	residues = (unsigned int *)malloc(sizeof(unsigned int)*sieve_prime_count);
+	composite = (unsigned char *)malloc(sizeof(unsigned char)*window);
+	search.offsets = (unsigned int *)malloc(sizeof(unsigned int)*window);
+	tasks = (prime_task_args *)malloc(sizeof(prime_task_args)*ntasks);
+	if(residues == NULL || composite == NULL || search.offsets == NULL || tasks == NULL) {
+		fputs("cannot allocate prime search!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < sieve_prime_count; i++) {
+		residues[i] = mpz_fdiv_ui(base, sieve_primes[i]);
+	}
+	search.base = base;
+
+	for(;;) {
+		DEBUG_MSG("sieving window of prime candidates\n");
+		memset(composite, 0, window);
+		for(i = 0; i < sieve_prime_count; i++) {
+			p = sieve_primes[i];
+			//base+2*k = 0 mod p for k = -residue/2 mod p, and 1/2 = (p+1)/2 mod p
+			k = (unsigned int)(((unsigned long)(p - residues[i])*((p + 1)/2)) % p);
+			for(; k < window; k += p) {
+				composite[k] = 1;
+			}
+			//residue of the first candidate of the next window
+			residues[i] = (unsigned int)((residues[i] + 2*(unsigned long)window) % p);
+		}
+		search.count = 0;
+		for(k = 0; k < window; k++) {
+			if(!composite[k]) search.offsets[search.count++] = k;
+		}
+
+		DEBUG_MSG("testing remaining candidates\n");
+		search.stride = ntasks < search.count ? ntasks : search.count;
+		atomic_init(&search.found, search.count);
+#ifdef PAILLIER_THREAD
+		task_group_init(&group);
+		for(j = 1; j < search.stride; j++) {
+			tasks[j].search = &search;
+			tasks[j].first = j;
+			thread_pool_submit(&group, do_prime_tests, (void *)&tasks[j]);
+		}
+		tasks[0].search = &search;
+		tasks[0].first = 0;
+		if(search.stride) do_prime_tests((void *)&tasks[0]);
+		task_group_wait(&group);
+#else
+		for(j = 0; j < search.stride; j++) {
+			tasks[j].search = &search;
+			tasks[j].first = j;
+			do_prime_tests((void *)&tasks[j]);
+		}
+#endif
+		j = atomic_load(&search.found);
+		if(j < search.count) {
+			mpz_add_ui(prime, base, 2*(unsigned long)search.offsets[j]);
+			break;
+		}
+		mpz_add_ui(base, base, 2*(unsigned long)window);
 	}
-	fclose(dev_urandom);
 
-	mpz_import(rnd, byte_count, 1, sizeof(seed[0]), 0, 0, seed);
-	free(seed);
+	free(residues);
+	free(composite);
+	free(search.offsets);
+	free(tasks);
+	mpz_clear(base);
 	return 0;
 }
 
 /**
- * Generate a random prime number using /dev/random and /dev/urandom as a source of randomness.
- * @see gen_random
+ * The probable-prime tests are spread over all threads of the pool.
  */
 int gen_prime(mpz_t prime, mp_bitcnt_t len) {
-	mpz_t rnd;
+	return search_prime(prime, len, thread_pool_size());
+}
 
-	mpz_init(rnd);
+/**
+ * All probable-prime tests run in the calling thread.
+ */
+int gen_prime_sequential(mpz_t prime, mp_bitcnt_t len) {
+	return search_prime(prime, len, 1);
+}
 
-	gen_random(rnd, len);
+/** Arguments of a prime generation task
+ *
+ * @ingroup Tools
+ */
+typedef struct {
+	mpz_ptr prime;		/**< generated prime */
+	mp_bitcnt_t len;	/**< bit length of the prime */
+} prime_args;
 
-	//set most significant bit to 1
-	mpz_setbit(rnd, len-1);
-	//look for next prime
-	mpz_nextprime(prime, rnd);
+/** Prime generation as a task of the thread pool
+ *
+ * @ingroup Tools
+ */
+static void do_gen_prime(void *args) {
+	prime_args *args_struct = (prime_args *)args;
+
+	gen_prime(args_struct->prime, args_struct->len);
+}
 
-	mpz_clear(rnd);
+/**
+ * The prime q is searched by a task of the thread pool while the calling thread searches p.
+ * Both searches spread their probable-prime tests over the pool.
+ */
+int gen_prime_pair(mpz_t p, mpz_t q, mp_bitcnt_t len) {
+	prime_args args_q;
+#ifdef PAILLIER_THREAD
+	task_group group;
+#endif
+
+	args_q.prime = q;
+	args_q.len = len;
+#ifdef PAILLIER_THREAD
+	task_group_init(&group);
+	thread_pool_submit(&group, do_gen_prime, (void *)&args_q);
+	gen_prime(p, len);
+	task_group_wait(&group);
+#else
+	gen_prime(p, len);
+	do_gen_prime((void *)&args_q);
+#endif
 	return 0;
 }
 
@@ -127,109 +352,203 @@ int gen_prime(mpz_t prime, mp_bitcnt_t len) {
  * @ingroup Tools
  *
  * This function reduces the input modulo the given modulus, and performs a modular exponentiation.
- * It is intended to be run in a pthread.
+ * It is intended to be run as a task of the thread pool.
  *
  * @param[in,out] args arguments for the exponentiation, a pointer to an exp_args, with
  * - exp_args::result storing the result of the exponentiation
  * - exp_args::basis storing the basis
  * - exp_args::exponent storing the exponent
  * - exp_args::modulus storing the modulus
+ * - exp_args::stat storing the statistics probe
  *
  */
-void *do_exponentiate(void *args) {
-	mpz_t basis_reduced;
+void do_exponentiate(void *args) {
 	exp_args * args_struct = (exp_args *)args;
+	STATS_START(start);
 
-	mpz_init(basis_reduced);
-	mpz_mod(basis_reduced, args_struct->basis, args_struct->modulus);
-	mpz_powm(args_struct->result, basis_reduced, args_struct->exponent, args_struct->modulus);
-
-	mpz_clear(basis_reduced);
-	pthread_exit(NULL);
+	mpz_mod(args_struct->result, args_struct->basis, args_struct->modulus);
+	mpz_powm(args_struct->result, args_struct->result, args_struct->exponent, args_struct->modulus);
+	STATS_STOP(args_struct->stat, start);
 }
 
-
 /**
- * The exponentiation is computed using Garner's method for the CRT:
- * - Exponentiation mod p: y_p = (x mod p)^{exp_p} mod p
- * - Exponentiation mod q: y_q = (x mod q)^{exp_q} mod q
- * - Recombination: y = y_p + p*(p^{-1} mod q)*(y_q-y_p) mod n
- * .
- * The exponentiations mod p and mod q run in their own thread.
+ * The exponentiation mod q is submitted to the thread pool while the calling thread computes the exponentiation mod p.
+ * The operands are shared with the worker thread, not copied.
  */
-int crt_exponentiation(mpz_t result, mpz_t base, mpz_t exp_p, mpz_t exp_q, mpz_t pinvq, mpz_t p, mpz_t q) {
-	mpz_t pq;
-	exp_args *args_p, *args_q;
-
+int dual_exponentiation(mpz_t result_p, mpz_t result_q, mpz_t base, mpz_t exp_p, mpz_t exp_q, mpz_t p, mpz_t q) {
+	exp_args args_p, args_q;
 #ifdef PAILLIER_THREAD
-	pthread_t thread1, thread2;
+	task_group group;
 #endif
 
-	mpz_init(pq);
-
 	//prepare arguments for exponentiation mod p
-	args_p = (exp_args *)malloc(sizeof(exp_args));
-
-	mpz_init(args_p->result);
-	mpz_init(args_p->basis);
-	mpz_init(args_p->exponent);
-	mpz_init(args_p->modulus);
-
-	mpz_set(args_p->basis, base);
-	mpz_set(args_p->exponent, exp_p);
-	mpz_set(args_p->modulus, p);
+	args_p.result = result_p;
+	args_p.basis = base;
+	args_p.exponent = exp_p;
+	args_p.modulus = p;
+	args_p.stat = PAILLIER_STAT_CRT_P;
 
 	//prepare arguments for exponentiation mod q
-	args_q = (exp_args *)malloc(sizeof(exp_args));
-
-	mpz_init(args_q->result);
-	mpz_init(args_q->basis);
-	mpz_init(args_q->exponent);
-	mpz_init(args_q->modulus);
-
-	mpz_set(args_q->basis, base);
-	mpz_set(args_q->exponent, exp_q);
-	mpz_set(args_q->modulus, q);
+	args_q.result = result_q;
+	args_q.basis = base;
+	args_q.exponent = exp_q;
+	args_q.modulus = q;
+	args_q.stat = PAILLIER_STAT_CRT_Q;
 
 #ifdef PAILLIER_THREAD
-	//compute exponentiation modulo p
-	pthread_create(&thread1, NULL, do_exponentiate, (void *)args_p);
+	task_group_init(&group);
 
-	//compute exponentiation modulo q
-	pthread_create(&thread2, NULL, do_exponentiate, (void *)args_q);
+	//compute exponentiation modulo q in the pool
+	thread_pool_submit(&group, do_exponentiate, (void *)&args_q);
 
-	pthread_join(thread1, NULL);
-	pthread_join(thread2, NULL);
+	//compute exponentiation modulo p
+	do_exponentiate((void *)&args_p);
 
+	task_group_wait(&group);
 #else
 	//compute exponentiation modulo p
-	mpz_mod(args_p->result, base, p);
-	mpz_powm(args_p->result, args_p->result, exp_p, p);
+	do_exponentiate((void *)&args_p);
 
 	//compute exponentiation modulo q
-	mpz_mod(args_q->result, base, q);
-	mpz_powm(args_q->result, args_q->result, exp_q, q);
+	do_exponentiate((void *)&args_q);
 #endif
 
+	return 0;
+}
+
+/**
+ * The exponentiation is computed using Garner's method for the CRT:
+ * - Exponentiation mod p: y_p = (x mod p)^{exp_p} mod p
+ * - Exponentiation mod q: y_q = (x mod q)^{exp_q} mod q
+ * - Recombination: y = y_p + p*(p^{-1} mod q)*(y_q-y_p) mod n
+ * .
+ * The exponentiations mod p and mod q run in their own thread.
+ * @see dual_exponentiation
+ */
+int crt_exponentiation(mpz_t result, mpz_t base, mpz_t exp_p, mpz_t exp_q, mpz_t pinvq, mpz_t p, mpz_t q) {
+	mpz_t pq, result_p, result_q;
+
+	mpz_init(pq);
+	mpz_init(result_p);
+	mpz_init(result_q);
+
+	dual_exponentiation(result_p, result_q, base, exp_p, exp_q, p, q);
+
 	//recombination
+	STATS_START(start);
 	mpz_mul(pq, p, q);
-	mpz_sub(result, args_q->result, args_p->result);
+	mpz_sub(result, result_q, result_p);
 	mpz_mul(result, result, p);
 	mpz_mul(result, result, pinvq);
-	mpz_add(result, result, args_p->result);
+	mpz_add(result, result, result_p);
 	mpz_mod(result, result, pq);
+	STATS_STOP(PAILLIER_STAT_RECOMBINE, start);
 
 	mpz_clear(pq);
-	mpz_clear(args_p->result);
-	mpz_clear(args_p->basis);
-	mpz_clear(args_p->exponent);
-	mpz_clear(args_p->modulus);
-	mpz_clear(args_q->result);
-	mpz_clear(args_q->basis);
-	mpz_clear(args_q->exponent);
-	mpz_clear(args_q->modulus);
-	free(args_p);
-	free(args_q);
+	mpz_clear(result_p);
+	mpz_clear(result_q);
 
 	return 0;
 }
+
+/**
+ * Newton iteration: each step doubles the number of correct low bits of the inverse, starting from 1 bit since m0 is odd.
+ */
+mp_limb_t mont_inverse(mp_limb_t m0) {
+	mp_limb_t inv = 1;
+	unsigned int bits;
+
+	for(bits = 1; bits < GMP_NUMB_BITS; bits *= 2) {
+		inv *= 2 - m0*inv;
+	}
+	return -inv;
+}
+
+/**
+ * Each reduction step adds q*m at limb i so that limb i becomes zero, and the carry out of the addition is stored in that limb.
+ * The carries are then added to the upper half at the end, and the result, less than 2m, is reduced with one subtraction.
+ */
+void mont_mul(mp_ptr r, mp_srcptr a, mp_srcptr b, mp_srcptr m, mp_size_t k, mp_limb_t minv, mp_ptr tp) {
+	mp_size_t i;
+	mp_limb_t cy;
+
+	if(a == b) {
+		mpn_sqr(tp, a, k);
+	}
+	else {
+		mpn_mul_n(tp, a, b, k);
+	}
+	for(i = 0; i < k; i++) {
+		tp[i] = mpn_addmul_1(tp + i, m, k, tp[i]*minv);
+	}
+	cy = mpn_add_n(r, tp + k, tp, k);
+	if(cy || mpn_cmp(r, m, k) >= 0) {
+		mpn_sub_n(r, r, m, k);
+	}
+}
+
+/**
+ * Same thresholds as the sliding windows of GMP, capped at MONT_WINDOW.
+ */
+unsigned int mont_window(mp_bitcnt_t bits) {
+	unsigned int width = 1;
+
+	if(bits > 7) width = 2;
+	if(bits > 25) width = 3;
+	if(bits > 81) width = 4;
+	if(bits > 241) width = 5;
+	return width < MONT_WINDOW ? width : MONT_WINDOW;
+}
+
+/**
+ * Left-to-right exponentiation with sliding windows of up to MONT_WINDOW bits.
+ * The scratch space holds the product of mont_mul, the table of odd powers b^{2j+1}*R mod m and the accumulator.
+ * The running time depends on the exponent, which must be public.
+ */
+void mont_powm(mp_ptr r, mp_srcptr b, mp_srcptr e, mp_size_t en, mp_srcptr m, mp_size_t k, mp_limb_t minv, mp_ptr tp) {
+	mp_limb_t *table = tp + 2*k;
+	mp_limb_t *acc = table + (1UL << (MONT_WINDOW - 1))*k;
+	mp_bitcnt_t bits, low;
+	long pos;
+	unsigned long digit, j;
+	unsigned int width;
+	int started = 0;
+
+	bits = mpn_sizeinbase(e, en, 2);
+	width = mont_window(bits);
+
+	//table[j] = b^{2j+1}*R mod m, using acc for b^2*R mod m
+	mpn_copyi(table, b, k);
+	if(width > 1) {
+		mont_mul(acc, table, table, m, k, minv, tp);
+		for(j = 1; j < (1UL << (width - 1)); j++) {
+			mont_mul(table + j*k, table + (j - 1)*k, acc, m, k, minv, tp);
+		}
+	}
+
+	pos = (long)bits - 1;
+	while(pos >= 0) {
+		if(!LIMB_BIT(e, pos)) {
+			mont_mul(acc, acc, acc, m, k, minv, tp);
+			pos--;
+			continue;
+		}
+		//longest window ending with a set bit
+		low = pos + 1 > width ? pos + 1 - width : 0;
+		while(!LIMB_BIT(e, low)) low++;
+		digit = 0;
+		for(j = pos + 1; j > low; j--) {
+			digit = (digit << 1) | LIMB_BIT(e, j - 1);
+			if(started) mont_mul(acc, acc, acc, m, k, minv, tp);
+		}
+		if(started) {
+			mont_mul(acc, acc, table + (digit >> 1)*k, m, k, minv, tp);
+		}
+		else {
+			mpn_copyi(acc, table + (digit >> 1)*k, k);
+			started = 1;
+		}
+		pos = (long)low - 1;
+	}
+	mpn_copyi(r, acc, k);
+}
@@ -28,7 +28,10 @@
 #define TOOLS_H_
 
 #include <stdio.h>
+#include <stdint.h>
+#include <time.h>
 #include <gmp.h>
+#include "../include/paillier.h"
 
 /** Convert bit length to byte length
  *
@@ -36,6 +39,12 @@
  */
 #define BIT2BYTE(a) (a+7)>>3
 
+/** Convert bit length to limb length
+ *
+ * @ingroup Tools
+ */
+#define BIT2LIMB(a) (((a) + GMP_NUMB_BITS - 1)/GMP_NUMB_BITS)
+
 #ifdef PAILLIER_DEBUG
 /** Print debug message
  *
@@ -46,30 +55,128 @@
 #define DEBUG_MSG(str)
 #endif
 
+#ifdef PAILLIER_STATS
+/** Read the time stamp counter, or the monotonic clock in nanoseconds on other architectures
+ *
+ * @ingroup Tools
+ */
+static inline uint64_t stats_ticks(void) {
+#if defined(__x86_64__) || defined(__i386__)
+	return __builtin_ia32_rdtsc();
+#else
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return (uint64_t)t.tv_sec*1000000000 + t.tv_nsec;
+#endif
+}
+
+/** Record the duration of an operation in the counters of the calling thread
+ *
+ * @ingroup Tools
+ * @param[in] probe input probe, less than PAILLIER_STAT_COUNT
+ * @param[in] ticks input duration
+ */
+void stats_record(unsigned int probe, uint64_t ticks);
+
+/** Start measuring an operation, declaring the variable holding the start time
+ *
+ * @ingroup Tools
+ */
+#define STATS_START(var) uint64_t var = stats_ticks()
+
+/** Stop measuring an operation and record its duration
+ *
+ * @ingroup Tools
+ */
+#define STATS_STOP(probe, var) stats_record(probe, stats_ticks() - (var))
+#else
+#define STATS_START(var)
+#define STATS_STOP(probe, var)
+#endif
+
 /** Structure for threaded exponentiation
  *
+ * The operands are not copied, they point to the variables of the caller.
  */
 typedef struct {
-	mpz_t result; /**< result of exponentiation */
-	mpz_t basis; /**< basis of exponentiation */
-	mpz_t exponent; /**< exponent of exponentiation */
-	mpz_t modulus; /**< modulus of exponentiation */
+	mpz_ptr result; /**< result of exponentiation */
+	mpz_srcptr basis; /**< basis of exponentiation */
+	mpz_srcptr exponent; /**< exponent of exponentiation */
+	mpz_srcptr modulus; /**< modulus of exponentiation */
+	unsigned int stat; /**< statistics probe of the exponentiation */
 } exp_args;
 
+/** Window size of fixed-base tables for Damgard-Jurik-Nielsen encryption
+ *
+ * @ingroup Tools
+ */
+#define DJN_WINDOW 4
+
+#if DJN_WINDOW < 1 || DJN_WINDOW >= GMP_NUMB_BITS
+#error "the window of fixed-base tables must be shorter than a limb"
+#endif
+
+/** Maximum window size of exponentiations in the Montgomery domain
+ *
+ * @ingroup Tools
+ */
+#define MONT_WINDOW 5
+
+/** Number of limbs of the scratch space of mont_powm
+ *
+ * @ingroup Tools
+ */
+#define MONT_POWM_SCRATCH(k) ((k)*((1UL << (MONT_WINDOW - 1)) + 3))
+
+/** Bit of a number stored in limbs
+ *
+ * @ingroup Tools
+ */
+#define LIMB_BIT(e, bit) (((e)[(bit)/GMP_NUMB_BITS] >> ((bit) % GMP_NUMB_BITS)) & 1)
+
 /** Generate a pseudo-random number
  *
  * @ingroup Tools
- * @param[out] rnd output random number, randomness coming from /dev/urandom
+ * @param[out] rnd output random number, randomness coming from the random source of the library
  * @param[in] len input bit length of the random number to generate
+ * @return 0 if no error, -1 if the random source failed
  */
 int gen_pseudorandom(
 		mpz_t rnd,
 		mp_bitcnt_t len);
 
+/** Generate the random factor of an encryption
+ *
+ * @ingroup Tools
+ * @param[out] rn output r^n mod n^2 for a random r, or h_s^alpha mod n^2 for a random alpha
+ * @param[in] ctx input public key context, only read
+ * @param[in,out] r input scratch variable
+ * @param[in,out] t input scratch variable
+ * @return 0 if no error, -1 if the random source failed
+ */
+int gen_noise(
+		mpz_t rn,
+		paillier_public_ctx *ctx,
+		mpz_t r,
+		mpz_t t);
+
+/** Compute the plaintext factor of an encryption
+ *
+ * @ingroup Tools
+ * @param[out] result output 1+(m mod n)*n, less than n^2
+ * @param[in] plaintext input plaintext m, reduced modulo n
+ * @param[in] ctx input public key context, only read
+ */
+void plaintext_factor(
+		mpz_t result,
+		mpz_t plaintext,
+		paillier_public_ctx *ctx);
+
 /** Generate a random number
  *
  * @ingroup Tools
- * @param[out] rnd output random number, randomness coming from /dev/random first and then /dev/urandom
+ * @param[out] rnd output random number, randomness coming from the key generation generator seeded with getrandom()
  * @param[in] len input bit length of the random number to generate
  */
 int gen_random(
@@ -79,13 +186,58 @@ int gen_random(
 /** Generate prime number
  *
  * @ingroup Tools
- * @param[out] prime output prime number, randomness coming from /dev/random
+ * @param[out] prime output prime number, randomness coming from the key generation generator
  * @param[in] len input bit length of prime number to generate
  */
 int gen_prime(
 		mpz_t prime,
 		mp_bitcnt_t len);
 
+/** Generate prime number in the calling thread
+ *
+ * @ingroup Tools
+ * @param[out] prime output prime number, randomness coming from the key generation generator
+ * @param[in] len input bit length of prime number to generate
+ *
+ * Unlike gen_prime, the probable-prime tests are not spread over the thread pool,
+ * which is preferable when many primes are generated in parallel.
+ */
+int gen_prime_sequential(
+		mpz_t prime,
+		mp_bitcnt_t len);
+
+/** Generate two prime numbers in parallel
+ *
+ * @ingroup Tools
+ * @param[out] p output first prime number
+ * @param[out] q output second prime number
+ * @param[in] len input bit length of the prime numbers to generate
+ */
+int gen_prime_pair(
+		mpz_t p,
+		mpz_t q,
+		mp_bitcnt_t len);
+
+/** Pair of independent exponentiations modulo p and modulo q
+ *
+ * @ingroup Tools
+ * @param[out] result_p output exponentiation result modulo p
+ * @param[out] result_q output exponentiation result modulo q
+ * @param[in] base input basis of the exponentiations
+ * @param[in] exp_p input exponent for modulo p exponentiation
+ * @param[in] exp_q input exponent for modulo q exponentiation
+ * @param[in] p input modulus p
+ * @param[in] q input modulus q
+ */
+int dual_exponentiation(
+		mpz_t result_p,
+		mpz_t result_q,
+		mpz_t base,
+		mpz_t exp_p,
+		mpz_t exp_q,
+		mpz_t p,
+		mpz_t q);
+
 /** Exponentiation with Chinese Remainder Theorem
  *
  * @ingroup Tools
@@ -106,5 +258,79 @@ int crt_exponentiation(
 		mpz_t p,
 		mpz_t q);
 
+/** Function L(u)=(u-1)/n
+ *
+ * @ingroup Tools
+ * @param[out] result output result (u-1)/n
+ * @param[in] input u
+ * @param[in] ninv input n^{-1} mod 2^len
+ * @param[in] len input bit length
+ * @return 0 if no error
+ */
+int paillier_ell(
+		mpz_t result,
+		mpz_t input,
+		mpz_t ninv,
+		mp_bitcnt_t len);
+
+/** Montgomery constant of a modulus
+ *
+ * @ingroup Tools
+ * @param[in] m0 input least significant limb of the modulus, must be odd
+ * @return -m0^{-1} mod 2^GMP_NUMB_BITS
+ */
+mp_limb_t mont_inverse(mp_limb_t m0);
+
+/** Montgomery multiplication
+ *
+ * @ingroup Tools
+ * @param[out] r output a*b*R^{-1} mod m with R=2^{k*GMP_NUMB_BITS}, k limbs, may overlap a or b
+ * @param[in] a input first operand, k limbs, less than m
+ * @param[in] b input second operand, k limbs, less than m
+ * @param[in] m input odd modulus, k limbs
+ * @param[in] k input number of limbs
+ * @param[in] minv input Montgomery constant of m
+ * @param[in,out] tp input scratch space of 2k limbs
+ *
+ * The product is computed with mpn_mul_n or mpn_sqr, and reduced with one mpn_addmul_1 per limb instead of a division.
+ */
+void mont_mul(
+		mp_ptr r,
+		mp_srcptr a,
+		mp_srcptr b,
+		mp_srcptr m,
+		mp_size_t k,
+		mp_limb_t minv,
+		mp_ptr tp);
+
+/** Window size of an exponentiation in the Montgomery domain
+ *
+ * @ingroup Tools
+ * @param[in] bits input bit length of the exponent
+ * @return window size, at most MONT_WINDOW
+ */
+unsigned int mont_window(mp_bitcnt_t bits);
+
+/** Exponentiation in the Montgomery domain
+ *
+ * @ingroup Tools
+ * @param[out] r output b^e*R mod m, k limbs, may overlap b
+ * @param[in] b input base b*R mod m, k limbs, less than m
+ * @param[in] e input public non-zero exponent, en limbs
+ * @param[in] en input number of limbs of the exponent
+ * @param[in] m input odd modulus, k limbs
+ * @param[in] k input number of limbs
+ * @param[in] minv input Montgomery constant of m
+ * @param[in,out] tp input scratch space of MONT_POWM_SCRATCH(k) limbs
+ */
+void mont_powm(
+		mp_ptr r,
+		mp_srcptr b,
+		mp_srcptr e,
+		mp_size_t en,
+		mp_srcptr m,
+		mp_size_t k,
+		mp_limb_t minv,
+		mp_ptr tp);
 
 #endif /* TOOLS_H_ */
@@ -0,0 +1,1399 @@
+/**
+ * @file api_test.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include "../include/paillier.h"
+
+/** Bit length of the keys of the tests
+ */
+#define TEST_BITS 1024
+
+/** Number of values of the batch tests
+ */
+#define TEST_BATCH 24
+
+/** Number of ciphertexts of the homomorphic sum test, enough for several chunks
+ */
+#define TEST_SUM 1000
+
+/** Number of pipelined requests of the server test, more than a connection may have in progress
+ */
+#define TEST_PIPELINE 100
+
+/** Number of failed checks
+ */
+static int failures = 0;
+
+/** Report the result of a check
+ */
+static void check(int ok, const char *name) {
+	printf("[%s] -> %s\n", ok ? "OK" : "NG", name);
+	if(!ok) failures++;
+}
+
+/** Allocate and initialize an array of integers
+ */
+static mpz_t *values_init(size_t count) {
+	mpz_t *values;
+	size_t i;
+
+	values = (mpz_t *)malloc(sizeof(mpz_t)*count);
+	if(values == NULL) {
+		fputs("cannot allocate test values!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < count; i++) {
+		mpz_init(values[i]);
+	}
+	return values;
+}
+
+/** Free an array of integers
+ */
+static void values_clear(mpz_t *values, size_t count) {
+	size_t i;
+
+	for(i = 0; i < count; i++) {
+		mpz_clear(values[i]);
+	}
+	free(values);
+}
+
+/** Compare the decryptions of ciphertexts with the expected plaintexts
+ */
+static int decrypts_to(mpz_t *ciphertexts, mpz_t *plaintexts, size_t count, paillier_private_key *priv) {
+	mpz_t m;
+	size_t i;
+	int ok = 1;
+
+	mpz_init(m);
+	for(i = 0; i < count && ok; i++) {
+		ok = paillier_decrypt(m, ciphertexts[i], priv) == 0 && mpz_cmp(m, plaintexts[i]) == 0;
+	}
+	mpz_clear(m);
+	return ok;
+}
+
+/** Copy a file, optionally flipping the bits of one byte and truncating the copy
+ *
+ * @param[in] src input file
+ * @param[in] offset input offset of the byte to flip, negative for none
+ * @param[in] size input size of the copy, negative for the whole file
+ * @return copy, positioned at its start
+ */
+static FILE *corrupt_copy(FILE *src, long offset, long size) {
+	FILE *dst = tmpfile();
+	long pos = 0;
+	int c;
+
+	if(dst == NULL) {
+		fputs("cannot create temporary file!\n", stderr);
+		exit(1);
+	}
+	rewind(src);
+	while((size < 0 || pos < size) && (c = getc(src)) != EOF) {
+		if(pos == offset) c ^= 0xff;
+		putc(c, dst);
+		pos++;
+	}
+	rewind(dst);
+	return dst;
+}
+
+/** Encryption and homomorphic operations with a public key context
+ */
+static void test_ctx(paillier_public_key *pub, paillier_private_key *priv) {
+	paillier_public_ctx ctx;
+	mpz_t m1, m2, c1, c2, c3, expected;
+	int ok;
+
+	mpz_init_set_ui(m1, 123456);
+	mpz_init(m2);
+	mpz_init(c1);
+	mpz_init(c2);
+	mpz_init(c3);
+	mpz_init(expected);
+	paillier_public_ctx_init(&ctx, pub);
+
+	check(paillier_encrypt_ctx(c1, m1, &ctx) == 0 && decrypts_to(&c1, &m1, 1, priv), "encryption with context");
+	paillier_encrypt_ctx(c2, m1, &ctx);
+	check(mpz_cmp(c1, c2) != 0 && decrypts_to(&c2, &m1, 1, priv), "randomized encryption with context");
+
+	//123456+(n-2) wraps around n
+	mpz_sub_ui(m2, pub->n, 2);
+	mpz_add(expected, m1, m2);
+	mpz_mod(expected, expected, pub->n);
+	ok = paillier_encrypt_ctx(c2, m2, &ctx) == 0 && paillier_homomorphic_add_ctx(c3, c1, c2, &ctx) == 0;
+	check(ok && decrypts_to(&c3, &expected, 1, priv), "homomorphic addition with context");
+
+	mpz_set_ui(m2, 1000);
+	mpz_mul(expected, m1, m2);
+	ok = paillier_homomorphic_multc_ctx(c3, c1, m2, &ctx) == 0;
+	check(ok && decrypts_to(&c3, &expected, 1, priv), "homomorphic multiplication with context");
+
+	//n, n+123456 and -1 are reduced modulo n, with and without context
+	mpz_set_ui(expected, 0);
+	ok = paillier_encrypt_ctx(c2, pub->n, &ctx) == 0 && decrypts_to(&c2, &expected, 1, priv);
+	ok = ok && paillier_encrypt(c2, pub->n, pub) == 0 && decrypts_to(&c2, &expected, 1, priv);
+	mpz_add(m2, pub->n, m1);
+	ok = ok && paillier_encrypt_ctx(c2, m2, &ctx) == 0 && decrypts_to(&c2, &m1, 1, priv);
+	mpz_set_si(m2, -1);
+	mpz_sub_ui(expected, pub->n, 1);
+	ok = ok && paillier_encrypt_ctx(c2, m2, &ctx) == 0 && decrypts_to(&c2, &expected, 1, priv);
+	check(ok, "plaintexts reduced modulo n");
+
+	paillier_public_ctx_clear(&ctx);
+	mpz_clear(m1);
+	mpz_clear(m2);
+	mpz_clear(c1);
+	mpz_clear(c2);
+	mpz_clear(c3);
+	mpz_clear(expected);
+}
+
+/** Decryption modulo p and q, compared with the exponentiation with lambda used without p and q
+ */
+static void test_crt_decrypt(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t m[4], c, d, p;
+	size_t i;
+	int ok = 1, ok_lambda = 1;
+
+	mpz_init(c);
+	mpz_init(d);
+	mpz_init(p);
+	mpz_init_set_ui(m[0], 0);
+	mpz_init_set_ui(m[1], 1);
+	mpz_init(m[2]);
+	mpz_sub_ui(m[2], pub->n, 1);
+	mpz_init_set_str(m[3], "123456789abcdef0123456789abcdef", 16);
+
+	for(i = 0; i < 4; i++) {
+		paillier_encrypt(c, m[i], pub);
+		ok = ok && paillier_decrypt(d, c, priv) == 0 && mpz_cmp(d, m[i]) == 0;
+		//p set to zero selects the exponentiation with lambda
+		mpz_swap(p, priv->p);
+		ok_lambda = ok_lambda && paillier_decrypt(d, c, priv) == 0 && mpz_cmp(d, m[i]) == 0;
+		mpz_swap(p, priv->p);
+	}
+	check(ok, "decryption modulo p and q of 0, 1, n-1 and a random value");
+	check(ok_lambda, "decryption with lambda without p and q");
+
+	mpz_set_ui(priv->hp, 0);
+	mpz_set_ui(priv->hq, 0);
+	mpz_set_ui(priv->pinvq, 0);
+	ok = paillier_private_crt_init(priv) == 0 && decrypts_to(&c, &m[3], 1, priv);
+	check(ok, "CRT parameters re-computed from p and q");
+
+	for(i = 0; i < 4; i++) {
+		mpz_clear(m[i]);
+	}
+	mpz_clear(c);
+	mpz_clear(d);
+	mpz_clear(p);
+}
+
+/** Batch encryption
+ */
+static void test_encrypt_batch(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH);
+	paillier_public_ctx ctx;
+	size_t i;
+	int ok;
+
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], 1000*i + 7);
+	}
+	mpz_sub_ui(m[TEST_BATCH - 1], pub->n, 1);
+
+	ok = paillier_encrypt_batch(c, m, TEST_BATCH, pub) == 0;
+	check(ok && decrypts_to(c, m, TEST_BATCH, priv), "batch encryption");
+
+	paillier_public_ctx_init(&ctx, pub);
+	ok = paillier_encrypt_batch_ctx(c, m, TEST_BATCH, &ctx) == 0;
+	check(ok && decrypts_to(c, m, TEST_BATCH, priv), "batch encryption with context");
+	paillier_public_ctx_clear(&ctx);
+
+	mpz_set(m[0], pub->n);
+	ok = paillier_encrypt_batch(c, m, TEST_BATCH, pub) == 0;
+	mpz_set_ui(m[0], 0);
+	check(ok && decrypts_to(c, m, TEST_BATCH, priv), "batch encryption of n reduced modulo n");
+
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+}
+
+/** Batch decryption
+ */
+static void test_decrypt_batch(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH), *d = values_init(TEST_BATCH);
+	mpz_t p;
+	size_t i;
+	int ok;
+
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], 7*i*i + 1);
+	}
+	mpz_sub_ui(m[0], pub->n, 1);
+	paillier_encrypt_batch(c, m, TEST_BATCH, pub);
+
+	ok = paillier_decrypt_batch(d, c, TEST_BATCH, priv) == 0;
+	for(i = 0; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], m[i]) == 0;
+	check(ok, "batch decryption");
+
+	for(i = 0; i < TEST_BATCH; i++) mpz_set(d[i], c[i]);
+	ok = paillier_decrypt_batch(d, d, TEST_BATCH, priv) == 0;
+	for(i = 0; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], m[i]) == 0;
+	check(ok, "in-place batch decryption");
+
+	//0, n^2 and p^2 cannot be decrypted, the other ciphertexts still are
+	mpz_set_ui(c[0], 0);
+	mpz_mul(c[1], pub->n, pub->n);
+	mpz_set(c[2], priv->p2);
+	ok = paillier_decrypt_batch(d, c, TEST_BATCH, priv) == -1;
+	for(i = 3; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], m[i]) == 0;
+	check(ok, "batch decryption of invalid ciphertexts rejected");
+	mpz_init(p);
+	mpz_swap(p, priv->p);
+	check(paillier_decrypt_batch(d, c + 2, 1, priv) == -1, "batch decryption of p^2 rejected without p and q");
+	mpz_swap(p, priv->p);
+	mpz_clear(p);
+
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+	values_clear(d, TEST_BATCH);
+}
+
+/** Deterministic random source, a 64-bit xorshift generator
+ */
+static int test_random(void *state, void *buffer, size_t len) {
+	uint64_t *x = (uint64_t *)state;
+	unsigned char *out = (unsigned char *)buffer;
+	size_t i;
+
+	for(i = 0; i < len; i++) {
+		*x ^= *x << 13;
+		*x ^= *x >> 7;
+		*x ^= *x << 17;
+		out[i] = (unsigned char)*x;
+	}
+	return 0;
+}
+
+/** Random source that always fails
+ */
+static int test_random_failing(void *state, void *buffer, size_t len) {
+	return -1;
+}
+
+/** Replacement of the random source
+ */
+static void test_random_source(paillier_public_key *pub, paillier_private_key *priv) {
+	paillier_public_ctx ctx;
+	uint64_t state;
+	mpz_t m, c1, c2;
+	int ok;
+
+	mpz_init_set_ui(m, 42);
+	mpz_init(c1);
+	mpz_init(c2);
+	paillier_public_ctx_init(&ctx, pub);
+
+	//the same state gives the same random numbers
+	state = 1;
+	paillier_set_random_source(test_random, &state);
+	ok = paillier_encrypt_ctx(c1, m, &ctx) == 0;
+	state = 1;
+	ok = ok && paillier_encrypt_ctx(c2, m, &ctx) == 0;
+	paillier_set_random_source(NULL, NULL);
+	check(ok && mpz_cmp(c1, c2) == 0 && decrypts_to(&c1, &m, 1, priv), "replaced random source");
+
+	ok = paillier_encrypt_ctx(c2, m, &ctx) == 0;
+	check(ok && mpz_cmp(c1, c2) != 0 && decrypts_to(&c2, &m, 1, priv), "default random source restored");
+
+	paillier_set_random_source(test_random_failing, NULL);
+	ok = paillier_encrypt_ctx(c1, m, &ctx) == -1 && paillier_encrypt(c1, m, pub) == -1;
+	paillier_set_random_source(NULL, NULL);
+	check(ok, "failure of the random source propagated");
+
+	paillier_public_ctx_clear(&ctx);
+	mpz_clear(m);
+	mpz_clear(c1);
+	mpz_clear(c2);
+}
+
+/** Randomness pools, with and without background threads
+ */
+static void test_pool(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH);
+	mpz_t *d = values_init(TEST_BATCH);
+	paillier_public_key other;
+	paillier_rand_pool *pool, *pool2;
+	paillier_rand_pool_counters counters;
+	FILE *fp;
+	size_t i;
+	int ok;
+
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], i*i + 3);
+	}
+
+	ok = paillier_rand_pool_init(&pool, pub, TEST_BATCH/2, 0) == 0;
+	check(ok && paillier_rand_pool_fill(pool, TEST_BATCH) == TEST_BATCH/2, "pool filled up to its capacity");
+
+	for(i = 0; i < TEST_BATCH && ok; i++) {
+		ok = paillier_encrypt_pool(c[i], m[i], pool) == 0;
+	}
+	paillier_rand_pool_stats(pool, &counters);
+	check(ok && decrypts_to(c, m, TEST_BATCH, priv), "pool encryption");
+	check(counters.hits == TEST_BATCH/2 && counters.misses == TEST_BATCH - TEST_BATCH/2 && counters.level == 0,
+			"pool hits and misses");
+
+	paillier_rand_pool_fill(pool, TEST_BATCH/4);
+	ok = paillier_rerandomize_pool(d[0], c[0], pool) == 0 && mpz_cmp(d[0], c[0]) != 0;
+	check(ok && decrypts_to(d, m, 1, priv), "pool re-randomization");
+
+	ok = paillier_rerandomize_pool_batch(d, c, TEST_BATCH, pool) == 0;
+	for(i = 0; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], c[i]) != 0;
+	paillier_rand_pool_stats(pool, &counters);
+	check(ok && decrypts_to(d, m, TEST_BATCH, priv), "pool batch re-randomization");
+	check(counters.hits + counters.misses == 2*TEST_BATCH + 1 && counters.level == 0, "pool batch counters");
+	paillier_rand_pool_clear(pool);
+
+	ok = paillier_rand_pool_init(&pool, pub, 4, 1) == 0;
+	for(i = 0; i < TEST_BATCH && ok; i++) {
+		ok = paillier_encrypt_pool(c[i], m[i], pool) == 0;
+	}
+	check(ok && decrypts_to(c, m, TEST_BATCH, priv), "pool encryption with a background thread");
+	paillier_rand_pool_clear(pool);
+
+	//values spilled by one pool and loaded by another one
+	fp = tmpfile();
+	ok = paillier_rand_pool_init(&pool, pub, 4, 0) == 0 && paillier_rand_pool_init(&pool2, pub, 4, 0) == 0;
+	ok = ok && paillier_rand_pool_fill(pool, 4) == 4 && paillier_rand_pool_save(fp, pool) > 0;
+	rewind(fp);
+	ok = ok && paillier_rand_pool_load(pool2, fp) == 4;
+	for(i = 0; i < 4 && ok; i++) {
+		ok = paillier_encrypt_pool(c[i], m[i], pool2) == 0;
+	}
+	paillier_rand_pool_stats(pool2, &counters);
+	check(ok && counters.hits == 4 && decrypts_to(c, m, 4, priv), "pool spilled and loaded");
+	paillier_rand_pool_clear(pool2);
+	fclose(fp);
+
+	//values spilled for another key are not loaded
+	paillier_public_init(&other);
+	mpz_add_ui(other.n, pub->n, 2);
+	other.len = pub->len;
+	fp = tmpfile();
+	ok = paillier_rand_pool_init(&pool2, &other, 4, 0) == 0 && paillier_rand_pool_fill(pool2, 2) == 2;
+	ok = ok && paillier_rand_pool_save(fp, pool2) > 0;
+	paillier_rand_pool_clear(pool2);
+	rewind(fp);
+	check(ok && paillier_rand_pool_load(pool, fp) == 0, "pool spilled for another key not loaded");
+	fclose(fp);
+	paillier_public_clear(&other);
+
+	//loading stops at a value out of range
+	fp = tmpfile();
+	fprintf(fp, "key %016llx\n1234\n0\n5678\n", (unsigned long long)paillier_public_fingerprint(pub));
+	rewind(fp);
+	check(paillier_rand_pool_load(pool, fp) == 1, "pool loading stopped at zero");
+	fclose(fp);
+	paillier_rand_pool_clear(pool);
+
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+	values_clear(d, TEST_BATCH);
+}
+
+/** Damgard-Jurik-Nielsen encryption with h_s, with and without fixed-base table
+ */
+static void test_djn(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH);
+	paillier_public_key djn;
+	paillier_public_ctx ctx;
+	size_t i;
+	int ok;
+
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], 99*i + 2);
+	}
+	paillier_public_init(&djn);
+	mpz_set(djn.n, pub->n);
+	djn.len = pub->len;
+	check(paillier_djn_setup(&djn) == 0 && mpz_sgn(djn.hs) != 0, "Damgard-Jurik-Nielsen setup");
+
+	ok = paillier_encrypt(c[0], m[0], &djn) == 0;
+	check(ok && decrypts_to(c, m, 1, priv), "Damgard-Jurik-Nielsen encryption");
+
+	paillier_public_ctx_init(&ctx, &djn);
+	ok = ctx.table != NULL && paillier_encrypt_ctx(c[1], m[1], &ctx) == 0;
+	check(ok && decrypts_to(c + 1, m + 1, 1, priv), "Damgard-Jurik-Nielsen encryption with fixed-base table");
+	ok = paillier_rerandomize(c[2], c[1], &ctx) == 0 && mpz_cmp(c[2], c[1]) != 0;
+	check(ok && decrypts_to(c + 2, m + 1, 1, priv), "re-randomization with fixed-base table");
+	paillier_public_ctx_clear(&ctx);
+
+	ok = paillier_encrypt_batch(c, m, TEST_BATCH, &djn) == 0;
+	check(ok && decrypts_to(c, m, TEST_BATCH, priv), "Damgard-Jurik-Nielsen batch encryption");
+
+	paillier_public_clear(&djn);
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+}
+
+/** Homomorphic weighted sums
+ */
+static void test_dot(paillier_public_key *pub, paillier_private_key *priv) {
+	size_t count = 4*TEST_BATCH, i;
+	mpz_t *m = values_init(count), *c = values_init(count), *w = values_init(count), result, expected;
+	int ok;
+
+	mpz_init(result);
+	mpz_init(expected);
+	for(i = 0; i < count; i++) {
+		mpz_set_ui(m[i], 3*i + 1);
+		//zero weights, small weights and weights as long as n
+		if(i % 5 == 0) mpz_set_ui(w[i], 0);
+		else if(i % 5 == 1) mpz_sub_ui(w[i], pub->n, i);
+		else mpz_set_ui(w[i], 1000*i + 17);
+		mpz_addmul(expected, m[i], w[i]);
+	}
+	mpz_mod(expected, expected, pub->n);
+	paillier_encrypt_batch(c, m, count, pub);
+
+	ok = paillier_homomorphic_dot(result, c, w, count, pub) == 0;
+	check(ok && decrypts_to(&result, &expected, 1, priv), "homomorphic weighted sum");
+
+	mpz_set_ui(expected, 0);
+	ok = paillier_homomorphic_dot(result, c, w, 1, pub) == 0;
+	check(ok && decrypts_to(&result, &expected, 1, priv), "homomorphic weighted sum with a zero weight");
+
+	mpz_set_si(w[0], -1);
+	check(paillier_homomorphic_dot(result, c, w, count, pub) == -1, "negative weight rejected");
+	mpz_set(w[0], pub->n);
+	check(paillier_homomorphic_dot(result, c, w, count, pub) == -1, "weight n rejected");
+	mpz_set_ui(w[0], 1);
+	mpz_set_ui(c[0], 0);
+	check(paillier_homomorphic_dot(result, c, w, count, pub) == -1, "zero ciphertext rejected");
+
+	mpz_clear(result);
+	mpz_clear(expected);
+	values_clear(m, count);
+	values_clear(c, count);
+	values_clear(w, count);
+}
+
+/** Homomorphic sums of many ciphertexts
+ */
+static void test_sum(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t *m = values_init(TEST_SUM), *c = values_init(TEST_SUM), result, expected;
+	size_t i;
+	int ok;
+
+	mpz_init(result);
+	mpz_init(expected);
+	for(i = 0; i < TEST_SUM; i++) {
+		mpz_set_ui(m[i], i);
+		mpz_add_ui(expected, expected, i);
+	}
+	paillier_encrypt_batch(c, m, TEST_SUM, pub);
+
+	ok = paillier_homomorphic_sum(result, c, TEST_SUM, pub) == 0;
+	check(ok && decrypts_to(&result, &expected, 1, priv), "homomorphic sum");
+	ok = paillier_homomorphic_sum(result, c, 0, pub) == 0;
+	check(ok && mpz_cmp_ui(result, 1) == 0, "homomorphic sum of no ciphertext");
+
+	mpz_set_ui(c[7], 0);
+	check(paillier_homomorphic_sum(result, c, TEST_SUM, pub) == -1, "homomorphic sum of a zero ciphertext rejected");
+	mpz_mul(c[7], pub->n, pub->n);
+	check(paillier_homomorphic_sum(result, c, TEST_SUM, pub) == -1, "homomorphic sum of a ciphertext n^2 rejected");
+
+	mpz_clear(result);
+	mpz_clear(expected);
+	values_clear(m, TEST_SUM);
+	values_clear(c, TEST_SUM);
+}
+
+/** Chains of homomorphic operations in the Montgomery domain
+ */
+static void test_mont(paillier_public_key *pub, paillier_private_key *priv) {
+	paillier_public_ctx ctx;
+	paillier_mont_ciphertext a, b;
+	mpz_t m1, m2, c, k, expected;
+	int ok;
+
+	mpz_init_set_ui(m1, 1234);
+	mpz_init_set_ui(m2, 56789);
+	mpz_init(c);
+	mpz_init(k);
+	mpz_init(expected);
+	paillier_public_ctx_init(&ctx, pub);
+	paillier_mont_init(&a, &ctx);
+	paillier_mont_init(&b, &ctx);
+
+	//((m1+m2)*3+m2)*1000
+	paillier_encrypt_ctx(c, m1, &ctx);
+	ok = paillier_mont_import(&a, c, &ctx) == 0;
+	paillier_encrypt_ctx(c, m2, &ctx);
+	ok = ok && paillier_mont_import(&b, c, &ctx) == 0;
+	ok = ok && paillier_mont_add(&a, &a, &b, &ctx) == 0;
+	mpz_set_ui(k, 3);
+	ok = ok && paillier_mont_multc(&a, &a, k, &ctx) == 0;
+	ok = ok && paillier_mont_add(&a, &a, &b, &ctx) == 0;
+	mpz_set_ui(k, 1000);
+	ok = ok && paillier_mont_multc(&a, &a, k, &ctx) == 0;
+	ok = ok && paillier_mont_export(c, &a, &ctx) == 0;
+	mpz_add(expected, m1, m2);
+	mpz_mul_ui(expected, expected, 3);
+	mpz_add(expected, expected, m2);
+	mpz_mul_ui(expected, expected, 1000);
+	check(ok && decrypts_to(&c, &expected, 1, priv), "chain of additions and multiplications in the Montgomery domain");
+
+	//multiplying by 0 gives an encryption of 0, which leaves a sum unchanged
+	mpz_set_ui(k, 0);
+	ok = paillier_mont_multc(&b, &b, k, &ctx) == 0 && paillier_mont_export(c, &b, &ctx) == 0;
+	mpz_set_ui(m1, 0);
+	check(ok && decrypts_to(&c, &m1, 1, priv), "multiplication by 0 in the Montgomery domain");
+	ok = paillier_mont_add(&a, &a, &b, &ctx) == 0 && paillier_mont_export(c, &a, &ctx) == 0;
+	check(ok && decrypts_to(&c, &expected, 1, priv), "addition of an encryption of 0 in the Montgomery domain");
+
+	mpz_set_si(k, -1);
+	check(paillier_mont_multc(&a, &a, k, &ctx) == -1, "negative constant rejected in the Montgomery domain");
+
+	paillier_mont_clear(&a);
+	paillier_mont_clear(&b);
+	paillier_public_ctx_clear(&ctx);
+	mpz_clear(m1);
+	mpz_clear(m2);
+	mpz_clear(c);
+	mpz_clear(k);
+	mpz_clear(expected);
+}
+
+/** Copy an integer to a fixed-width array of limbs
+ */
+static void to_limbs(mp_limb_t *limbs, mpz_t value, mp_size_t size) {
+	mp_size_t i;
+
+	for(i = 0; i < size; i++) {
+		limbs[i] = mpz_getlimbn(value, i);
+	}
+}
+
+/** Fixed-width core API, compared with the mpz functions
+ */
+static void test_core(paillier_public_key *pub, paillier_private_key *priv) {
+	mp_size_t k = paillier_core_limbs(pub), kn = mpz_size(pub->n), scratch_size;
+	mp_limb_t *limbs, *m1, *m2, *c1, *c2, *c3, *d, *scratch;
+	mpz_t a, b, c, expected;
+	int ok;
+
+	scratch_size = paillier_core_scratch_limbs(pub);
+	if(paillier_core_decrypt_scratch_limbs(priv) > scratch_size) scratch_size = paillier_core_decrypt_scratch_limbs(priv);
+	limbs = (mp_limb_t *)calloc(3*kn + 3*k + scratch_size, sizeof(mp_limb_t));
+	if(limbs == NULL) {
+		fputs("cannot allocate test limbs!\n", stderr);
+		exit(1);
+	}
+	m1 = limbs;
+	m2 = m1 + kn;
+	d = m2 + kn;
+	c1 = d + kn;
+	c2 = c1 + k;
+	c3 = c2 + k;
+	scratch = c3 + k;
+	mpz_init_set_str(a, "fedcba9876543210fedcba9876543210", 16);
+	mpz_init_set_ui(b, 77);
+	mpz_init(c);
+	mpz_init(expected);
+	to_limbs(m1, a, kn);
+	to_limbs(m2, b, kn);
+
+	ok = paillier_core_encrypt(c1, m1, pub, scratch) == 0 && paillier_core_decrypt(d, c1, priv, scratch) == 0;
+	check(ok && mpn_cmp(d, m1, kn) == 0, "core encryption and decryption");
+	mpz_import(c, k, -1, sizeof(mp_limb_t), 0, 0, c1);
+	check(decrypts_to(&c, &a, 1, priv), "core ciphertext decrypted by paillier_decrypt");
+
+	mpz_add(expected, a, b);
+	ok = paillier_core_encrypt(c2, m2, pub, scratch) == 0 && paillier_core_homomorphic_add(c3, c1, c2, pub, scratch) == 0;
+	mpz_import(c, k, -1, sizeof(mp_limb_t), 0, 0, c3);
+	check(ok && decrypts_to(&c, &expected, 1, priv), "core homomorphic addition");
+
+	mpz_mul(expected, a, b);
+	ok = paillier_core_homomorphic_multc(c3, c1, m2, pub, scratch) == 0;
+	mpz_import(c, k, -1, sizeof(mp_limb_t), 0, 0, c3);
+	check(ok && decrypts_to(&c, &expected, 1, priv), "core homomorphic multiplication");
+
+	free(limbs);
+	mpz_clear(a);
+	mpz_clear(b);
+	mpz_clear(c);
+	mpz_clear(expected);
+}
+
+/** Packing of small integers in the slots of a plaintext
+ */
+static void test_packing(paillier_public_key *pub, paillier_private_key *priv) {
+	paillier_packing packing;
+	uint64_t *values, *sums, *out;
+	mpz_t plaintext, c, sum;
+	size_t i, j;
+	int ok;
+
+	//16-bit values with 4 bits of headroom, for sums of up to 16 values per slot
+	check(paillier_packing_init(&packing, pub, 60, 5) == -1, "slots longer than 64 bits rejected");
+	if(paillier_packing_init(&packing, pub, 16, 4) != 0 || packing.slots < 2) {
+		check(0, "packing parameters");
+		return;
+	}
+	values = (uint64_t *)malloc(3*packing.slots*sizeof(uint64_t));
+	if(values == NULL) {
+		fputs("cannot allocate test values!\n", stderr);
+		exit(1);
+	}
+	sums = values + packing.slots;
+	out = sums + packing.slots;
+	mpz_init(plaintext);
+	mpz_init(c);
+	mpz_init(sum);
+
+	for(i = 0; i < packing.slots; i++) {
+		values[i] = i % 3 == 0 ? 0xffff : 17*i;
+	}
+	ok = paillier_pack(plaintext, values, packing.slots, &packing) == 0 && mpz_cmp(plaintext, pub->n) < 0
+			&& paillier_unpack(out, packing.slots, plaintext, &packing) == 0;
+	for(i = 0; i < packing.slots && ok; i++) ok = out[i] == values[i];
+	check(ok, "packing round trip");
+
+	values[1] = 0x10000;
+	check(paillier_pack(plaintext, values, packing.slots, &packing) == -1, "value longer than a slot rejected");
+	values[1] = 17;
+	check(paillier_pack(plaintext, values, packing.slots + 1, &packing) == -1, "more values than slots rejected");
+
+	//2^headroom additions of the largest values fill the slots without carry
+	ok = paillier_encrypt_packed(sum, values, packing.slots, &packing, pub) == 0;
+	for(i = 0; i < packing.slots; i++) {
+		sums[i] = values[i];
+		values[i] = 0xffff - i;
+	}
+	for(j = 1; j < (1u << packing.headroom) && ok; j++) {
+		ok = paillier_encrypt_packed(c, values, packing.slots, &packing, pub) == 0
+				&& paillier_homomorphic_add(sum, sum, c, pub) == 0;
+		for(i = 0; i < packing.slots; i++) sums[i] += values[i];
+	}
+	ok = ok && paillier_decrypt_packed(out, packing.slots, sum, &packing, priv) == 0;
+	for(i = 0; i < packing.slots && ok; i++) ok = out[i] == sums[i];
+	check(ok, "packed homomorphic additions within the headroom");
+
+	free(values);
+	mpz_clear(plaintext);
+	mpz_clear(c);
+	mpz_clear(sum);
+}
+
+/** Damgard-Jurik encryption and decryption, with plaintexts longer than n
+ */
+static void test_dj(paillier_public_key *pub, paillier_private_key *priv) {
+	paillier_dj_public_ctx pctx;
+	paillier_dj_private_ctx sctx;
+	mpz_t m1, m2, c1, c2, d, expected;
+	unsigned int s;
+	int ok;
+	char name[64];
+
+	check(paillier_dj_public_ctx_init(&pctx, pub, 0) == -1, "Damgard-Jurik exponent 0 rejected");
+	mpz_init(m1);
+	mpz_init(m2);
+	mpz_init(c1);
+	mpz_init(c2);
+	mpz_init(d);
+	mpz_init(expected);
+	for(s = 1; s <= 3; s++) {
+		ok = paillier_dj_public_ctx_init(&pctx, pub, s) == 0 && paillier_dj_private_ctx_init(&sctx, priv, s) == 0;
+		if(!ok) {
+			check(0, "Damgard-Jurik contexts");
+			continue;
+		}
+
+		//m1 = n^s-1 is the largest plaintext
+		mpz_pow_ui(m1, pub->n, s);
+		mpz_sub_ui(m1, m1, 1);
+		mpz_set_ui(m2, 123456789);
+		ok = paillier_dj_encrypt(c1, m1, &pctx) == 0 && paillier_dj_decrypt(d, c1, &sctx) == 0 && mpz_cmp(d, m1) == 0;
+		snprintf(name, sizeof(name), "Damgard-Jurik round trip with s=%u", s);
+		check(ok, name);
+
+		//(n^s-1)+123456789 = 123456788 mod n^s
+		paillier_dj_encrypt(c2, m2, &pctx);
+		ok = paillier_dj_homomorphic_add(c2, c1, c2, &pctx) == 0 && paillier_dj_decrypt(d, c2, &sctx) == 0
+				&& mpz_cmp_ui(d, 123456788) == 0;
+		snprintf(name, sizeof(name), "Damgard-Jurik homomorphic addition with s=%u", s);
+		check(ok, name);
+
+		paillier_dj_encrypt(c1, m2, &pctx);
+		mpz_set_ui(m1, 1000);
+		mpz_mul(expected, m1, m2);
+		ok = paillier_dj_homomorphic_multc(c1, c1, m1, &pctx) == 0 && paillier_dj_decrypt(d, c1, &sctx) == 0
+				&& mpz_cmp(d, expected) == 0;
+		snprintf(name, sizeof(name), "Damgard-Jurik homomorphic multiplication with s=%u", s);
+		check(ok, name);
+
+		paillier_dj_public_ctx_clear(&pctx);
+		paillier_dj_private_ctx_clear(&sctx);
+	}
+	mpz_clear(m1);
+	mpz_clear(m2);
+	mpz_clear(c1);
+	mpz_clear(c2);
+	mpz_clear(d);
+	mpz_clear(expected);
+}
+
+/** Batch key generation
+ */
+static void test_keygen_batch(void) {
+	paillier_public_key pub[2];
+	paillier_private_key priv[2];
+	double seconds[2];
+	mpz_t m, c;
+	size_t i;
+	int ok;
+
+	mpz_init_set_ui(m, 31337);
+	mpz_init(c);
+	for(i = 0; i < 2; i++) {
+		paillier_public_init(&pub[i]);
+		paillier_private_init(&priv[i]);
+	}
+	ok = paillier_keygen_batch(pub, priv, 2, TEST_BITS/2, seconds) == 0 && mpz_cmp(pub[0].n, pub[1].n) != 0;
+	//only the top bits of p and q are set, so that n may be one bit shorter
+	for(i = 0; i < 2 && ok; i++) {
+		ok = mpz_sizeinbase(pub[i].n, 2) >= TEST_BITS/2 - 1 && seconds[i] >= 0 && paillier_encrypt(c, m, &pub[i]) == 0
+				&& decrypts_to(&c, &m, 1, &priv[i]);
+	}
+	check(ok, "batch key generation");
+
+	for(i = 0; i < 2; i++) {
+		paillier_public_clear(&pub[i]);
+		paillier_private_clear(&priv[i]);
+	}
+	mpz_clear(m);
+	mpz_clear(c);
+}
+
+/** Binary keys, and rejection of corrupted files
+ */
+static void test_bin_keys(paillier_public_key *pub, paillier_private_key *priv) {
+	paillier_public_key pub2;
+	paillier_private_key priv2;
+	FILE *fp, *bad;
+	mpz_t m, c;
+	long size;
+
+	paillier_public_init(&pub2);
+	paillier_private_init(&priv2);
+	mpz_init_set_ui(m, 12345);
+	mpz_init(c);
+
+	fp = tmpfile();
+	paillier_public_out_bin(fp, pub);
+	fflush(fp);
+	size = ftell(fp);
+	rewind(fp);
+	check(paillier_public_import_bin(&pub2, fp) == 0 && mpz_cmp(pub2.n, pub->n) == 0, "binary public key round trip");
+	rewind(fp);
+	check(paillier_public_load(&pub2, fp) == 0 && mpz_cmp(pub2.n, pub->n) == 0, "binary public key detected by load");
+
+	bad = corrupt_copy(fp, size - 1, -1);
+	check(paillier_public_import_bin(&pub2, bad) == -1, "corrupted binary public key rejected");
+	fclose(bad);
+	bad = corrupt_copy(fp, -1, size - 8);
+	check(paillier_public_import_bin(&pub2, bad) == -1, "truncated binary public key rejected");
+	fclose(bad);
+	bad = corrupt_copy(fp, 0, -1);
+	check(paillier_public_import_bin(&pub2, bad) == -1, "binary public key with a wrong magic number rejected");
+	fclose(bad);
+	fclose(fp);
+
+	fp = tmpfile();
+	paillier_private_out_bin(fp, priv);
+	fflush(fp);
+	size = ftell(fp);
+	rewind(fp);
+	check(paillier_private_import_bin(&priv2, fp) == 0 && mpz_cmp(priv2.lambda, priv->lambda) == 0
+			&& mpz_cmp(priv2.hq, priv->hq) == 0, "binary private key round trip");
+	paillier_encrypt(c, m, pub);
+	check(decrypts_to(&c, &m, 1, &priv2), "decryption with a binary private key");
+	check(paillier_public_import_bin(&pub2, fp) == -1, "binary private key rejected as public key");
+
+	bad = corrupt_copy(fp, PAILLIER_BIN_HEADER_SIZE + 3, -1);
+	check(paillier_private_import_bin(&priv2, bad) == -1, "corrupted binary private key rejected");
+	fclose(bad);
+	bad = corrupt_copy(fp, -1, size - 1);
+	check(paillier_private_import_bin(&priv2, bad) == -1, "truncated binary private key rejected");
+	fclose(bad);
+	fclose(fp);
+
+	fp = tmpfile();
+	paillier_private_out_str(fp, priv);
+	fflush(fp);
+	rewind(fp);
+	check(paillier_private_load(&priv2, fp) == 0 && mpz_cmp(priv2.p, priv->p) == 0, "hexadecimal private key detected by load");
+	fclose(fp);
+
+	mpz_clear(m);
+	mpz_clear(c);
+	paillier_public_clear(&pub2);
+	paillier_private_clear(&priv2);
+}
+
+/** Containers of ciphertexts, and rejection of corrupted or foreign containers
+ */
+static void test_container(paillier_public_key *pub, paillier_private_key *priv, paillier_public_key *other) {
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH), *d = values_init(TEST_BATCH);
+	mpz_t *weights = values_init(TEST_BATCH);
+	paillier_container_writer writer;
+	paillier_container cont;
+	mpz_t sum, expected;
+	FILE *fp, *bad;
+	long size;
+	size_t i;
+	int ok;
+
+	mpz_init(sum);
+	mpz_init(expected);
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], 31*i + 1);
+		mpz_set_ui(weights[i], i + 2);
+		mpz_addmul(expected, m[i], weights[i]);
+	}
+	paillier_encrypt_batch(c, m, TEST_BATCH, pub);
+
+	fp = tmpfile();
+	ok = paillier_container_writer_init(&writer, fp, pub) == 0;
+	for(i = 0; i < TEST_BATCH && ok; i++) {
+		ok = paillier_container_write(&writer, c[i]) == 0;
+	}
+	ok = paillier_container_writer_finish(&writer) == 0 && ok;
+	size = ftell(fp);
+	rewind(fp);
+	ok = ok && paillier_container_open(&cont, fp) == 0;
+	check(ok && cont.count == TEST_BATCH, "container round trip");
+	if(ok) {
+		ok = paillier_decrypt_container(d, &cont, priv) == 0;
+		for(i = 0; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], m[i]) == 0;
+		check(ok, "container decryption");
+
+		ok = paillier_homomorphic_dot_container(sum, &cont, weights, pub) == 0;
+		check(ok && decrypts_to(&sum, &expected, 1, priv), "container dot product");
+
+		for(i = 0, mpz_set_ui(expected, 0); i < TEST_BATCH; i++) mpz_add(expected, expected, m[i]);
+		ok = paillier_homomorphic_sum_container(sum, &cont, pub) == 0;
+		check(ok && decrypts_to(&sum, &expected, 1, priv), "container sum");
+
+		check(paillier_homomorphic_sum_container(sum, &cont, other) == -1, "container of another key rejected");
+		paillier_container_close(&cont);
+	}
+
+	bad = corrupt_copy(fp, -1, size - 1);
+	check(paillier_container_open(&cont, bad) == -1, "truncated container rejected");
+	fclose(bad);
+	bad = corrupt_copy(fp, 1, -1);
+	check(paillier_container_open(&cont, bad) == -1, "container with a wrong magic number rejected");
+	fclose(bad);
+
+	//twice the width and half the count of ciphertexts, with the same size
+	bad = corrupt_copy(fp, -1, -1);
+	fseek(bad, 12, SEEK_SET);
+	putc(2*paillier_core_limbs(pub), bad);
+	fseek(bad, 16, SEEK_SET);
+	putc(TEST_BATCH/2, bad);
+	fflush(bad);
+	rewind(bad);
+	ok = paillier_container_open(&cont, bad) == 0;
+	if(ok) {
+		ok = paillier_decrypt_container(d, &cont, priv) == -1 && paillier_homomorphic_sum_container(sum, &cont, pub) == -1;
+		paillier_container_close(&cont);
+	}
+	check(ok, "container with the wrong record width rejected");
+	fclose(bad);
+	fclose(fp);
+
+	mpz_clear(sum);
+	mpz_clear(expected);
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+	values_clear(d, TEST_BATCH);
+	values_clear(weights, TEST_BATCH);
+}
+
+/** Write all bytes to a socket
+ */
+static int write_all(int fd, const unsigned char *data, size_t len) {
+	ssize_t ret;
+
+	while(len > 0) {
+		ret = write(fd, data, len);
+		if(ret < 0 && errno == EINTR) continue;
+		if(ret <= 0) return -1;
+		data += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/** Read exactly len bytes from a socket
+ */
+static int read_all(int fd, unsigned char *data, size_t len) {
+	ssize_t ret;
+
+	while(len > 0) {
+		ret = read(fd, data, len);
+		if(ret < 0 && errno == EINTR) continue;
+		if(ret <= 0) return -1;
+		data += ret;
+		len -= ret;
+	}
+	return 0;
+}
+
+/** Write an unsigned 32-bit integer in little-endian order
+ */
+static void put_u32(unsigned char *dest, uint32_t value) {
+	dest[0] = (unsigned char)value;
+	dest[1] = (unsigned char)(value >> 8);
+	dest[2] = (unsigned char)(value >> 16);
+	dest[3] = (unsigned char)(value >> 24);
+}
+
+/** Read an unsigned 32-bit integer in little-endian order
+ */
+static uint32_t get_u32(const unsigned char *src) {
+	return (uint32_t)src[0] | ((uint32_t)src[1] << 8) | ((uint32_t)src[2] << 16) | ((uint32_t)src[3] << 24);
+}
+
+/** Send a request to the server
+ *
+ * @param[in] fd input socket
+ * @param[in] id input request identifier
+ * @param[in] op input operation
+ * @param[in] count input number of items
+ * @param[in] operands input operands of the items
+ * @param[in] noperands input number of operands
+ * @return 0 if no error
+ */
+static int send_request(int fd, uint32_t id, unsigned int op, uint32_t count, mpz_t *operands, size_t noperands) {
+	unsigned char *request;
+	size_t i, len = PAILLIER_SERVER_HEADER_SIZE, size;
+	int result;
+
+	for(i = 0; i < noperands; i++) {
+		len += 4 + (mpz_sizeinbase(operands[i], 2) + 7)/8;
+	}
+	request = (unsigned char *)calloc(len, 1);
+	if(request == NULL) return -1;
+	put_u32(request, id);
+	request[4] = (unsigned char)op;
+	put_u32(request + 8, count);
+	put_u32(request + 12, len - PAILLIER_SERVER_HEADER_SIZE);
+	len = PAILLIER_SERVER_HEADER_SIZE;
+	for(i = 0; i < noperands; i++) {
+		size = mpz_sgn(operands[i]) ? (mpz_sizeinbase(operands[i], 2) + 7)/8 : 0;
+		put_u32(request + len, size);
+		mpz_export(request + len + 4, NULL, -1, 1, 0, 0, operands[i]);
+		len += 4 + size;
+	}
+	result = write_all(fd, request, len);
+	free(request);
+	return result;
+}
+
+/** Receive a response from the server
+ *
+ * @param[in] fd input socket
+ * @param[out] id output request identifier
+ * @param[out] results output results, already initialized, or NULL to discard them
+ * @param[in] max input maximum number of results
+ * @return status of the response, or -1 if the response is malformed or the connection is closed
+ */
+static int recv_response(int fd, uint32_t *id, mpz_t *results, size_t max) {
+	unsigned char header[PAILLIER_SERVER_HEADER_SIZE], *payload;
+	size_t count, len, pos = 0, size, i;
+	int status;
+
+	if(read_all(fd, header, sizeof(header))) return -1;
+	*id = get_u32(header);
+	status = header[4];
+	count = get_u32(header + 8);
+	len = get_u32(header + 12);
+	payload = (unsigned char *)malloc(len + 1);
+	if(payload == NULL || read_all(fd, payload, len) || count > max) {
+		free(payload);
+		return -1;
+	}
+	for(i = 0; i < count; i++) {
+		if(len - pos < 4 || len - pos - 4 < (size = get_u32(payload + pos))) {
+			status = -1;
+			break;
+		}
+		if(results != NULL) mpz_import(results[i], size, -1, 1, 0, 0, payload + pos + 4);
+		pos += 4 + size;
+	}
+	free(payload);
+	return status;
+}
+
+/** Connect to the server, waiting for its socket to appear
+ */
+static int server_connect(const char *path) {
+	struct sockaddr_un addr;
+	int fd, attempt;
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strncpy(addr.sun_path, path, sizeof(addr.sun_path) - 1);
+	for(attempt = 0; attempt < 600; attempt++) {
+		fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if(fd < 0) return -1;
+		if(connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == 0) return fd;
+		close(fd);
+		usleep(100000);
+	}
+	return -1;
+}
+
+/** Run the server in a child process
+ *
+ * The signals handled by the server are blocked before the thread pool is started by the key generation,
+ * so that they reach the event loop of the server.
+ */
+static pid_t server_start(const char *path) {
+	paillier_public_key pub;
+	paillier_private_key priv;
+	sigset_t signals;
+	pid_t pid;
+
+	pid = fork();
+	if(pid != 0) return pid;
+
+	sigemptyset(&signals);
+	sigaddset(&signals, SIGINT);
+	sigaddset(&signals, SIGTERM);
+	sigaddset(&signals, SIGUSR1);
+	pthread_sigmask(SIG_BLOCK, &signals, NULL);
+	paillier_public_init(&pub);
+	paillier_private_init(&priv);
+	paillier_keygen(&pub, &priv, TEST_BITS);
+	_exit(paillier_serve(path, &pub, &priv) ? 1 : 0);
+}
+
+/** Server protocol, run before anything starts the thread pool of this process
+ */
+static void test_server(void) {
+	char dir[] = "/tmp/paillier_test_XXXXXX", path[64];
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH), *d = values_init(TEST_BATCH), operands[2];
+	unsigned char seen[TEST_PIPELINE];
+	uint32_t id;
+	size_t i;
+	pid_t pid;
+	int fd, fd2, status, ok;
+
+	if(mkdtemp(dir) == NULL) {
+		check(0, "server temporary directory");
+		return;
+	}
+	snprintf(path, sizeof(path), "%s/socket", dir);
+	pid = server_start(path);
+	fd = pid > 0 ? server_connect(path) : -1;
+	check(fd >= 0, "server connection");
+	if(fd < 0) {
+		if(pid > 0) kill(pid, SIGKILL);
+		return;
+	}
+	mpz_init(operands[0]);
+	mpz_init(operands[1]);
+
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], 17*i + 5);
+	}
+	ok = send_request(fd, 1, PAILLIER_SERVER_ENCRYPT, TEST_BATCH, m, TEST_BATCH) == 0
+			&& recv_response(fd, &id, c, TEST_BATCH) == PAILLIER_SERVER_OK && id == 1;
+	ok = ok && send_request(fd, 2, PAILLIER_SERVER_DECRYPT, TEST_BATCH, c, TEST_BATCH) == 0
+			&& recv_response(fd, &id, d, TEST_BATCH) == PAILLIER_SERVER_OK && id == 2;
+	for(i = 0; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], m[i]) == 0;
+	check(ok, "server encryption and decryption");
+
+	mpz_set(operands[0], c[3]);
+	mpz_set(operands[1], c[4]);
+	ok = send_request(fd, 3, PAILLIER_SERVER_ADD, 1, operands, 2) == 0
+			&& recv_response(fd, &id, d, 1) == PAILLIER_SERVER_OK
+			&& send_request(fd, 4, PAILLIER_SERVER_DECRYPT, 1, d, 1) == 0
+			&& recv_response(fd, &id, d, 1) == PAILLIER_SERVER_OK;
+	mpz_add(operands[0], m[3], m[4]);
+	check(ok && mpz_cmp(d[0], operands[0]) == 0, "server homomorphic addition");
+
+	mpz_set(operands[0], c[5]);
+	mpz_set_ui(operands[1], 1000);
+	ok = send_request(fd, 5, PAILLIER_SERVER_MULTC, 1, operands, 2) == 0
+			&& recv_response(fd, &id, d, 1) == PAILLIER_SERVER_OK
+			&& send_request(fd, 6, PAILLIER_SERVER_DECRYPT, 1, d, 1) == 0
+			&& recv_response(fd, &id, d, 1) == PAILLIER_SERVER_OK;
+	check(ok && mpz_cmp_ui(d[0], 1000*mpz_get_ui(m[5])) == 0, "server homomorphic multiplication");
+
+	check(send_request(fd, 7, 9, 1, m, 1) == 0 && recv_response(fd, &id, d, 1) == PAILLIER_SERVER_UNSUPPORTED && id == 7,
+			"server unsupported operation");
+	check(send_request(fd, 8, PAILLIER_SERVER_ENCRYPT, 1000, m, 1) == 0
+			&& recv_response(fd, &id, d, 1) == PAILLIER_SERVER_BAD_REQUEST && id == 8, "server item count beyond the payload");
+	mpz_setbit(operands[0], 4*TEST_BITS);
+	check(send_request(fd, 9, PAILLIER_SERVER_ENCRYPT, 1, operands, 1) == 0
+			&& recv_response(fd, &id, d, 1) == PAILLIER_SERVER_BAD_REQUEST && id == 9, "server plaintext out of range");
+
+	//more requests than a connection may have in progress
+	memset(seen, 0, sizeof(seen));
+	for(i = 0, ok = 1; i < TEST_PIPELINE && ok; i++) {
+		ok = send_request(fd, 100 + i, PAILLIER_SERVER_ENCRYPT, 1, m + i % TEST_BATCH, 1) == 0;
+	}
+	for(i = 0; i < TEST_PIPELINE && ok; i++) {
+		ok = recv_response(fd, &id, NULL, 1) == PAILLIER_SERVER_OK && id >= 100 && id < 100 + TEST_PIPELINE && !seen[id - 100];
+		if(ok) seen[id - 100] = 1;
+	}
+	check(ok, "server pipelined requests");
+
+	//requests sent before a half-close are answered before the connection is closed
+	fd2 = server_connect(path);
+	for(i = 0, ok = fd2 >= 0; i < 3 && ok; i++) {
+		ok = send_request(fd2, 200 + i, PAILLIER_SERVER_ENCRYPT, 1, m + i, 1) == 0;
+	}
+	ok = ok && shutdown(fd2, SHUT_WR) == 0;
+	for(i = 0; i < 3 && ok; i++) {
+		ok = recv_response(fd2, &id, NULL, 1) == PAILLIER_SERVER_OK;
+	}
+	check(ok && read(fd2, seen, 1) == 0, "server half-closed connection");
+	if(fd2 >= 0) close(fd2);
+
+	close(fd);
+	kill(pid, SIGTERM);
+	ok = waitpid(pid, &status, 0) == pid && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+	check(ok && access(path, F_OK) != 0, "server stopped by SIGTERM");
+	rmdir(dir);
+
+	mpz_clear(operands[0]);
+	mpz_clear(operands[1]);
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+	values_clear(d, TEST_BATCH);
+}
+
+/** Encryption with the private key, with and without p and q
+ */
+static void test_encrypt_priv(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t m[3], c[3], p;
+	size_t i;
+	int ok = 1;
+
+	mpz_init(p);
+	mpz_init_set_ui(m[0], 0);
+	mpz_init_set_ui(m[1], 12345);
+	mpz_init(m[2]);
+	mpz_sub_ui(m[2], pub->n, 1);
+	for(i = 0; i < 3; i++) {
+		mpz_init(c[i]);
+		ok = ok && paillier_encrypt_priv(c[i], m[i], priv) == 0;
+	}
+	check(ok && decrypts_to(c, m, 3, priv), "encryption with the private key");
+	ok = paillier_encrypt_priv(c[0], m[1], priv) == 0 && mpz_cmp(c[0], c[1]) != 0;
+	check(ok && decrypts_to(c, m + 1, 1, priv), "randomized encryption with the private key");
+
+	//without p and q, the random factor is computed with the exponent n modulo p^2 and q^2
+	mpz_swap(p, priv->p);
+	for(i = 0, ok = 1; i < 3; i++) {
+		ok = ok && paillier_encrypt_priv(c[i], m[i], priv) == 0;
+	}
+	ok = ok && decrypts_to(c, m, 3, priv);
+	mpz_swap(p, priv->p);
+	check(ok && decrypts_to(c, m, 3, priv), "encryption with a private key without p and q");
+
+	for(i = 0; i < 3; i++) {
+		mpz_clear(m[i]);
+		mpz_clear(c[i]);
+	}
+	mpz_clear(p);
+}
+
+/** Re-randomization of ciphertexts with a public key context
+ */
+static void test_rerandomize(paillier_public_key *pub, paillier_private_key *priv) {
+	mpz_t *m = values_init(TEST_BATCH), *c = values_init(TEST_BATCH), *d = values_init(TEST_BATCH);
+	paillier_public_ctx ctx;
+	size_t i;
+	int ok;
+
+	for(i = 0; i < TEST_BATCH; i++) {
+		mpz_set_ui(m[i], 5*i + 11);
+	}
+	paillier_public_ctx_init(&ctx, pub);
+	paillier_encrypt_batch(c, m, TEST_BATCH, pub);
+
+	ok = paillier_rerandomize(d[0], c[0], &ctx) == 0 && mpz_cmp(d[0], c[0]) != 0;
+	check(ok && decrypts_to(d, m, 1, priv), "re-randomization");
+
+	ok = paillier_rerandomize_batch(d, c, TEST_BATCH, &ctx) == 0;
+	for(i = 0; i < TEST_BATCH && ok; i++) ok = mpz_cmp(d[i], c[i]) != 0;
+	check(ok && decrypts_to(d, m, TEST_BATCH, priv), "batch re-randomization");
+	paillier_public_ctx_clear(&ctx);
+
+	values_clear(m, TEST_BATCH);
+	values_clear(c, TEST_BATCH);
+	values_clear(d, TEST_BATCH);
+}
+
+/** Encoding of signed integers and fixed-point values, at the boundaries of the encodings
+ */
+static void test_encoding(paillier_public_key *pub, paillier_private_key *priv) {
+	int64_t ints[] = {INT64_MIN, INT64_MIN + 1, -1, 0, 1, INT64_MAX}, decoded[6];
+	double reals[] = {-2.5, 0.0, 1e-3, 3.75, -1e10}, decoded_reals[5], bad;
+	size_t nints = sizeof(ints)/sizeof(ints[0]), nreals = sizeof(reals)/sizeof(reals[0]), i;
+	mpz_t *plaintexts = values_init(nints), *c = values_init(nints), half;
+	paillier_public_ctx ctx;
+	int ok;
+
+	mpz_init(half);
+	mpz_tdiv_q_2exp(half, pub->n, 1);
+
+	ok = paillier_encode_int64(plaintexts, ints, nints, pub) == 0 && paillier_decode_int64(decoded, plaintexts, nints, pub) == 0;
+	for(i = 0; i < nints && ok; i++) ok = decoded[i] == ints[i];
+	check(ok, "int64 encoding round trip from INT64_MIN to INT64_MAX");
+
+	paillier_public_ctx_init(&ctx, pub);
+	memset(decoded, 0, sizeof(decoded));
+	ok = paillier_encrypt_int64_batch(c, ints, nints, &ctx) == 0 && paillier_decrypt_int64_batch(decoded, c, nints, priv) == 0;
+	for(i = 0; i < nints && ok; i++) ok = decoded[i] == ints[i];
+	check(ok, "int64 encryption round trip");
+
+	//INT64_MIN+(-1) and INT64_MAX+1 leave the 64-bit range
+	paillier_homomorphic_add(c[0], c[0], c[2], pub);
+	paillier_homomorphic_add(c[5], c[5], c[4], pub);
+	check(paillier_decrypt_int64_batch(decoded, c, 1, priv) == -1 && paillier_decrypt_int64_batch(decoded, c + 5, 1, priv) == -1,
+			"int64 overflow detected by decoding");
+
+	//n/2 is the largest positive value, n/2+1 the most negative one, neither fits in 64 bits
+	mpz_set(plaintexts[0], half);
+	mpz_add_ui(plaintexts[1], half, 1);
+	mpz_set(plaintexts[2], pub->n);
+	check(paillier_decode_int64(decoded, plaintexts, 1, pub) == -1 && paillier_decode_int64(decoded, plaintexts + 1, 1, pub) == -1
+			&& paillier_decode_int64(decoded, plaintexts + 2, 1, pub) == -1, "int64 decoding of n/2, n/2+1 and n rejected");
+	ok = paillier_decode_double(decoded_reals, plaintexts, 2, 0, pub) == 0;
+	check(ok && decoded_reals[0] > 0 && decoded_reals[1] < 0 && decoded_reals[0] == -decoded_reals[1],
+			"double decoding of n/2 and n/2+1");
+	check(paillier_decode_double(decoded_reals, plaintexts + 2, 1, 0, pub) == -1, "double decoding of n rejected");
+
+	ok = paillier_encode_double(plaintexts, reals, nreals, 20, pub) == 0
+			&& paillier_decode_double(decoded_reals, plaintexts, nreals, 20, pub) == 0;
+	for(i = 0; i < nreals && ok; i++) ok = fabs(decoded_reals[i] - reals[i]) <= ldexp(1.0, -21);
+	check(ok, "double encoding round trip");
+
+	ok = paillier_encrypt_double_batch(c, reals, nreals, 20, &ctx) == 0
+			&& paillier_decrypt_double_batch(decoded_reals, c, nreals, 20, priv) == 0;
+	for(i = 0; i < nreals && ok; i++) ok = fabs(decoded_reals[i] - reals[i]) <= ldexp(1.0, -21);
+	check(ok, "double encryption round trip");
+	paillier_public_ctx_clear(&ctx);
+
+	bad = NAN;
+	check(paillier_encode_double(plaintexts, &bad, 1, 0, pub) == -1, "NaN rejected by encoding");
+	bad = INFINITY;
+	check(paillier_encode_double(plaintexts, &bad, 1, 0, pub) == -1, "infinity rejected by encoding");
+	//n has TEST_BITS bits, so that 2^(TEST_BITS-1) exceeds n/2 and 2^(TEST_BITS-3) does not
+	bad = ldexp(-1.0, TEST_BITS - 1);
+	check(paillier_encode_double(plaintexts, &bad, 1, 0, pub) == -1, "value above n/2 rejected by encoding");
+	bad = ldexp(-1.0, TEST_BITS - 3);
+	ok = paillier_encode_double(plaintexts, &bad, 1, 0, pub) == 0 && paillier_decode_double(decoded_reals, plaintexts, 1, 0, pub) == 0;
+	check(ok && decoded_reals[0] == bad, "value below n/2 encoded");
+	check(paillier_encode_double(plaintexts, reals, 1, PAILLIER_ENCODING_MAX_EXPONENT + 1, pub) == -1,
+			"exponent out of range rejected");
+
+	mpz_clear(half);
+	values_clear(plaintexts, nints);
+	values_clear(c, nints);
+}
+
+/** Test the library API
+ *
+ * @return 0 if all checks pass, 1 otherwise
+ */
+int main(void) {
+	paillier_public_key pub;
+	paillier_private_key priv;
+	paillier_public_key other_pub;
+	paillier_private_key other_priv;
+
+	//the server runs in a child process, which must be forked before the thread pool is started
+	test_server();
+
+	paillier_public_init(&pub);
+	paillier_private_init(&priv);
+	paillier_keygen(&pub, &priv, TEST_BITS);
+	paillier_public_init(&other_pub);
+	paillier_private_init(&other_priv);
+	paillier_keygen(&other_pub, &other_priv, TEST_BITS);
+
+	test_ctx(&pub, &priv);
+	test_crt_decrypt(&pub, &priv);
+	test_encrypt_batch(&pub, &priv);
+	test_decrypt_batch(&pub, &priv);
+	test_random_source(&pub, &priv);
+	test_pool(&pub, &priv);
+	test_djn(&pub, &priv);
+	test_dot(&pub, &priv);
+	test_sum(&pub, &priv);
+	test_mont(&pub, &priv);
+	test_core(&pub, &priv);
+	test_packing(&pub, &priv);
+	test_dj(&pub, &priv);
+	test_keygen_batch();
+	test_bin_keys(&pub, &priv);
+	test_container(&pub, &priv, &other_pub);
+	test_encrypt_priv(&pub, &priv);
+	test_rerandomize(&pub, &priv);
+	test_encoding(&pub, &priv);
+
+	paillier_public_clear(&pub);
+	paillier_private_clear(&priv);
+	paillier_public_clear(&other_pub);
+	paillier_private_clear(&other_priv);
+
+	printf("%d failed check(s)\n", failures);
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,384 @@
+/**
+ * @file bench.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include "../include/paillier.h"
+#include "../src/tools.h"
+
+/** Number of distinct operands cycled through by a measurement
+ */
+#define BENCH_OPERANDS 16
+
+/** Maximum number of entries in a list of bit lengths or thread counts
+ */
+#define BENCH_MAX_LIST 16
+
+/** Keys and operands of a bit length
+ */
+typedef struct {
+	paillier_public_key pub;
+	paillier_private_key priv;
+	mpz_t m[BENCH_OPERANDS];	/**< plaintexts */
+	mpz_t c[BENCH_OPERANDS];	/**< ciphertexts of the plaintexts */
+	mpz_t k[BENCH_OPERANDS];	/**< constants, as long as n */
+	mpz_t u[BENCH_OPERANDS];	/**< values c^lambda mod n^2, inputs of L */
+	mpz_t out;					/**< result of an operation */
+	mp_bitcnt_t bits;			/**< bit length of n */
+} bench_data;
+
+/** Operation measured by the benchmark
+ */
+typedef void (*bench_function)(bench_data *data, size_t i);
+
+/** Benchmark settings
+ */
+typedef struct {
+	unsigned long bits[BENCH_MAX_LIST];		/**< bit lengths */
+	size_t nbits;
+	unsigned long threads[BENCH_MAX_LIST];	/**< thread counts of the scaling sweep */
+	size_t nthreads;
+	size_t iterations;			/**< measured iterations per operation */
+	size_t warmup;				/**< iterations run before the measurement */
+	size_t keygen_iterations;	/**< measured iterations for key generation */
+	size_t batch;				/**< batch size of the scaling sweep */
+	int first;					/**< set until the first JSON record is printed */
+	FILE *out;					/**< JSON output */
+} bench_settings;
+
+/** Current time in seconds
+ */
+static double now(void) {
+	struct timespec t;
+
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec + t.tv_nsec*1e-9;
+}
+
+static void op_keygen(bench_data *data, size_t i) {
+	paillier_public_key pub;
+	paillier_private_key priv;
+
+	paillier_public_init(&pub);
+	paillier_private_init(&priv);
+	paillier_keygen(&pub, &priv, data->bits);
+	paillier_public_clear(&pub);
+	paillier_private_clear(&priv);
+}
+
+static void op_encrypt(bench_data *data, size_t i) {
+	paillier_encrypt(data->out, data->m[i % BENCH_OPERANDS], &data->pub);
+}
+
+static void op_encrypt_priv(bench_data *data, size_t i) {
+	paillier_encrypt_priv(data->out, data->m[i % BENCH_OPERANDS], &data->priv);
+}
+
+static void op_decrypt(bench_data *data, size_t i) {
+	paillier_decrypt(data->out, data->c[i % BENCH_OPERANDS], &data->priv);
+}
+
+static void op_add(bench_data *data, size_t i) {
+	paillier_homomorphic_add(data->out, data->c[i % BENCH_OPERANDS], data->c[(i + 1) % BENCH_OPERANDS], &data->pub);
+}
+
+static void op_multc(bench_data *data, size_t i) {
+	paillier_homomorphic_multc(data->out, data->c[i % BENCH_OPERANDS], data->k[i % BENCH_OPERANDS], &data->pub);
+}
+
+/** Exponentiation c^lambda mod n^2 of the decryption with CRT modulo p^2 and q^2
+ */
+static void op_crt_exponentiation(bench_data *data, size_t i) {
+	paillier_private_key *priv = &data->priv;
+
+	crt_exponentiation(data->out, data->c[i % BENCH_OPERANDS], priv->lambda, priv->lambda, priv->p2invq2, priv->p2, priv->q2);
+}
+
+static void op_ell(bench_data *data, size_t i) {
+	paillier_ell(data->out, data->u[i % BENCH_OPERANDS], data->priv.ninv, data->priv.len);
+}
+
+static int compare_double(const void *a, const void *b) {
+	double x = *(const double *)a, y = *(const double *)b;
+
+	return (x > y) - (x < y);
+}
+
+/** Nearest-rank percentile of sorted samples
+ */
+static double percentile(double *sorted, size_t count, double p) {
+	size_t rank = (size_t)(p*count + 0.999999);
+
+	if(rank == 0) rank = 1;
+	if(rank > count) rank = count;
+	return sorted[rank - 1];
+}
+
+/** Print the separator before a JSON record
+ */
+static void next_record(bench_settings *settings) {
+	fputs(settings->first ? "\n" : ",\n", settings->out);
+	settings->first = 0;
+}
+
+/**
+ * Each iteration is timed separately, so that percentiles show the spread and not only the mean.
+ */
+static void measure(bench_settings *settings, bench_data *data, const char *name, bench_function run,
+		size_t warmup, size_t iterations) {
+	double *samples, start, total = 0;
+	size_t i;
+
+	samples = (double *)malloc(sizeof(double)*iterations);
+	if(samples == NULL) {
+		fputs("cannot allocate samples!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < warmup; i++) {
+		run(data, i);
+	}
+	for(i = 0; i < iterations; i++) {
+		start = now();
+		run(data, i);
+		samples[i] = now() - start;
+		total += samples[i];
+	}
+	qsort(samples, iterations, sizeof(double), compare_double);
+
+	fprintf(stderr, "%5lu bits  %-20s %12.1f us/op\n", (unsigned long)data->bits, name, total/iterations*1e6);
+	next_record(settings);
+	fprintf(settings->out, "    {\"bits\": %lu, \"op\": \"%s\", \"iterations\": %lu, \"mean_us\": %.3f, "
+			"\"min_us\": %.3f, \"p50_us\": %.3f, \"p90_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f, "
+			"\"ops_per_sec\": %.3f}",
+			(unsigned long)data->bits, name, (unsigned long)iterations, total/iterations*1e6,
+			samples[0]*1e6, percentile(samples, iterations, 0.5)*1e6, percentile(samples, iterations, 0.9)*1e6,
+			percentile(samples, iterations, 0.99)*1e6, samples[iterations - 1]*1e6, iterations/total);
+	free(samples);
+}
+
+/** Throughput of batch encryption and decryption for each thread count of the sweep
+ *
+ * The thread pool is restarted with the requested size before each measurement.
+ */
+static void sweep(bench_settings *settings, bench_data *data) {
+	mpz_t *inputs, *outputs;
+	double start, elapsed, rate, base[2] = {0, 0};
+	size_t i, j, t, rounds = settings->iterations/settings->batch + 1;
+	int op;
+
+	inputs = (mpz_t *)malloc(sizeof(mpz_t)*settings->batch);
+	outputs = (mpz_t *)malloc(sizeof(mpz_t)*settings->batch);
+	if(inputs == NULL || outputs == NULL) {
+		fputs("cannot allocate batch!\n", stderr);
+		exit(1);
+	}
+	for(i = 0; i < settings->batch; i++) {
+		mpz_init(inputs[i]);
+		mpz_init(outputs[i]);
+	}
+
+	for(t = 0; t < settings->nthreads; t++) {
+		paillier_thread_pool_shutdown();
+		paillier_thread_pool_init(settings->threads[t]);
+		for(op = 0; op < 2; op++) {
+			for(i = 0; i < settings->batch; i++) {
+				mpz_set(inputs[i], op ? data->c[i % BENCH_OPERANDS] : data->m[i % BENCH_OPERANDS]);
+			}
+			//warmup with one batch
+			if(op) paillier_decrypt_batch(outputs, inputs, settings->batch, &data->priv);
+			else paillier_encrypt_batch(outputs, inputs, settings->batch, &data->pub);
+
+			start = now();
+			for(j = 0; j < rounds; j++) {
+				if(op) paillier_decrypt_batch(outputs, inputs, settings->batch, &data->priv);
+				else paillier_encrypt_batch(outputs, inputs, settings->batch, &data->pub);
+			}
+			elapsed = now() - start;
+			rate = rounds*settings->batch/elapsed;
+			if(t == 0) base[op] = rate;
+
+			fprintf(stderr, "%5lu bits  %-20s %3lu threads %10.1f ops/s\n", (unsigned long)data->bits,
+					op ? "decrypt_batch" : "encrypt_batch", settings->threads[t], rate);
+			next_record(settings);
+			fprintf(settings->out, "    {\"bits\": %lu, \"op\": \"%s\", \"threads\": %lu, \"batch\": %lu, "
+					"\"ops_per_sec\": %.3f, \"speedup\": %.3f}",
+					(unsigned long)data->bits, op ? "decrypt_batch" : "encrypt_batch", settings->threads[t],
+					(unsigned long)settings->batch, rate, rate/base[op]);
+		}
+	}
+
+	for(i = 0; i < settings->batch; i++) {
+		mpz_clear(inputs[i]);
+		mpz_clear(outputs[i]);
+	}
+	free(inputs);
+	free(outputs);
+}
+
+/** Generate the keys and operands of a bit length
+ */
+static void data_init(bench_data *data, mp_bitcnt_t bits, gmp_randstate_t state) {
+	mpz_t n2;
+	int i;
+
+	data->bits = bits;
+	paillier_public_init(&data->pub);
+	paillier_private_init(&data->priv);
+	paillier_keygen(&data->pub, &data->priv, bits);
+	mpz_init(data->out);
+	mpz_init(n2);
+	mpz_mul(n2, data->pub.n, data->pub.n);
+	for(i = 0; i < BENCH_OPERANDS; i++) {
+		mpz_init(data->m[i]);
+		mpz_init(data->c[i]);
+		mpz_init(data->k[i]);
+		mpz_init(data->u[i]);
+		mpz_urandomm(data->m[i], state, data->pub.n);
+		mpz_urandomm(data->k[i], state, data->pub.n);
+		paillier_encrypt(data->c[i], data->m[i], &data->pub);
+		mpz_powm(data->u[i], data->c[i], data->priv.lambda, n2);
+
+		paillier_decrypt(data->out, data->c[i], &data->priv);
+		if(mpz_cmp(data->out, data->m[i])) {
+			fprintf(stderr, "decryption failed at %lu bits!\n", (unsigned long)bits);
+			exit(1);
+		}
+	}
+	mpz_clear(n2);
+}
+
+static void data_clear(bench_data *data) {
+	int i;
+
+	for(i = 0; i < BENCH_OPERANDS; i++) {
+		mpz_clear(data->m[i]);
+		mpz_clear(data->c[i]);
+		mpz_clear(data->k[i]);
+		mpz_clear(data->u[i]);
+	}
+	mpz_clear(data->out);
+	paillier_public_clear(&data->pub);
+	paillier_private_clear(&data->priv);
+}
+
+/** Parse a comma-separated list of positive integers
+ *
+ * @return number of entries, 0 if the list is invalid
+ */
+static size_t parse_list(unsigned long *list, const char *str) {
+	char *end;
+	size_t count = 0;
+
+	while(count < BENCH_MAX_LIST) {
+		list[count] = strtoul(str, &end, 10);
+		if(end == str || list[count] == 0) return 0;
+		count++;
+		if(*end == '\0') return count;
+		if(*end != ',') return 0;
+		str = end + 1;
+	}
+	return 0;
+}
+
+/**
+ * Micro-benchmarks of the library, written as JSON to stdout while a summary is printed to stderr.
+ * Usage: bench [-b bits,...] [-n iterations] [-w warmup] [-k keygen iterations] [-t threads,...] [-s batch size]
+ */
+int main(int argc, char *argv[]) {
+	static const struct {
+		const char *name;
+		bench_function run;
+	} ops[] = {
+		{"encrypt", op_encrypt},
+		{"encrypt_priv", op_encrypt_priv},
+		{"decrypt", op_decrypt},
+		{"homomorphic_add", op_add},
+		{"homomorphic_multc", op_multc},
+		{"crt_exponentiation", op_crt_exponentiation},
+		{"paillier_ell", op_ell},
+	};
+	bench_settings settings;
+	bench_data data;
+	gmp_randstate_t state;
+	long ncpu;
+	size_t i, j;
+	int opt;
+
+	settings.nbits = parse_list(settings.bits, "1024,2048,3072,4096");
+	settings.iterations = 100;
+	settings.warmup = 10;
+	settings.keygen_iterations = 5;
+	settings.batch = 64;
+	ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+	settings.nthreads = 0;
+	for(i = 1; settings.nthreads < BENCH_MAX_LIST && (long)i < 2*ncpu; i *= 2) {
+		settings.threads[settings.nthreads++] = i < (size_t)ncpu ? i : (size_t)ncpu;
+	}
+	while((opt = getopt(argc, argv, "b:n:w:k:t:s:")) != -1) {
+		switch(opt) {
+		case 'b': settings.nbits = parse_list(settings.bits, optarg); break;
+		case 't': settings.nthreads = parse_list(settings.threads, optarg); break;
+		case 'n': settings.iterations = strtoul(optarg, NULL, 10); break;
+		case 'w': settings.warmup = strtoul(optarg, NULL, 10); break;
+		case 'k': settings.keygen_iterations = strtoul(optarg, NULL, 10); break;
+		case 's': settings.batch = strtoul(optarg, NULL, 10); break;
+		default: settings.nbits = 0;
+		}
+	}
+	if(settings.nbits == 0 || settings.nthreads == 0 || settings.iterations == 0
+			|| settings.keygen_iterations == 0 || settings.batch == 0) {
+		fputs("usage: bench [-b bits,...] [-n iterations] [-w warmup] [-k keygen iterations] "
+				"[-t threads,...] [-s batch size]\n", stderr);
+		return 1;
+	}
+
+	settings.out = stdout;
+	settings.first = 1;
+	gmp_randinit_default(state);
+	fprintf(settings.out, "{\n  \"gmp_version\": \"%s\",\n  \"cpus\": %ld,\n  \"iterations\": %lu,\n"
+			"  \"warmup\": %lu,\n  \"results\": [", gmp_version, ncpu,
+			(unsigned long)settings.iterations, (unsigned long)settings.warmup);
+	for(i = 0; i < settings.nbits; i++) {
+		//single operations run with the default pool size
+		paillier_thread_pool_shutdown();
+		paillier_thread_pool_init(0);
+
+		data_init(&data, settings.bits[i], state);
+		measure(&settings, &data, "keygen", op_keygen, settings.warmup ? 1 : 0, settings.keygen_iterations);
+		for(j = 0; j < sizeof(ops)/sizeof(ops[0]); j++) {
+			measure(&settings, &data, ops[j].name, ops[j].run, settings.warmup, settings.iterations);
+		}
+		sweep(&settings, &data);
+		data_clear(&data);
+	}
+	fputs("\n  ]\n}\n", settings.out);
+
+	gmp_randclear(state);
+	paillier_thread_pool_shutdown();
+	return 0;
+}
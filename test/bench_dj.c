@@ -0,0 +1,123 @@
+/**
+ * @file bench_dj.c
+ *
+ * @date Created on: Oct 16, 2026
+ * @author Paillier-GMP contributors
+ * @copyright Paillier-GMP contributors, 2026
+ *
+ * This file is part of Paillier-GMP.
+ *
+ * Paillier-GMP is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ *
+ * Paillier-GMP is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Paillier-GMP.  If not, see <http://www.gnu.org/licenses/>.
+ *
+ */
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "../include/paillier.h"
+
+/** Largest value of s in the benchmark
+ */
+#define BENCH_MAX_S 4
+
+/** Number of operations per measurement
+ */
+#define BENCH_OPS 20
+
+/** Elapsed time in seconds
+ */
+static double elapsed(struct timespec *start, struct timespec *end) {
+	return (end->tv_sec - start->tv_sec) + (end->tv_nsec - start->tv_nsec)*1e-9;
+}
+
+/**
+ * Throughput of Damgard-Jurik encryption and decryption, measured in plaintext bytes per second, for s=1..BENCH_MAX_S.
+ * A plaintext carries s*|n| bits, so that larger s amortizes the exponentiations over more data.
+ * Usage: bench_dj [bits]
+ */
+int main(int argc, char *argv[]) {
+	paillier_public_key pub;
+	paillier_private_key priv;
+	paillier_dj_public_ctx pub_ctx;
+	paillier_dj_private_ctx priv_ctx;
+	struct timespec start, end;
+	mpz_t m[BENCH_OPS], c[BENCH_OPS], d;
+	gmp_randstate_t state;
+	double enc_time, dec_time, bytes, enc_base = 0, dec_base = 0;
+	unsigned int s, bits = 2048;
+	int i;
+
+	if(argc > 1) bits = atoi(argv[1]);
+	paillier_public_init(&pub);
+	paillier_private_init(&priv);
+	paillier_keygen(&pub, &priv, bits);
+	gmp_randinit_default(state);
+	mpz_init(d);
+	for(i = 0; i < BENCH_OPS; i++) {
+		mpz_init(m[i]);
+		mpz_init(c[i]);
+	}
+
+	printf("%u-bit modulus, %d operations per measurement\n", bits, BENCH_OPS);
+	printf("s  enc ms/op  dec ms/op  enc KB/s  dec KB/s  enc vs s=1  dec vs s=1\n");
+	for(s = 1; s <= BENCH_MAX_S; s++) {
+		paillier_dj_public_ctx_init(&pub_ctx, &pub, s);
+		paillier_dj_private_ctx_init(&priv_ctx, &priv, s);
+		for(i = 0; i < BENCH_OPS; i++) {
+			mpz_urandomm(m[i], state, pub_ctx.ns[s]);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i = 0; i < BENCH_OPS; i++) {
+			paillier_dj_encrypt(c[i], m[i], &pub_ctx);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		enc_time = elapsed(&start, &end)/BENCH_OPS;
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for(i = 0; i < BENCH_OPS; i++) {
+			paillier_dj_decrypt(d, c[i], &priv_ctx);
+			if(mpz_cmp(d, m[i])) {
+				fprintf(stderr, "decryption failed for s=%u!\n", s);
+				exit(1);
+			}
+		}
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		dec_time = elapsed(&start, &end)/BENCH_OPS;
+
+		bytes = (double)(s*(mpz_sizeinbase(pub.n, 2) - 1))/8;
+		if(s == 1) {
+			enc_base = bytes/enc_time;
+			dec_base = bytes/dec_time;
+		}
+		printf("%u  %9.3f  %9.3f  %8.1f  %8.1f  %10.2f  %10.2f\n", s,
+				enc_time*1e3, dec_time*1e3, bytes/enc_time/1024, bytes/dec_time/1024,
+				bytes/enc_time/enc_base, bytes/dec_time/dec_base);
+
+		paillier_dj_public_ctx_clear(&pub_ctx);
+		paillier_dj_private_ctx_clear(&priv_ctx);
+	}
+
+	for(i = 0; i < BENCH_OPS; i++) {
+		mpz_clear(m[i]);
+		mpz_clear(c[i]);
+	}
+	mpz_clear(d);
+	gmp_randclear(state);
+	paillier_public_clear(&pub);
+	paillier_private_clear(&priv);
+	return 0;
+}
@@ -1,4 +1,5 @@
 #!/bin/bash
+status=0
 if [ ! -e pub4096.txt ] && [ ! -e priv4096.txt ]; then
 	echo 'Generating keys. This might take a while.'
 	../build/paillier keygen pub4096.txt priv4096.txt 4096
@@ -15,6 +16,7 @@ if [ "$result" == "7" ]; then
 	echo "[OK] -> $result == 0x7"
 else
 	echo "[NG] -> $result !== 0x7"
+	status=1
 fi
 echo "Homomorphic multiplication 4x5 using enc(4) and 5."
 echo 5 > m4.txt
@@ -25,4 +27,67 @@ if [ "$result2" == "14" ]; then
 	echo "[OK] -> $result2 == 0x14"
 else
 	echo "[NG] -> $result2 != 0x14"
+	status=1
 fi
+echo "Conversion of the keys to the binary format and back."
+../build/paillier convert-public pub4096_bin.txt pub4096.txt
+../build/paillier convert-private priv4096_bin.txt priv4096.txt
+../build/paillier convert-public pub4096_hex.txt pub4096_bin.txt
+../build/paillier decrypt m6.txt c3.txt priv4096_bin.txt
+if cmp -s pub4096.txt pub4096_hex.txt && [ "`cat m6.txt`" == "7" ]; then
+	echo "[OK] -> binary keys round trip"
+else
+	echo "[NG] -> binary keys round trip"
+	status=1
+fi
+echo "Rejection of corrupted binary keys."
+head -c -1 priv4096_bin.txt > bad_bin.txt
+../build/paillier decrypt m7.txt c3.txt bad_bin.txt 2> /dev/null
+truncated=$?
+cp pub4096_bin.txt bad_bin.txt
+printf 'X' | dd of=bad_bin.txt bs=1 count=1 conv=notrunc 2> /dev/null
+../build/paillier encrypt c7.txt m1.txt bad_bin.txt 2> /dev/null
+magic=$?
+if [ $truncated -ne 0 ] && [ $magic -ne 0 ]; then
+	echo "[OK] -> truncated private key and public key with a wrong magic number rejected"
+else
+	echo "[NG] -> corrupted binary key accepted"
+	status=1
+fi
+echo "Streaming encryption and decryption of 1, 2 and 0xa."
+printf '1\n2\na\n' > m8.txt
+result3=`../build/paillier encrypt-stream pub4096.txt < m8.txt | ../build/paillier decrypt-stream priv4096_bin.txt | tr '\n' ' '`
+if [ "$result3" == "1 2 a " ]; then
+	echo "[OK] -> $result3== 1 2 a "
+else
+	echo "[NG] -> $result3!= 1 2 a "
+	status=1
+fi
+echo "Streaming homomorphic sum 1+2+0xa."
+result4=`../build/paillier encrypt-stream pub4096.txt < m8.txt | ../build/paillier sum-stream pub4096_bin.txt | ../build/paillier decrypt-stream priv4096.txt`
+if [ "$result4" == "d" ]; then
+	echo "[OK] -> $result4 == 0xd"
+else
+	echo "[NG] -> $result4 != 0xd"
+	status=1
+fi
+echo "Rejection of a malformed line in a stream."
+if printf '1\nxyz\n' | ../build/paillier encrypt-stream pub4096.txt > /dev/null 2>&1; then
+	echo "[NG] -> malformed line accepted"
+	status=1
+else
+	echo "[OK] -> malformed line rejected"
+fi
+echo "Damgard-Jurik-Nielsen encryption of 3."
+cp pub4096.txt pub4096_djn.txt
+../build/paillier djn pub4096_djn.txt
+../build/paillier encrypt c9.txt m1.txt pub4096_djn.txt
+../build/paillier decrypt m9.txt c9.txt priv4096.txt
+result5=`cat m9.txt`
+if ! cmp -s pub4096.txt pub4096_djn.txt && [ "$result5" == "3" ]; then
+	echo "[OK] -> $result5 == 0x3"
+else
+	echo "[NG] -> $result5 != 0x3"
+	status=1
+fi
+exit $status